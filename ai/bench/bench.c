@@ -0,0 +1,158 @@
+//
+// ai/bench/bench.c: Audio resampler benchmark.
+//
+// CEN64: Cycle-Accurate Nintendo 64 Simulator.
+// Copyright (C) 2014, Tyler J. Stachecki.
+//
+// This file is subject to the terms and conditions defined in
+// 'LICENSE', which is part of this source code package.
+//
+
+#include "common.h"
+#include "ai/ai.h"
+#include "ai/resampler.h"
+#include "os/timer.h"
+#include <stdio.h>
+
+// Frames of input generated, and frames of output pulled at a time.
+#define BENCH_INPUT_FRAMES (1 << 20)
+#define BENCH_OUTPUT_FRAMES 512
+
+static int16_t *make_input(unsigned frames);
+static void print_usage(const char *invokation_string);
+
+// Makes up a couple of seconds' worth of something that isn't silence:
+// a sawtooth on the left, and noise on the right.
+int16_t *make_input(unsigned frames) {
+  uint32_t seed = 0x12345678;
+  int16_t *samples;
+  unsigned i;
+
+  if ((samples = (int16_t *) malloc(frames * 2 * sizeof(*samples))) == NULL)
+    return NULL;
+
+  for (i = 0; i < frames; i++) {
+    seed = seed * 1103515245 + 12345;
+
+    samples[i * 2 + 0] = (int16_t) (i * 331 % 0x10000 - 0x8000);
+    samples[i * 2 + 1] = (int16_t) (seed >> 16);
+  }
+
+  return samples;
+}
+
+void print_usage(const char *invokation_string) {
+  printf("%s [Options]\n\n"
+
+    "Options:\n"
+      "  -in <rate>                 : Resample from this rate (32006).\n"
+      "  -out <rate>                : Resample to this rate (48000).\n"
+      "  -loops <count>             : Run through the input this many times.\n"
+
+    ,invokation_string
+  );
+}
+
+// Runs generated samples through the resampler and reports throughput.
+int main(int argc, const char *argv[]) {
+  unsigned i, in_rate = 32006, out_rate = 48000, loops = 16;
+  unsigned long long in_frames = 0, out_frames = 0;
+  int16_t output[BENCH_OUTPUT_FRAMES * 2];
+  struct ai_resampler *resampler;
+  uint64_t hash = 0xCBF29CE484222325ULL;
+  unsigned long long ns;
+  cen64_time start, end;
+  int16_t *input;
+  double secs;
+
+  for (i = 1; i < (unsigned) argc; i++) {
+    if (!strcmp(argv[i], "-in") && i + 1 < (unsigned) argc)
+      in_rate = atoi(argv[++i]);
+
+    else if (!strcmp(argv[i], "-out") && i + 1 < (unsigned) argc)
+      out_rate = atoi(argv[++i]);
+
+    else if (!strcmp(argv[i], "-loops") && i + 1 < (unsigned) argc)
+      loops = atoi(argv[++i]);
+
+    else
+      break;
+  }
+
+  if (i != (unsigned) argc || in_rate == 0 || out_rate == 0 || loops == 0) {
+    print_usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  if ((input = make_input(BENCH_INPUT_FRAMES)) == NULL ||
+    (resampler = ai_resampler_create(out_rate)) == NULL) {
+    printf("Failed to allocate memory for the benchmark.\n");
+    free(input);
+    return EXIT_FAILURE;
+  }
+
+  get_time(&start);
+
+  // Feed the input through the same way the sink thread does.
+  for (i = 0; i < loops; i++) {
+    const int16_t *samples = input;
+    unsigned frames = BENCH_INPUT_FRAMES;
+
+    while (frames > 0) {
+      unsigned j, count = ai_resampler_push(resampler,
+        samples, frames, in_rate);
+
+      samples += count * 2;
+      frames -= count;
+      in_frames += count;
+
+      while ((count = ai_resampler_pull(resampler,
+        output, BENCH_OUTPUT_FRAMES)) > 0) {
+        out_frames += count;
+
+        // Keeps the work from being optimized out, and lets the
+        // output of scalar and vector builds be compared.
+        for (j = 0; j < count * 2; j++)
+          hash = (hash ^ (uint16_t) output[j]) * 0x100000001B3ULL;
+      }
+    }
+  }
+
+  get_time(&end);
+  ns = compute_time_difference(&end, &start);
+  secs = ns > 0 ? (double) ns / NS_PER_SEC : 1e-9;
+
+  printf("{\n"
+    "  \"kernel\": \"%s\",\n"
+    "  \"in_rate\": %u,\n"
+    "  \"out_rate\": %u,\n"
+    "  \"in_samples\": %llu,\n"
+    "  \"out_samples\": %llu,\n"
+    "  \"wall_time\": %.6f,\n"
+    "  \"in_samples_per_second\": %.3f,\n"
+    "  \"out_samples_per_second\": %.3f,\n"
+    "  \"realtime_factor\": %.3f,\n"
+    "  \"output_hash\": \"%016llx\"\n"
+    "}\n",
+
+#if defined(AI_VECT_KERNELS) && !defined(AI_SCALAR_RESAMPLER)
+    "vector",
+#else
+    "scalar",
+#endif
+    in_rate,
+    out_rate,
+    in_frames * 2,
+    out_frames * 2,
+    secs,
+    in_frames * 2 / secs,
+    out_frames * 2 / secs,
+    out_frames / secs / out_rate,
+    (unsigned long long) hash
+  );
+
+  ai_resampler_destroy(resampler);
+  free(input);
+  return EXIT_SUCCESS;
+}
+
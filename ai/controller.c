@@ -9,9 +9,27 @@
 //
 
 #include "common.h"
+#include "ai/controller.h"
+#include "ai/sink.h"
 #include "bus/address.h"
 #include "bus/controller.h"
-#include "ai/controller.h"
+#include "device/device.h"
+#include "device/scheduler.h"
+#include "ri/controller.h"
+#include "vr4300/idle.h"
+#include "vr4300/interface.h"
+
+// The DAC divides the (NTSC) VI clock by AI_DACRATE + 1 to get the
+// sample rate; the RCP is clocked at 62.5MHz.
+#define AI_DAC_CLOCK 48681812ULL
+#define AI_RCP_CLOCK 62500000ULL
+
+#define AI_STATUS_FULL 0x80000001U
+#define AI_STATUS_BUSY 0x40000000U
+
+static uint32_t ai_get_length(const struct ai_controller *ai,
+  uint64_t rcp_cycle);
+static void ai_start_dma(struct ai_controller *ai, uint64_t rcp_cycle);
 
 #ifdef DEBUG_MMIO_REGISTER_ACCESS
 const char *ai_register_mnemonics[NUM_AI_REGISTERS] = {
@@ -21,26 +39,120 @@ const char *ai_register_mnemonics[NUM_AI_REGISTERS] = {
 };
 #endif
 
+// Scheduler callback: the playing buffer has run dry.
+void ai_dma_done(void *opaque) {
+  struct ai_controller *ai = (struct ai_controller *) opaque;
+
+  ai->fifo[0] = ai->fifo[1];
+
+  if (--ai->fifo_count > 0)
+    ai_start_dma(ai, ai->dma_end);
+}
+
+// Returns the number of bytes left in the playing buffer as of the
+// given RCP cycle. Samples are fetched 8 bytes at a time.
+uint32_t ai_get_length(const struct ai_controller *ai, uint64_t rcp_cycle) {
+  uint64_t left;
+
+  if (ai->fifo_count == 0 || rcp_cycle >= ai->dma_end)
+    return 0;
+
+  left = ai->dma_end - rcp_cycle;
+
+  if (rcp_cycle < ai->dma_start)
+    left = ai->dma_end - ai->dma_start;
+
+  return (uint32_t) (ai->fifo[0].length * left /
+    (ai->dma_end - ai->dma_start)) & ~0x7U;
+}
+
 // Initializes the AI.
 int ai_init(struct ai_controller *ai,
   struct bus_controller *bus) {
   ai->bus = bus;
 
+  scheduler_register(bus->scheduler, SCHEDULER_EVENT_AI, ai_dma_done, ai);
   return 0;
 }
 
+// Starts playing the buffer at the head of the FIFO, handing its samples
+// off to the sink. The interrupt lets software queue up the next one.
+void ai_start_dma(struct ai_controller *ai, uint64_t rcp_cycle) {
+  const struct ai_fifo_entry *entry = ai->fifo;
+  unsigned divider = (ai->regs[AI_DACRATE_REG] & 0x3FFF) + 1;
+  unsigned frames = entry->length / 4;
+  uint64_t cycles;
+
+  cycles = (uint64_t) frames * divider * AI_RCP_CLOCK / AI_DAC_CLOCK;
+
+  ai->dma_start = rcp_cycle;
+  ai->dma_end = rcp_cycle + (cycles > 0 ? cycles : 1);
+
+  scheduler_schedule(ai->bus->scheduler, SCHEDULER_EVENT_AI,
+    scheduler_rcp_to_vr4300(ai->dma_end));
+
+  if (ai->sink != NULL) {
+    uint32_t address = entry->address;
+
+    // Don't read past the end of RDRAM.
+    if (address >= DEVICE_RAMSIZE)
+      frames = 0;
+
+    else if (address + entry->length > DEVICE_RAMSIZE)
+      frames = (DEVICE_RAMSIZE - address) / 4;
+
+    ai_sink_push(ai->sink, ai->bus->ri->ram + address, frames,
+      AI_DAC_CLOCK / divider);
+  }
+
+  signal_rcp_interrupt(ai->bus->vr4300, MI_INTR_AI);
+}
+
+// Starts handing samples off to the sink named by spec.
+int ai_sink_start(struct ai_controller *ai, const char *spec) {
+  return (ai->sink = ai_sink_create(spec)) == NULL;
+}
+
+// Stops handing samples off, letting the sink finish up.
+void ai_sink_stop(struct ai_controller *ai) {
+  if (ai->sink == NULL)
+    return;
+
+  ai_sink_destroy(ai->sink);
+  ai->sink = NULL;
+}
+
 // Reads a word from the AI MMIO register space.
 int read_ai_regs(void *opaque, uint32_t address, uint32_t *word) {
   struct ai_controller *ai = (struct ai_controller *) opaque;
   unsigned offset = address - AI_REGS_BASE_ADDRESS;
   enum ai_register reg = (offset >> 2);
 
-  *word = ai->regs[reg];
-  debug_mmio_read(ai, ai_register_mnemonics[reg], *word);
+  if (reg == AI_LEN_REG) {
+    uint64_t now = scheduler_vr4300_to_rcp(ai->bus->scheduler->now);
+
+    ai->regs[AI_LEN_REG] = ai_get_length(ai, now);
 
-  if (reg == AI_STATUS_REG)
-    *word = 0x80000001;
+#ifdef VR4300_BUSY_WAIT_DETECTION
+    // AI_LEN counts down on its own, so don't let the VR4300 skip
+    // ahead past the next time it would read something different.
+    if (ai->regs[AI_LEN_REG] > 0) {
+      uint64_t next = ai->dma_end - (uint64_t) ai->regs[AI_LEN_REG] *
+        (ai->dma_end - ai->dma_start) / ai->fifo[0].length;
 
+      vr4300_idle_limit(&ai->bus->vr4300->idle,
+        scheduler_rcp_to_vr4300(next > now ? next : now + 1));
+    }
+#endif
+  }
+
+  else if (reg == AI_STATUS_REG) {
+    ai->regs[AI_STATUS_REG] = (ai->fifo_count > 0 ? AI_STATUS_BUSY : 0) |
+      (ai->fifo_count > 1 ? AI_STATUS_FULL : 0);
+  }
+
+  *word = ai->regs[reg];
+  debug_mmio_read(ai, ai_register_mnemonics[reg], *word);
   return 0;
 }
 
@@ -51,8 +163,32 @@ int write_ai_regs(void *opaque, uint32_t address, uint32_t word, uint32_t dqm) {
   enum ai_register reg = (offset >> 2);
 
   debug_mmio_write(ai, ai_register_mnemonics[reg], word, dqm);
+
+  // Writing AI_STATUS just acknowledges the interrupt.
+  if (reg == AI_STATUS_REG) {
+    clear_rcp_interrupt(ai->bus->vr4300, MI_INTR_AI);
+    return 0;
+  }
+
   ai->regs[reg] &= ~dqm;
   ai->regs[reg] |= word;
+
+  // Writing AI_LEN queues up a buffer, if there's room for one.
+  if (reg == AI_LEN_REG && ai->fifo_count < 2) {
+    struct ai_fifo_entry *entry = ai->fifo + ai->fifo_count++;
+
+    entry->address = ai->regs[AI_DRAM_ADDR_REG] & 0xFFFFF8;
+    entry->length = ai->regs[AI_LEN_REG] & 0x3FFF8;
+
+    if (entry->length == 0)
+      ai->fifo_count--;
+
+    else if (ai->fifo_count == 1) {
+      ai_start_dma(ai, scheduler_vr4300_to_rcp(
+        ai->bus->scheduler->now));
+    }
+  }
+
   return 0;
 }
 
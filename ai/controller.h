@@ -25,12 +25,34 @@ enum ai_register {
 extern const char *ap_register_mnemonics[NUM_AI_REGISTERS];
 #endif
 
+struct ai_sink;
+
+struct ai_fifo_entry {
+  uint32_t address;
+  uint32_t length;
+};
+
 struct ai_controller {
   struct bus_controller *bus;
   uint32_t regs[NUM_AI_REGISTERS];
+
+  // Buffers queued up with the DMA engine; the first one is playing.
+  struct ai_fifo_entry fifo[2];
+  unsigned fifo_count;
+
+  // RCP cycles on which the playing buffer started and will finish.
+  uint64_t dma_start;
+  uint64_t dma_end;
+
+  // If set, samples get handed off here as they're played.
+  struct ai_sink *sink;
 };
 
 cen64_cold int ai_init(struct ai_controller *ai, struct bus_controller *bus);
+cen64_cold int ai_sink_start(struct ai_controller *ai, const char *spec);
+cen64_cold void ai_sink_stop(struct ai_controller *ai);
+
+cen64_flatten void ai_dma_done(void *opaque);
 
 int read_ai_regs(void *opaque, uint32_t address, uint32_t *word);
 int write_ai_regs(void *opaque, uint32_t address, uint32_t word, uint32_t dqm);
@@ -0,0 +1,175 @@
+//
+// ai/resampler.c: Audio sample rate conversion.
+//
+// CEN64: Cycle-Accurate Nintendo 64 Simulator.
+// Copyright (C) 2014, Tyler J. Stachecki.
+//
+// This file is subject to the terms and conditions defined in
+// 'LICENSE', which is part of this source code package.
+//
+
+#include "common.h"
+#include "ai/ai.h"
+#include "ai/resampler.h"
+#include <math.h>
+
+// Cutoff of the filter, relative to the lower of the two Nyquist rates.
+#define AI_RESAMPLER_CUTOFF 0.9
+
+#define AI_RESAMPLER_PI 3.14159265358979323846
+
+static void ai_resampler_setup(struct ai_resampler *resampler,
+  unsigned in_rate);
+
+// Creates a resampler that puts out frames at out_rate. The history
+// starts out with enough silence that the first output frame lines up
+// with the first input frame.
+struct ai_resampler *ai_resampler_create(unsigned out_rate) {
+  struct ai_resampler *resampler;
+
+  if ((resampler = (struct ai_resampler *) calloc(
+    1, sizeof(*resampler))) == NULL)
+    return NULL;
+
+  resampler->frames = AI_RESAMPLER_TAPS / 2 - 1;
+  resampler->out_rate = out_rate;
+  return resampler;
+}
+
+void ai_resampler_destroy(struct ai_resampler *resampler) {
+  free(resampler);
+}
+
+// Builds the filter for converting from in_rate. Each phase is scaled
+// so that it passes DC through untouched.
+void ai_resampler_setup(struct ai_resampler *resampler, unsigned in_rate) {
+  unsigned out_rate = resampler->out_rate;
+  double cutoff = in_rate > out_rate
+    ? 0.5 * AI_RESAMPLER_CUTOFF * out_rate / in_rate
+    : 0.5 * AI_RESAMPLER_CUTOFF;
+
+  unsigned phase, tap;
+
+  for (phase = 0; phase < AI_RESAMPLER_PHASES; phase++) {
+    double taps[AI_RESAMPLER_TAPS];
+    double sum = 0.0;
+
+    for (tap = 0; tap < AI_RESAMPLER_TAPS; tap++) {
+      double t = (double) tap - (AI_RESAMPLER_TAPS / 2 - 1) -
+        (double) phase / AI_RESAMPLER_PHASES;
+
+      double x = AI_RESAMPLER_PI * 2.0 * cutoff * t;
+      double n = AI_RESAMPLER_PI * (t + AI_RESAMPLER_TAPS / 2) /
+        AI_RESAMPLER_TAPS;
+
+      // Blackman window over the span of the filter.
+      double window = 0.42 - 0.5 * cos(2.0 * n) + 0.08 * cos(4.0 * n);
+
+      taps[tap] = (x != 0.0 ? sin(x) / x : 1.0) * window;
+      sum += taps[tap];
+    }
+
+    for (tap = 0; tap < AI_RESAMPLER_TAPS; tap++) {
+      float coeff = (float) (taps[tap] / sum);
+
+      resampler->coeffs[phase][tap * 2 + 0] = coeff;
+      resampler->coeffs[phase][tap * 2 + 1] = coeff;
+    }
+  }
+
+  resampler->step = ((uint64_t) in_rate << 32) / out_rate;
+  resampler->in_rate = in_rate;
+}
+
+// Appends as many frames to the history as will fit, making room first
+// by dropping those the filter has moved past. Returns the number taken.
+unsigned ai_resampler_push(struct ai_resampler *resampler,
+  const int16_t *samples, unsigned frames, unsigned in_rate) {
+  unsigned consumed = resampler->position >> 32;
+  unsigned i, space;
+
+  if (in_rate == 0)
+    return frames;
+
+  if (in_rate != resampler->in_rate)
+    ai_resampler_setup(resampler, in_rate);
+
+  if (consumed > resampler->frames)
+    consumed = resampler->frames;
+
+  if (consumed > 0) {
+    resampler->frames -= consumed;
+    resampler->position -= (uint64_t) consumed << 32;
+
+    memmove(resampler->history, resampler->history + consumed * 2,
+      resampler->frames * 2 * sizeof(*resampler->history));
+  }
+
+  space = AI_RESAMPLER_BLOCK_FRAMES + AI_RESAMPLER_TAPS - resampler->frames;
+
+  if (frames > space)
+    frames = space;
+
+  for (i = 0; i < frames * 2; i++)
+    resampler->history[resampler->frames * 2 + i] = samples[i];
+
+  resampler->frames += frames;
+  return frames;
+}
+
+// Filters up to the given number of frames out of the history, stopping
+// once the filter would run off the end of it. Returns the number made.
+unsigned ai_resampler_pull(struct ai_resampler *resampler,
+  int16_t *samples, unsigned frames) {
+  uint64_t position = resampler->position;
+  unsigned i;
+
+  for (i = 0; i < frames; i++) {
+    unsigned frame = position >> 32;
+    unsigned phase = (uint32_t) position >> (32 - AI_RESAMPLER_PHASE_BITS);
+
+    if (frame + AI_RESAMPLER_TAPS > resampler->frames)
+      break;
+
+#if defined(AI_VECT_KERNELS) && !defined(AI_SCALAR_RESAMPLER)
+    ai_vect_resample_frame(samples + i * 2,
+      resampler->history + frame * 2, resampler->coeffs[phase]);
+#else
+    ai_resample_frame_scalar(samples + i * 2,
+      resampler->history + frame * 2, resampler->coeffs[phase]);
+#endif
+
+    position += resampler->step;
+  }
+
+  resampler->position = position;
+  return i;
+}
+
+// Reference version of the per-frame kernel. It sums the products up
+// in the same order as the host's vector kernel does.
+void ai_resample_frame_scalar(int16_t *out,
+  const float *history, const float *coeffs) {
+  float acc[8];
+  unsigned i, j;
+
+  for (j = 0; j < 8; j++)
+    acc[j] = history[j] * coeffs[j];
+
+  for (i = 8; i < AI_RESAMPLER_TAPS * 2; i += 8) {
+    for (j = 0; j < 8; j++)
+      acc[j] += history[i + j] * coeffs[i + j];
+  }
+
+  for (j = 0; j < 2; j++) {
+    long sample = lrintf((acc[j] + acc[j + 4]) + (acc[j + 2] + acc[j + 6]));
+
+    if (sample > 32767)
+      sample = 32767;
+    else if (sample < -32768)
+      sample = -32768;
+
+    out[j] = (int16_t) sample;
+  }
+}
+
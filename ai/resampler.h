@@ -0,0 +1,61 @@
+//
+// ai/resampler.h: Audio sample rate conversion.
+//
+// CEN64: Cycle-Accurate Nintendo 64 Simulator.
+// Copyright (C) 2014, Tyler J. Stachecki.
+//
+// This file is subject to the terms and conditions defined in
+// 'LICENSE', which is part of this source code package.
+//
+
+#ifndef __ai_resampler_h__
+#define __ai_resampler_h__
+#include "common.h"
+
+// Taps in each phase of the filter, and phases in the table.
+#define AI_RESAMPLER_TAPS 16
+#define AI_RESAMPLER_PHASE_BITS 8
+#define AI_RESAMPLER_PHASES (1 << AI_RESAMPLER_PHASE_BITS)
+
+// Input frames the history holds (beyond what the filter looks back on).
+#define AI_RESAMPLER_BLOCK_FRAMES 1024
+
+// Converts stereo samples from the rate the game picked for the DAC to
+// a fixed output rate, using a polyphase windowed-sinc filter. Every
+// output frame is a dot product of the history around it with the last
+// phase of the filter at or before where it falls between two input
+// frames (the fraction is truncated, not rounded). The cutoff sits a
+// little below the lower of the two Nyquist frequencies, so it doubles
+// as the anti-aliasing filter on the way down.
+//
+// Coefficients are stored once per channel ((c0, c0), (c1, c1), ...),
+// so that a phase lines up with the interleaved (left, right) history.
+struct ai_resampler {
+  cen64_align(float coeffs[AI_RESAMPLER_PHASES]
+    [AI_RESAMPLER_TAPS * 2], 16);
+
+  float history[(AI_RESAMPLER_BLOCK_FRAMES + AI_RESAMPLER_TAPS) * 2];
+  unsigned frames;
+
+  // Position of the next output frame in the history (32.32 fixed point),
+  // and how far it moves along with each one.
+  uint64_t position;
+  uint64_t step;
+
+  unsigned in_rate;
+  unsigned out_rate;
+};
+
+cen64_cold struct ai_resampler *ai_resampler_create(unsigned out_rate);
+cen64_cold void ai_resampler_destroy(struct ai_resampler *resampler);
+
+unsigned ai_resampler_push(struct ai_resampler *resampler,
+  const int16_t *samples, unsigned frames, unsigned in_rate);
+unsigned ai_resampler_pull(struct ai_resampler *resampler,
+  int16_t *samples, unsigned frames);
+
+void ai_resample_frame_scalar(int16_t *out,
+  const float *history, const float *coeffs);
+
+#endif
+
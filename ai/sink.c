@@ -0,0 +1,285 @@
+//
+// ai/sink.c: Audio sample sinks.
+//
+// CEN64: Cycle-Accurate Nintendo 64 Simulator.
+// Copyright (C) 2014, Tyler J. Stachecki.
+//
+// This file is subject to the terms and conditions defined in
+// 'LICENSE', which is part of this source code package.
+//
+
+#include "common.h"
+#include "ai/resampler.h"
+#include "ai/sink.h"
+#include "os/thread.h"
+#include "os/timer.h"
+
+// If the sink runs dry for this long, its clock starts over.
+#define AI_SINK_MAX_LAG (NS_PER_SEC / 50)
+
+// Resampled frames handed to the sink at a time.
+#define AI_SINK_RESAMPLE_FRAMES 512
+
+static const struct ai_sink_ops *ai_sink_ops[] = {
+  &ai_null_sink_ops,
+  &ai_wav_sink_ops,
+};
+
+static uint64_t ai_sink_clock(unsigned frames,
+  unsigned rate, unsigned speed);
+static void *ai_sink_main(void *opaque);
+static void ai_sink_write(struct ai_sink *sink, const int16_t *samples,
+  unsigned frames, unsigned rate);
+
+static int ai_null_sink_open(struct ai_sink *sink, const char *arg);
+static void ai_null_sink_close(struct ai_sink *sink);
+static void ai_null_sink_write(struct ai_sink *sink, const int16_t *samples,
+  unsigned frames, unsigned rate);
+
+// Discards everything it's handed.
+const struct ai_sink_ops ai_null_sink_ops = {
+  "null",
+  0,
+  ai_null_sink_open,
+  ai_null_sink_close,
+  ai_null_sink_write,
+};
+
+int ai_null_sink_open(struct ai_sink *sink, const char *arg) {
+  return arg != NULL;
+}
+
+void ai_null_sink_close(struct ai_sink *sink) {}
+
+void ai_null_sink_write(struct ai_sink *sink, const int16_t *samples,
+  unsigned frames, unsigned rate) {}
+
+// Returns how long (in ns) it takes to play frames at the given speed.
+uint64_t ai_sink_clock(unsigned frames, unsigned rate, unsigned speed) {
+  return (uint64_t) frames * NS_PER_SEC * 100 / ((uint64_t) rate * speed);
+}
+
+// Feeds the sink with samples as they're pushed.
+void *ai_sink_main(void *opaque) {
+  struct ai_sink *sink = (struct ai_sink *) opaque;
+  uint64_t tail = sink->tail;
+  uint32_t run_tail = sink->run_tail;
+
+  // Frames played since the clock was last started (or wound forward).
+  uint64_t clock_start = 0;
+  unsigned clock_frames = 0;
+  unsigned clock_rate = 0;
+  unsigned clock_speed = 0;
+
+  while (1) {
+    uint64_t head = cen64_atomic_load_u64(&sink->head);
+    const struct ai_sink_run *next;
+    unsigned offset, frames, rate, speed;
+    uint32_t run_head;
+
+    if (head == tail) {
+      if (cen64_atomic_load_u32(&sink->exit))
+        break;
+
+      cen64_sleeper_wait(&sink->sleeper, &sink->head, tail, &sink->exit);
+      continue;
+    }
+
+    // Hand over whatever's contiguous in the ring.
+    offset = tail % AI_SINK_RING_FRAMES;
+    frames = head - tail;
+
+    if (frames > AI_SINK_RING_FRAMES - offset)
+      frames = AI_SINK_RING_FRAMES - offset;
+
+    // Find the run the frames belong to, and stop short of the next.
+    run_head = cen64_atomic_load_u32(&sink->run_head);
+
+    while (run_tail + 1 != run_head && sink->runs[(run_tail + 1) %
+      AI_SINK_RATE_RUNS].start <= tail)
+      run_tail++;
+
+    cen64_atomic_store_u32(&sink->run_tail, run_tail);
+    rate = sink->runs[run_tail % AI_SINK_RATE_RUNS].rate;
+    next = sink->runs + (run_tail + 1) % AI_SINK_RATE_RUNS;
+
+    if (run_tail + 1 != run_head && next->start - tail < frames)
+      frames = next->start - tail;
+
+    speed = cen64_atomic_load_u32(&sink->speed);
+
+    // Play the samples out in real time, unless it's time to wrap up.
+    if (speed > 0 && rate > 0 && !cen64_atomic_load_u32(&sink->exit)) {
+      uint64_t now = get_sleep_time();
+
+      if (frames > AI_SINK_CLOCK_FRAMES)
+        frames = AI_SINK_CLOCK_FRAMES;
+
+      if (rate != clock_rate || speed != clock_speed || now >
+        clock_start + ai_sink_clock(clock_frames, rate, speed) +
+        AI_SINK_MAX_LAG) {
+        clock_start = now;
+        clock_frames = 0;
+        clock_rate = rate;
+        clock_speed = speed;
+      }
+
+      // Wind the clock forward a second at a time to keep it exact.
+      else if (clock_frames >= rate) {
+        clock_start += ai_sink_clock(rate, rate, speed);
+        clock_frames -= rate;
+      }
+
+      clock_frames += frames;
+      sleep_until(clock_start + ai_sink_clock(clock_frames, rate, speed));
+    }
+
+    ai_sink_write(sink, sink->ring + offset * 2, frames, rate);
+
+    tail += frames;
+    cen64_atomic_store_u64(&sink->tail, tail);
+  }
+
+  return NULL;
+}
+
+// Hands samples over to the sink, by way of the resampler if it has one.
+void ai_sink_write(struct ai_sink *sink, const int16_t *samples,
+  unsigned frames, unsigned rate) {
+  int16_t resampled[AI_SINK_RESAMPLE_FRAMES * 2];
+  unsigned count;
+
+  if (sink->resampler == NULL) {
+    sink->ops->write(sink, samples, frames, rate);
+    return;
+  }
+
+  while (frames > 0) {
+    count = ai_resampler_push(sink->resampler, samples, frames, rate);
+    samples += count * 2;
+    frames -= count;
+
+    while ((count = ai_resampler_pull(sink->resampler,
+      resampled, AI_SINK_RESAMPLE_FRAMES)) > 0)
+      sink->ops->write(sink, resampled, count, sink->ops->rate);
+  }
+}
+
+// Creates the sink named by spec ("name" or "name:argument"), and
+// starts up a thread to feed it.
+struct ai_sink *ai_sink_create(const char *spec) {
+  const char *arg = strchr(spec, ':');
+  size_t length = arg != NULL ? (size_t) (arg - spec) : strlen(spec);
+  struct ai_sink *sink;
+  unsigned i;
+
+  if (arg != NULL)
+    arg++;
+
+  if ((sink = (struct ai_sink *) calloc(1, sizeof(*sink))) == NULL)
+    return NULL;
+
+  for (i = 0; i < sizeof(ai_sink_ops) / sizeof(*ai_sink_ops); i++) {
+    if (strlen(ai_sink_ops[i]->name) == length &&
+      !strncmp(ai_sink_ops[i]->name, spec, length))
+      sink->ops = ai_sink_ops[i];
+  }
+
+  if (sink->ops == NULL)
+    goto create_out_free;
+
+  if ((sink->ring = (int16_t *) malloc(
+    AI_SINK_RING_FRAMES * 2 * sizeof(*sink->ring))) == NULL)
+    goto create_out_free;
+
+  if (sink->ops->rate > 0 && (sink->resampler =
+    ai_resampler_create(sink->ops->rate)) == NULL)
+    goto create_out_free;
+
+  if (sink->ops->open(sink, arg))
+    goto create_out_free;
+
+  if (cen64_sleeper_create(&sink->sleeper))
+    goto create_out_close;
+
+  if (cen64_thread_create(&sink->thread, ai_sink_main, sink))
+    goto create_out_sleeper;
+
+  return sink;
+
+create_out_sleeper:
+  cen64_sleeper_destroy(&sink->sleeper);
+create_out_close:
+  sink->ops->close(sink);
+create_out_free:
+  if (sink->resampler != NULL)
+    ai_resampler_destroy(sink->resampler);
+
+  free(sink->ring);
+  free(sink);
+  return NULL;
+}
+
+// Lets the sink thread drain the ring, then closes the sink.
+void ai_sink_destroy(struct ai_sink *sink) {
+  cen64_atomic_store_u32(&sink->exit, 1);
+
+  cen64_sleeper_wake(&sink->sleeper);
+  cen64_thread_join(&sink->thread);
+
+  if (sink->dropped > 0)
+    debug("ai_sink_destroy: Dropped %lu sample frames.\n",
+      (unsigned long) sink->dropped);
+
+  sink->ops->close(sink);
+  cen64_sleeper_destroy(&sink->sleeper);
+
+  if (sink->resampler != NULL)
+    ai_resampler_destroy(sink->resampler);
+
+  free(sink->ring);
+  free(sink);
+}
+
+// Copies big-endian stereo samples into the ring.
+void ai_sink_push(struct ai_sink *sink, const uint8_t *samples,
+  unsigned frames, unsigned rate) {
+  uint64_t head = sink->head;
+  uint32_t run_head = sink->run_head;
+  unsigned i, space;
+
+  space = AI_SINK_RING_FRAMES - (head - cen64_atomic_load_u64(&sink->tail));
+
+  if (frames > space) {
+    sink->dropped += frames - space;
+    frames = space;
+  }
+
+  if (frames == 0)
+    return;
+
+  // Samples at a new rate start a new run, if there's room for one.
+  if (rate != sink->rate) {
+    if (run_head - cen64_atomic_load_u32(&sink->run_tail) >=
+      AI_SINK_RATE_RUNS) {
+      sink->dropped += frames;
+      return;
+    }
+
+    sink->runs[run_head % AI_SINK_RATE_RUNS].start = head;
+    sink->runs[run_head % AI_SINK_RATE_RUNS].rate = rate;
+    cen64_atomic_store_u32(&sink->run_head, run_head + 1);
+    sink->rate = rate;
+  }
+
+  for (i = 0; i < frames; i++) {
+    int16_t *frame = sink->ring + (head + i) % AI_SINK_RING_FRAMES * 2;
+
+    frame[0] = (int16_t) (samples[i * 4 + 0] << 8 | samples[i * 4 + 1]);
+    frame[1] = (int16_t) (samples[i * 4 + 2] << 8 | samples[i * 4 + 3]);
+  }
+
+  cen64_atomic_store_u64(&sink->head, head + frames);
+  cen64_sleeper_notify(&sink->sleeper);
+}
+
@@ -0,0 +1,101 @@
+//
+// ai/sink.h: Audio sample sinks.
+//
+// CEN64: Cycle-Accurate Nintendo 64 Simulator.
+// Copyright (C) 2014, Tyler J. Stachecki.
+//
+// This file is subject to the terms and conditions defined in
+// 'LICENSE', which is part of this source code package.
+//
+
+#ifndef __ai_sink_h__
+#define __ai_sink_h__
+#include "common.h"
+#include "os/thread.h"
+
+// Stereo sample frames the ring holds (a little over a second's worth).
+#define AI_SINK_RING_FRAMES 0x10000
+
+// When the sink is clocked, it's fed in runs of at most this many frames.
+#define AI_SINK_CLOCK_FRAMES 256
+
+// Rate changes that can be queued up at once. Past that, samples at yet
+// another rate are dropped until the sink thread catches up.
+#define AI_SINK_RATE_RUNS 64
+
+struct ai_resampler;
+struct ai_sink;
+
+// A sink gets handed runs of interleaved (left, right) 16-bit samples
+// in host byte order, along with the rate they're to be played at. If
+// a sink has a rate of its own, samples are resampled to it first.
+struct ai_sink_ops {
+  const char *name;
+  unsigned rate;
+
+  int (*open)(struct ai_sink *sink, const char *arg);
+  void (*close)(struct ai_sink *sink);
+  void (*write)(struct ai_sink *sink, const int16_t *samples,
+    unsigned frames, unsigned rate);
+};
+
+// Frames in the ring from start onwards are played at rate, up until
+// where the next run starts.
+struct ai_sink_run {
+  uint64_t start;
+  unsigned rate;
+};
+
+extern const struct ai_sink_ops ai_null_sink_ops;
+extern const struct ai_sink_ops ai_wav_sink_ops;
+
+// Samples are pushed into a single-producer/single-consumer ring by the
+// thread running the device, and drained by a thread that feeds the
+// sink. The device never waits on the sink: if the ring is full, the
+// samples that don't fit are dropped.
+//
+// If speed is set, the sink thread acts as the DAC would and hands the
+// samples over no faster than they'd play out at that percentage of
+// real time; otherwise, they're handed over as fast as they arrive.
+struct ai_sink {
+  const struct ai_sink_ops *ops;
+  void *data;
+
+  // Used only by the sink thread.
+  struct ai_resampler *resampler;
+
+  cen64_thread thread;
+  struct cen64_sleeper sleeper;
+  int16_t *ring;
+
+  // Used only by the thread running the device. The rate is that of
+  // the samples pushed last.
+  uint64_t dropped;
+  unsigned rate;
+
+  // Written by the thread running the device. A run is added each time
+  // the rate changes, so samples keep the rate they were pushed with.
+  cen64_align(volatile uint64_t head, CACHE_LINE_SIZE);
+  struct ai_sink_run runs[AI_SINK_RATE_RUNS];
+  volatile uint32_t run_head;
+  volatile uint32_t speed;
+  volatile uint32_t exit;
+
+  // Written by the sink thread.
+  cen64_align(volatile uint64_t tail, CACHE_LINE_SIZE);
+  volatile uint32_t run_tail;
+};
+
+cen64_cold struct ai_sink *ai_sink_create(const char *spec);
+cen64_cold void ai_sink_destroy(struct ai_sink *sink);
+
+void ai_sink_push(struct ai_sink *sink, const uint8_t *samples,
+  unsigned frames, unsigned rate);
+
+// Returns the number of frames waiting in the ring.
+static inline unsigned ai_sink_fill(const struct ai_sink *sink) {
+  return sink->head - cen64_atomic_load_u64(&sink->tail);
+}
+
+#endif
+
@@ -0,0 +1,134 @@
+//
+// ai/wav.c: WAV file audio sink.
+//
+// CEN64: Cycle-Accurate Nintendo 64 Simulator.
+// Copyright (C) 2014, Tyler J. Stachecki.
+//
+// This file is subject to the terms and conditions defined in
+// 'LICENSE', which is part of this source code package.
+//
+
+#include "common.h"
+#include "ai/sink.h"
+#include <stdio.h>
+
+#define AI_WAV_HEADER_SIZE 44
+#define AI_WAV_RATE 48000
+#define AI_WAV_BLOCK_FRAMES 1024
+
+struct ai_wav_sink {
+  FILE *file;
+  uint32_t rate;
+  uint32_t frames;
+
+  uint8_t block[AI_WAV_BLOCK_FRAMES * 4];
+};
+
+static int ai_wav_sink_open(struct ai_sink *sink, const char *arg);
+static void ai_wav_sink_close(struct ai_sink *sink);
+static void ai_wav_sink_write(struct ai_sink *sink, const int16_t *samples,
+  unsigned frames, unsigned rate);
+static void ai_wav_write_header(struct ai_wav_sink *wav);
+
+// Writes 16-bit stereo PCM to a file. A WAV file only has the one
+// sample rate, so everything's resampled to 48kHz on the way in.
+const struct ai_sink_ops ai_wav_sink_ops = {
+  "wav",
+  AI_WAV_RATE,
+  ai_wav_sink_open,
+  ai_wav_sink_close,
+  ai_wav_sink_write,
+};
+
+// Creates the file, leaving room for the header.
+int ai_wav_sink_open(struct ai_sink *sink, const char *arg) {
+  struct ai_wav_sink *wav;
+
+  if (arg == NULL || *arg == '\0')
+    return 1;
+
+  if ((wav = (struct ai_wav_sink *) calloc(1, sizeof(*wav))) == NULL)
+    return 1;
+
+  if ((wav->file = fopen(arg, "wb")) == NULL) {
+    free(wav);
+    return 1;
+  }
+
+  ai_wav_write_header(wav);
+  sink->data = wav;
+  return 0;
+}
+
+// Goes back to fill in the header now that the length is known.
+void ai_wav_sink_close(struct ai_sink *sink) {
+  struct ai_wav_sink *wav = (struct ai_wav_sink *) sink->data;
+
+  if (fseek(wav->file, 0, SEEK_SET) == 0)
+    ai_wav_write_header(wav);
+
+  fclose(wav->file);
+  free(wav);
+}
+
+// Appends the samples (as little-endian PCM) to the file.
+void ai_wav_sink_write(struct ai_sink *sink, const int16_t *samples,
+  unsigned frames, unsigned rate) {
+  struct ai_wav_sink *wav = (struct ai_wav_sink *) sink->data;
+
+  if (wav->rate == 0)
+    wav->rate = rate;
+
+  // Stop short of a data chunk longer than the format can describe.
+  if (frames > (0xFFFFFFFFU - AI_WAV_HEADER_SIZE) / 4 - wav->frames)
+    frames = (0xFFFFFFFFU - AI_WAV_HEADER_SIZE) / 4 - wav->frames;
+
+  wav->frames += frames;
+
+  while (frames > 0) {
+    unsigned i, count = frames < AI_WAV_BLOCK_FRAMES
+      ? frames : AI_WAV_BLOCK_FRAMES;
+
+    for (i = 0; i < count * 2; i++) {
+      uint16_t sample = (uint16_t) samples[i];
+
+      wav->block[i * 2 + 0] = sample;
+      wav->block[i * 2 + 1] = sample >> 8;
+    }
+
+    fwrite(wav->block, count * 4, 1, wav->file);
+    samples += count * 2;
+    frames -= count;
+  }
+}
+
+void ai_wav_write_header(struct ai_wav_sink *wav) {
+  uint32_t data_size = wav->frames * 4;
+  uint8_t header[AI_WAV_HEADER_SIZE];
+  uint32_t fields[6];
+  unsigned i;
+
+  fields[0] = AI_WAV_HEADER_SIZE - 8 + data_size;
+  fields[1] = 16;
+  fields[2] = 1 | 2 << 16;
+  fields[3] = wav->rate;
+  fields[4] = wav->rate * 4;
+  fields[5] = 4 | 16 << 16;
+
+  memcpy(header + 0, "RIFF", 4);
+  memcpy(header + 8, "WAVEfmt ", 8);
+  memcpy(header + 36, "data", 4);
+
+  for (i = 0; i < 4; i++) {
+    header[4 + i] = fields[0] >> (i * 8);
+    header[16 + i] = fields[1] >> (i * 8);
+    header[20 + i] = fields[2] >> (i * 8);
+    header[24 + i] = fields[3] >> (i * 8);
+    header[28 + i] = fields[4] >> (i * 8);
+    header[32 + i] = fields[5] >> (i * 8);
+    header[40 + i] = data_size >> (i * 8);
+  }
+
+  fwrite(header, sizeof(header), 1, wav->file);
+}
+
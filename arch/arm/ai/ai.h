@@ -0,0 +1,18 @@
+//
+// arch/arm/ai/ai.h
+//
+// Vector kernels for resampling AI output.
+//
+// This file is subject to the terms and conditions defined in
+// 'LICENSE', which is part of this source code package.
+//
+
+#ifndef __arch_ai_h__
+#define __arch_ai_h__
+#include "common.h"
+
+// There are no NEON kernels yet: leaving AI_VECT_KERNELS undefined
+// has the resampler filter each frame with its scalar kernel.
+
+#endif
+
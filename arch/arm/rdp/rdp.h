@@ -0,0 +1,18 @@
+//
+// arch/arm/rdp/rdp.h
+//
+// Vector kernels for the RDP pixel pipeline.
+//
+// This file is subject to the terms and conditions defined in
+// 'LICENSE', which is part of this source code package.
+//
+
+#ifndef __arch_rdp_h__
+#define __arch_rdp_h__
+#include "common.h"
+
+// There are no NEON kernels yet: leaving RDP_VECT_KERNELS undefined
+// sends the combiner and blender down their scalar reference paths.
+
+#endif
+
@@ -39,6 +39,24 @@ static inline void rsp_vect_write_operand(uint8_t *dest, uint16x8_t src) {
   vst1q_u8(dest, vreinterpretq_u8_u16(src));
 }
 
+// Converts big-endian words in RSP memory to host order, 4 at a time.
+static inline void rsp_byteswap_words(uint32_t *dest,
+  const uint8_t *src, unsigned count) {
+  unsigned i;
+
+  for (i = 0; i + 4 <= count; i += 4) {
+    uint8x16_t words = vrev32q_u8(vld1q_u8(src + i * 4));
+    vst1q_u32(dest + i, vreinterpretq_u32_u8(words));
+  }
+
+  for (; i < count; i++) {
+    uint32_t word;
+
+    memcpy(&word, src + i * 4, sizeof(word));
+    dest[i] = byteswap_32(word);
+  }
+}
+
 #include "arch/arm/rsp/vand.h"
 #include "arch/arm/rsp/vnand.h"
 #include "arch/arm/rsp/vnor.h"
@@ -0,0 +1,18 @@
+//
+// arch/arm/vi/vi.h
+//
+// Vector kernels for converting VI output to host pixel formats.
+//
+// This file is subject to the terms and conditions defined in
+// 'LICENSE', which is part of this source code package.
+//
+
+#ifndef __arch_vi_h__
+#define __arch_vi_h__
+#include "common.h"
+
+// There are no NEON kernels yet: leaving VI_VECT_KERNELS undefined
+// has the software presenter convert pixels one at a time.
+
+#endif
+
@@ -0,0 +1,62 @@
+//
+// arch/x86_64/ai/ai.h
+//
+// Vector kernels for resampling AI output.
+//
+// This file is subject to the terms and conditions defined in
+// 'LICENSE', which is part of this source code package.
+//
+
+#ifndef __arch_ai_h__
+#define __arch_ai_h__
+#include "common.h"
+
+#ifdef __SSE4_2__
+#include <nmmintrin.h>
+#elif defined(__SSE4_1__)
+#include <smmintrin.h>
+#elif defined(__SSSE3__)
+#include <tmmintrin.h>
+#elif defined(__SSE3__)
+#include <pmmintrin.h>
+#else
+#include <emmintrin.h>
+#endif
+
+// Nothing past SSE2 helps here, so every build uses the same kernel.
+#define AI_VECT_KERNELS
+
+// Runs one phase of the filter over 16 interleaved (left, right) frames
+// of history, and writes out the left and right samples. The lanes sum
+// up the even and odd taps of each channel separately; the scalar
+// kernel adds things up in the same order.
+static inline void ai_vect_resample_frame(int16_t *out,
+  const float *history, const float *coeffs) {
+  __m128 acc0 = _mm_mul_ps(_mm_loadu_ps(history + 0),
+    _mm_load_ps(coeffs + 0));
+  __m128 acc1 = _mm_mul_ps(_mm_loadu_ps(history + 4),
+    _mm_load_ps(coeffs + 4));
+  __m128i samples;
+  unsigned i;
+
+  for (i = 8; i < 32; i += 8) {
+    acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(history + i),
+      _mm_load_ps(coeffs + i)));
+    acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(history + i + 4),
+      _mm_load_ps(coeffs + i + 4)));
+  }
+
+  // (L0, R0, L1, R1) + (L1, R1, ...): the low half has the frame.
+  acc0 = _mm_add_ps(acc0, acc1);
+  acc0 = _mm_add_ps(acc0, _mm_movehl_ps(acc0, acc0));
+
+  // Round to the nearest integer, then saturate to 16 bits.
+  samples = _mm_cvtps_epi32(acc0);
+  samples = _mm_packs_epi32(samples, samples);
+
+  out[0] = (int16_t) _mm_extract_epi16(samples, 0);
+  out[1] = (int16_t) _mm_extract_epi16(samples, 1);
+}
+
+#endif
+
@@ -0,0 +1,119 @@
+//
+// arch/x86_64/rdp/rdp.h
+//
+// Vector kernels for the RDP pixel pipeline.
+//
+// This file is subject to the terms and conditions defined in
+// 'LICENSE', which is part of this source code package.
+//
+
+#ifndef __arch_rdp_h__
+#define __arch_rdp_h__
+#include "common.h"
+
+#ifdef __SSE4_2__
+#include <nmmintrin.h>
+#elif defined(__SSE4_1__)
+#include <smmintrin.h>
+#elif defined(__SSSE3__)
+#include <tmmintrin.h>
+#elif defined(__SSE3__)
+#include <pmmintrin.h>
+#else
+#include <emmintrin.h>
+#endif
+
+// SSSE3 has nothing these kernels can use, so such builds (and SSE3
+// builds) share the SSE2 versions; SSE4.1 saves a few instructions.
+#define RDP_VECT_KERNELS
+
+// Evaluates ((A - B) * C + (D << 8) + 0x80) >> 8 across the lanes and
+// clamps the results to 0-255. A - B always fits within 16 bits, but
+// the product doesn't, so it's widened to 32 bits before the sum.
+static inline void rdp_vect_combine(int16_t *out, const int16_t *a,
+  const int16_t *b, const int16_t *c, const int16_t *d) {
+  __m128i diff = _mm_sub_epi16(
+    _mm_load_si128((const __m128i *) a),
+    _mm_load_si128((const __m128i *) b));
+
+  __m128i mul = _mm_load_si128((const __m128i *) c);
+  __m128i add = _mm_load_si128((const __m128i *) d);
+  __m128i zero = _mm_setzero_si128();
+  __m128i round = _mm_set1_epi32(0x80);
+  __m128i prod_lo, prod_hi, add_lo, add_hi, result;
+
+  prod_lo = _mm_mullo_epi16(diff, mul);
+  prod_hi = _mm_mulhi_epi16(diff, mul);
+  diff = _mm_unpacklo_epi16(prod_lo, prod_hi);
+  prod_hi = _mm_unpackhi_epi16(prod_lo, prod_hi);
+  prod_lo = diff;
+
+  // Place D in the upper half of each dword, then shift it back down
+  // arithmetically: that's D << 8 with its sign intact.
+  add_lo = _mm_srai_epi32(_mm_unpacklo_epi16(zero, add), 8);
+  add_hi = _mm_srai_epi32(_mm_unpackhi_epi16(zero, add), 8);
+
+  prod_lo = _mm_add_epi32(_mm_add_epi32(prod_lo, add_lo), round);
+  prod_hi = _mm_add_epi32(_mm_add_epi32(prod_hi, add_hi), round);
+  prod_lo = _mm_srai_epi32(prod_lo, 8);
+  prod_hi = _mm_srai_epi32(prod_hi, 8);
+
+#ifdef __SSE4_1__
+  result = _mm_packus_epi32(prod_lo, prod_hi);
+  result = _mm_min_epu16(result, _mm_set1_epi16(0xFF));
+#else
+  result = _mm_packs_epi32(prod_lo, prod_hi);
+  result = _mm_max_epi16(result, zero);
+  result = _mm_min_epi16(result, _mm_set1_epi16(0xFF));
+#endif
+
+  _mm_store_si128((__m128i *) out, result);
+}
+
+// Evaluates (P * A + M * B) / (A + B) across the lanes, or divides by
+// 0xFF for forced blends. The numerator is at most 2 * 0xFF * 0xFF and
+// the quotient is small, so a single-precision divide and truncation
+// gives the same result as integer division.
+static inline void rdp_vect_blend(int16_t *out, const int16_t *p,
+  const int16_t *m, const int16_t *a, const int16_t *b,
+  const int16_t *enable, bool force) {
+  __m128i pv = _mm_load_si128((const __m128i *) p);
+  __m128i mv = _mm_load_si128((const __m128i *) m);
+  __m128i av = _mm_load_si128((const __m128i *) a);
+  __m128i bv = _mm_load_si128((const __m128i *) b);
+  __m128i en = _mm_load_si128((const __m128i *) enable);
+  __m128i zero = _mm_setzero_si128();
+  __m128i num_lo, num_hi, sum, sum_lo, sum_hi, result, passthrough;
+  __m128 quot_lo, quot_hi;
+
+  num_lo = _mm_madd_epi16(_mm_unpacklo_epi16(pv, mv),
+    _mm_unpacklo_epi16(av, bv));
+  num_hi = _mm_madd_epi16(_mm_unpackhi_epi16(pv, mv),
+    _mm_unpackhi_epi16(av, bv));
+
+  sum = force ? _mm_set1_epi16(0xFF) : _mm_add_epi16(av, bv);
+  sum_lo = _mm_unpacklo_epi16(sum, zero);
+  sum_hi = _mm_unpackhi_epi16(sum, zero);
+
+  // Lanes with a zero divisor produce garbage, but pass through anyway.
+  quot_lo = _mm_div_ps(_mm_cvtepi32_ps(num_lo), _mm_cvtepi32_ps(sum_lo));
+  quot_hi = _mm_div_ps(_mm_cvtepi32_ps(num_hi), _mm_cvtepi32_ps(sum_hi));
+  result = _mm_packs_epi32(_mm_cvttps_epi32(quot_lo),
+    _mm_cvttps_epi32(quot_hi));
+
+  result = _mm_min_epi16(result, _mm_set1_epi16(0xFF));
+  passthrough = _mm_or_si128(_mm_cmpeq_epi16(en, zero),
+    _mm_cmpeq_epi16(sum, zero));
+
+#ifdef __SSE4_1__
+  result = _mm_blendv_epi8(result, pv, passthrough);
+#else
+  result = _mm_or_si128(_mm_and_si128(passthrough, pv),
+    _mm_andnot_si128(passthrough, result));
+#endif
+
+  _mm_store_si128((__m128i *) out, result);
+}
+
+#endif
+
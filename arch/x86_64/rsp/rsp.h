@@ -59,6 +59,37 @@ static inline void rsp_vect_write_operand(uint16_t *dest, __m128i src) {
   _mm_store_si128((__m128i*) dest, src);
 }
 
+// Converts big-endian words in RSP memory to host order, 4 at a time.
+static inline void rsp_byteswap_words(uint32_t *dest,
+  const uint8_t *src, unsigned count) {
+#ifdef __SSSE3__
+  const __m128i keys = _mm_set_epi8(
+    12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3);
+#endif
+  unsigned i;
+
+  for (i = 0; i + 4 <= count; i += 4) {
+    __m128i words = _mm_loadu_si128((__m128i *) (src + i * 4));
+
+#ifdef __SSSE3__
+    words = _mm_shuffle_epi8(words, keys);
+#else
+    words = _mm_or_si128(_mm_slli_epi16(words, 8), _mm_srli_epi16(words, 8));
+    words = _mm_shufflelo_epi16(words, _MM_SHUFFLE(2,3,0,1));
+    words = _mm_shufflehi_epi16(words, _MM_SHUFFLE(2,3,0,1));
+#endif
+
+    _mm_storeu_si128((__m128i *) (dest + i), words);
+  }
+
+  for (; i < count; i++) {
+    uint32_t word;
+
+    memcpy(&word, src + i * 4, sizeof(word));
+    dest[i] = byteswap_32(word);
+  }
+}
+
 // Functions for reading/writing the accumulator.
 //#if ((defined(__GNUC__) && !(defined(__clang__) || defined(__INTEL_COMPILER))) && defined(__x86_64))
 #if 0
@@ -0,0 +1,87 @@
+//
+// arch/x86_64/vi/vi.h
+//
+// Vector kernels for converting VI output to host pixel formats.
+//
+// This file is subject to the terms and conditions defined in
+// 'LICENSE', which is part of this source code package.
+//
+
+#ifndef __arch_vi_h__
+#define __arch_vi_h__
+#include "common.h"
+
+#ifdef __SSE4_2__
+#include <nmmintrin.h>
+#elif defined(__SSE4_1__)
+#include <smmintrin.h>
+#elif defined(__SSSE3__)
+#include <tmmintrin.h>
+#elif defined(__SSE3__)
+#include <pmmintrin.h>
+#else
+#include <emmintrin.h>
+#endif
+
+// The kernels write 32-bit pixels with red in bits 16-23, green in bits
+// 8-15 and blue in bits 0-7 (the usual TrueColor layout).
+#define VI_VECT_KERNELS
+
+// Converts big-endian RGBA5551 pixels, 8 at a time. Each 5-bit channel
+// is widened to 8 bits by replicating its upper bits into the bottom.
+static inline void vi_vect_rgba5551_to_xrgb8888(uint32_t *dest,
+  const uint8_t *src, unsigned count) {
+  __m128i mask = _mm_set1_epi16(0x1F);
+  unsigned i;
+
+  for (i = 0; i < count; i += 8) {
+    __m128i pixels = _mm_loadu_si128((const __m128i *) (src + i * 2));
+    __m128i r, g, b, gb;
+
+    pixels = _mm_or_si128(_mm_slli_epi16(pixels, 8),
+      _mm_srli_epi16(pixels, 8));
+
+    r = _mm_srli_epi16(pixels, 11);
+    g = _mm_and_si128(_mm_srli_epi16(pixels, 6), mask);
+    b = _mm_and_si128(_mm_srli_epi16(pixels, 1), mask);
+
+    r = _mm_or_si128(_mm_slli_epi16(r, 3), _mm_srli_epi16(r, 2));
+    g = _mm_or_si128(_mm_slli_epi16(g, 3), _mm_srli_epi16(g, 2));
+    b = _mm_or_si128(_mm_slli_epi16(b, 3), _mm_srli_epi16(b, 2));
+
+    gb = _mm_or_si128(_mm_slli_epi16(g, 8), b);
+    _mm_storeu_si128((__m128i *) (dest + i), _mm_unpacklo_epi16(gb, r));
+    _mm_storeu_si128((__m128i *) (dest + i + 4), _mm_unpackhi_epi16(gb, r));
+  }
+}
+
+// Converts RGBA8888 pixels (bytes in R, G, B, A order), 4 at a time.
+static inline void vi_vect_rgba8888_to_xrgb8888(uint32_t *dest,
+  const uint8_t *src, unsigned count) {
+#ifdef __SSSE3__
+  __m128i shuffle = _mm_setr_epi8(2, 1, 0, -128, 6, 5, 4, -128,
+    10, 9, 8, -128, 14, 13, 12, -128);
+#else
+  __m128i rb_mask = _mm_set1_epi32(0x00FF00FF);
+  __m128i g_mask = _mm_set1_epi32(0x0000FF00);
+#endif
+  unsigned i;
+
+  for (i = 0; i < count; i += 4) {
+    __m128i pixels = _mm_loadu_si128((const __m128i *) (src + i * 4));
+
+#ifdef __SSSE3__
+    pixels = _mm_shuffle_epi8(pixels, shuffle);
+#else
+    __m128i rb = _mm_and_si128(pixels, rb_mask);
+
+    rb = _mm_or_si128(_mm_slli_epi32(rb, 16), _mm_srli_epi32(rb, 16));
+    pixels = _mm_or_si128(rb, _mm_and_si128(pixels, g_mask));
+#endif
+
+    _mm_storeu_si128((__m128i *) (dest + i), pixels);
+  }
+}
+
+#endif
+
@@ -134,3 +134,75 @@ int bus_write_word(void *component,
   return node->on_write(node->instance, address, word & dqm, dqm);
 }
 
+// Reads a span of words from the bus. The device is resolved once for
+// the whole span; RDRAM is copied out directly and then byteswapped.
+int bus_read_block(void *component,
+  uint32_t address, uint32_t *words, unsigned count) {
+  const struct memory_mapping *node;
+  struct bus_controller *bus;
+  unsigned i;
+
+  memcpy(&bus, component, sizeof(bus));
+
+  if (address < RDRAM_BASE_ADDRESS_LEN &&
+    count <= (RDRAM_BASE_ADDRESS_LEN - address) / 4) {
+    memcpy(words, bus->ri->ram + address, count * sizeof(*words));
+
+    for (i = 0; i < count; i++)
+      words[i] = byteswap_32(words[i]);
+
+    return 0;
+  }
+
+  // Spans that leave the device fall back to individual accesses.
+  if ((node = resolve_mapped_address(&bus->map, address)) == NULL ||
+    count > (node->length - (address - node->start)) / 4) {
+    for (i = 0; i < count; i++)
+      bus_read_word(component, address + i * 4, words + i);
+
+    return 0;
+  }
+
+  for (i = 0; i < count; i++)
+    node->on_read(node->instance, address + i * 4, words + i);
+
+  return 0;
+}
+
+// Writes a span of whole words to the bus. The device is resolved
+// once for the whole span; RDRAM is byteswapped and copied in directly.
+int bus_write_block(void *component,
+  uint32_t address, const uint32_t *words, unsigned count) {
+  const struct memory_mapping *node;
+  struct bus_controller *bus;
+  unsigned i;
+
+  memcpy(&bus, component, sizeof(bus));
+
+  if (address < RDRAM_BASE_ADDRESS_LEN &&
+    count <= (RDRAM_BASE_ADDRESS_LEN - address) / 4) {
+    uint8_t *ram = bus->ri->ram + address;
+
+    for (i = 0; i < count; i++) {
+      uint32_t word = byteswap_32(words[i]);
+      memcpy(ram + i * 4, &word, sizeof(word));
+    }
+
+    return 0;
+  }
+
+  // Spans that leave the device fall back to individual accesses.
+  if ((node = resolve_mapped_address(&bus->map, address)) == NULL ||
+    count > (node->length - (address - node->start)) / 4) {
+    for (i = 0; i < count; i++)
+      bus_write_word(component, address + i * 4, words[i], ~0U);
+
+    return 0;
+  }
+
+  for (i = 0; i < count; i++)
+    node->on_write(node->instance, address + i * 4, words[i], ~0U);
+
+  return 0;
+}
+
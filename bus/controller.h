@@ -25,6 +25,8 @@ struct rdp;
 struct rsp;
 struct vr4300;
 
+struct scheduler;
+
 struct bus_controller {
   struct ai_controller *ai;
   struct dd_controller *dd;
@@ -37,6 +39,9 @@ struct bus_controller {
   struct rsp *rsp;
   struct vr4300 *vr4300;
 
+  // Timed events (and the current time) for the whole device.
+  struct scheduler *scheduler;
+
   // For resolving physical address ranges to devices.
   struct memory_map map;
 
@@ -55,11 +60,12 @@ cen64_flatten cen64_hot int bus_read_word(void *component,
 cen64_flatten cen64_hot int bus_write_word(void *component,
   uint32_t address, uint32_t word, uint32_t dqm);
 
-// For asserting and deasserting RCP interrupts.
-enum rcp_interrupt_mask;
+// Block transfers (cache lines, DMA) of whole words.
+cen64_hot int bus_read_block(void *component,
+  uint32_t address, uint32_t *words, unsigned count);
 
-int raise_rcp_interrupt(struct bus_controller *bus,
-  enum rcp_interrupt_mask mask);
+cen64_hot int bus_write_block(void *component,
+  uint32_t address, const uint32_t *words, unsigned count);
 
 #endif
 
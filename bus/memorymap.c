@@ -11,205 +11,115 @@
 #include "common.h"
 #include "memorymap.h"
 
-static void fixup(struct memory_map *, struct memory_map_node *);
-static void rotate_left(struct memory_map *, struct memory_map_node *);
-static void rotate_right(struct memory_map *, struct memory_map_node *);
+static int map_granules(struct memory_map *map, uint8_t *subtable,
+  unsigned index, uint32_t start, uint32_t end);
+static int split_page(struct memory_map *map, unsigned page);
 
 // Creates a new memory map.
 void create_memory_map(struct memory_map *map) {
+  memset(map, 0, sizeof(*map));
   map->next_map_index = 1;
-  map->nil = map->mappings;
-  map->root = map->nil;
 }
 
-// Rebalances the tree after a node is inserted.
-void fixup(struct memory_map *map, struct memory_map_node *node) {
-  struct memory_map_node *cur;
-
-  // Rebalance the whole tree as needed. 
-  while (node->parent->color == MEMORY_MAP_RED) {
-    if (node->parent == node->parent->parent->left) {
-      cur = node->parent->parent->right;
-
-      // Case 1: We only need to update colors.
-      if (cur->color == MEMORY_MAP_RED) {
-        node->parent->color = MEMORY_MAP_BLACK;
-        cur->color = MEMORY_MAP_BLACK;
-        node->parent->parent->color = MEMORY_MAP_RED;
-        node = node->parent->parent;
-      }
-
-      else {
-
-        // Case 2: We need to perform a left rotation.
-        if (node == node->parent->right) {
-          node = node->parent;
-          rotate_left(map, node);
-        }
-
-        // Case 3: We need to perform a right rotation.
-        node->parent->color = MEMORY_MAP_BLACK;
-        node->parent->parent->color = MEMORY_MAP_RED;
-        rotate_right(map, node->parent->parent);
-      }
-    }
-
-    else {
-      cur = node->parent->parent->left;
-
-      // Case 1: We only need to update colors.
-      if (cur->color == MEMORY_MAP_RED) {
-        node->parent->color = MEMORY_MAP_BLACK;
-        cur->color = MEMORY_MAP_BLACK;
-        node->parent->parent->color = MEMORY_MAP_RED;
-        node = node->parent->parent;
-      }
-
-      else {
-
-        // Case 2: We need to perform a right rotation.
-        if (node == node->parent->left) {
-          node = node->parent;
-          rotate_right(map, node);
-        }
-
-        // Case 3: We need to perform a left rotation.
-        node->parent->color = MEMORY_MAP_BLACK;
-        node->parent->parent->color = MEMORY_MAP_RED;
-        rotate_left(map, node->parent->parent);
-      }
-    }
-  }
-
-  // When we rebalanced the tree, we might have accidentally colored
-  // the root red, so unconditionally color if back after rebalancing.
-  map->root->color = MEMORY_MAP_BLACK;
-}
-
-// Inserts a mapping into the tree.
+// Inserts a mapping into the tables.
 int map_address_range(struct memory_map *map, uint32_t start, uint32_t length,
   void *instance, memory_rd_function on_read, memory_wr_function on_write) {
-  struct memory_map_node *check = map->root;
-  struct memory_map_node *cur = map->nil;
+  const uint32_t page_mask = (1U << MEMORY_MAP_PAGE_SHIFT) - 1;
   uint32_t end = start + length - 1;
-
-  struct memory_map_node *new_node;
-  struct memory_mapping mapping;
+  struct memory_mapping *mapping;
+  unsigned index, page;
 
   // Make sure we have enough space in the map.
   const unsigned num_mappings = sizeof(map->mappings) /
-    sizeof(map->mappings[0]) - 1;
+    sizeof(map->mappings[0]);
 
   if (unlikely(map->next_map_index >= num_mappings)) {
     debug("map_address_range: Out of free mappings.");
     return 1;
   }
 
-  new_node =  &map->mappings[map->next_map_index++];
-
-  // Walk down the tree.
-  while (check != map->nil) {
-    cur = check;
-
-    check = (start < cur->mapping.start)
-      ? check->left : check->right;
-  }
-
-  // Insert the entry.
-  if (cur == map->nil)
-    map->root = new_node;
-
-  else if (start < cur->mapping.start)
-    cur->left = new_node;
-  else
-    cur->right = new_node;
-
-  new_node->left = map->nil;
-  new_node->right = map->nil;
-  new_node->parent = cur;
+  index = map->next_map_index++;
+  mapping = map->mappings + index;
 
   // Initialize the entry.
-  mapping.instance = instance;
-  mapping.on_read = on_read;
-  mapping.on_write = on_write;
-
-  mapping.end = end;
-  mapping.length = length;
-  mapping.start = start;
-
-  new_node->mapping = mapping;
-
-  // Rebalance the tree.
-  new_node->color = MEMORY_MAP_RED;
-  fixup(map, new_node);
-  return 0;
-}
+  mapping->instance = instance;
+  mapping->on_read = on_read;
+  mapping->on_write = on_write;
+
+  mapping->end = end;
+  mapping->length = length;
+  mapping->start = start;
+
+  // Point each page the region touches at it.
+  for (page = start >> MEMORY_MAP_PAGE_SHIFT;
+    page <= end >> MEMORY_MAP_PAGE_SHIFT; page++) {
+    uint32_t page_start = page << MEMORY_MAP_PAGE_SHIFT;
+    uint32_t lo = start > page_start ? start : page_start;
+    uint32_t hi = end < (page_start | page_mask) ? end : page_start | page_mask;
+    unsigned entry = map->pages[page];
+
+    if (entry == 0) {
+      map->pages[page] = index;
+      continue;
+    }
 
-// Returns a pointer to a region given an address.
-const struct memory_mapping *resolve_mapped_address(
-  const struct memory_map *map, uint32_t address) {
-  const struct memory_map_node *cur = map->root;
+    // Someone's already here; share the page if we don't overlap.
+    if (!(entry & MEMORY_MAP_SUBTABLE)) {
+      if (split_page(map, page))
+        return 1;
 
-  do {
-    if (address < cur->mapping.start)
-      cur = cur->left;
-    else if (address > cur->mapping.end)
-      cur = cur->right;
+      entry = map->pages[page];
+    }
 
-    else
-      return &cur->mapping;
-  } while (cur != map->nil);
+    if (map_granules(map, map->subtables[entry & ~MEMORY_MAP_SUBTABLE],
+      index, lo, hi))
+      return 1;
+  }
 
-  return NULL;
+  return 0;
 }
 
-// Performs a left rotation centered at n.
-static void rotate_left(struct memory_map *map, struct memory_map_node *n) {
-  struct memory_map_node *y = n->right;
-
-  // Turn y's left subtree into n's right subtree.
-  n->right = y->left;
+// Points a range of granules within a page at a region.
+int map_granules(struct memory_map *map, uint8_t *subtable,
+  unsigned index, uint32_t start, uint32_t end) {
+  const unsigned granule_mask = MEMORY_MAP_NUM_GRANULES - 1;
+  unsigned first = start >> MEMORY_MAP_GRANULE_SHIFT & granule_mask;
+  unsigned last = end >> MEMORY_MAP_GRANULE_SHIFT & granule_mask;
+  unsigned i;
 
-  if (y->left != map->nil)
-    y->left->parent = n;
+  for (i = first; i <= last; i++) {
+    if (subtable[i] != 0) {
+      debug("map_address_range: Region at 0x%.8X overlaps another.\n",
+        map->mappings[index].start);
 
-  // Link n's parent to y.
-  y->parent = n->parent;
+      return 1;
+    }
 
-  if (n->parent == map->nil)
-    map->root = y;
-  else if (n == n->parent->left)
-    n->parent->left = y;
-  else
-    n->parent->right = y;
+    subtable[i] = index;
+  }
 
-  // Put n on y's left.
-  y->left = n;
-  n->parent = y;
+  return 0;
 }
 
-// Performs a right rotation centered at n.
-static void rotate_right(struct memory_map *map, struct memory_map_node *n) {
-  struct memory_map_node *y = n->left;
-
-  // Turn y's right subtree into n's left subtree.
-  n->left = y->right;
+// Gives a page that belongs to one region a table of granules.
+int split_page(struct memory_map *map, unsigned page) {
+  const uint32_t page_mask = (1U << MEMORY_MAP_PAGE_SHIFT) - 1;
+  uint32_t page_start = page << MEMORY_MAP_PAGE_SHIFT;
+  unsigned index = map->pages[page];
+  const struct memory_mapping *mapping = map->mappings + index;
+  uint32_t lo, hi;
 
-  if (y->right != map->nil)
-    y->right->parent = n;
-
-  // Link n's parent to y.
-  y->parent = n->parent;
+  if (unlikely(map->next_subtable_index >= MEMORY_MAP_NUM_SUBTABLES)) {
+    debug("map_address_range: Out of free granule tables.\n");
+    return 1;
+  }
 
-  if (n->parent == map->nil)
-    map->root = y;
-  else if (n == n->parent->left)
-    n->parent->left = y;
-  else
-    n->parent->right = y;
+  lo = mapping->start > page_start ? mapping->start : page_start;
+  hi = mapping->end < (page_start | page_mask)
+    ? mapping->end : page_start | page_mask;
 
-  // Put n on y's right.
-  y->right = n;
-  n->parent = y;
+  map->pages[page] = map->next_subtable_index++ | MEMORY_MAP_SUBTABLE;
+  return map_granules(map, map->subtables[map->pages[page] &
+    ~MEMORY_MAP_SUBTABLE], index, lo, hi);
 }
 
@@ -12,15 +12,24 @@
 #define __bus_memory_map_h__
 #include "common.h"
 
+// The physical address space is carved up into 64KiB pages, each of
+// which maps to a single region. Pages that are shared by more than
+// one region get split up further into 64 byte granules.
+#define MEMORY_MAP_PAGE_SHIFT 16
+#define MEMORY_MAP_GRANULE_SHIFT 6
+
+#define MEMORY_MAP_NUM_PAGES (1U << (32 - MEMORY_MAP_PAGE_SHIFT))
+#define MEMORY_MAP_NUM_GRANULES \
+  (1U << (MEMORY_MAP_PAGE_SHIFT - MEMORY_MAP_GRANULE_SHIFT))
+
+// Page entries with this bit set refer to a granule table.
+#define MEMORY_MAP_SUBTABLE 0x80
+#define MEMORY_MAP_NUM_SUBTABLES 4
+
 // Callback functions to handle reads/writes.
 typedef int (*memory_rd_function)(void *, uint32_t, uint32_t *);
 typedef int (*memory_wr_function)(void *, uint32_t, uint32_t, uint32_t);
 
-enum memory_map_color {
-  MEMORY_MAP_BLACK,
-  MEMORY_MAP_RED
-};
-
 struct memory_mapping {
   void *instance;
 
@@ -32,21 +41,14 @@ struct memory_mapping {
   uint32_t end;
 };
 
-struct memory_map_node {
-  struct memory_map_node *left;
-  struct memory_map_node *parent;
-  struct memory_map_node *right;
-
-  struct memory_mapping mapping;
-  enum memory_map_color color;
-};
-
 struct memory_map {
-  struct memory_map_node mappings[21];
-
-  struct memory_map_node *nil;
-  struct memory_map_node *root;
+  // Entry 0 is never mapped: it's what unused table entries point to.
+  struct memory_mapping mappings[21];
   unsigned next_map_index;
+  unsigned next_subtable_index;
+
+  uint8_t subtables[MEMORY_MAP_NUM_SUBTABLES][MEMORY_MAP_NUM_GRANULES];
+  uint8_t pages[MEMORY_MAP_NUM_PAGES];
 };
 
 cen64_cold void create_memory_map(struct memory_map *map);
@@ -55,8 +57,23 @@ cen64_cold int map_address_range(struct memory_map *memory_map,
   uint32_t start, uint32_t length, void *instance,
   memory_rd_function on_read, memory_wr_function on_write);
 
-cen64_hot const struct memory_mapping* resolve_mapped_address(
-  const struct memory_map *memory_map, uint32_t address);
+// Returns a pointer to a region given an address.
+static inline const struct memory_mapping *resolve_mapped_address(
+  const struct memory_map *map, uint32_t address) {
+  const struct memory_mapping *mapping;
+  unsigned index = map->pages[address >> MEMORY_MAP_PAGE_SHIFT];
+
+  if (unlikely(index & MEMORY_MAP_SUBTABLE)) {
+    index = map->subtables[index & ~MEMORY_MAP_SUBTABLE][(address >>
+      MEMORY_MAP_GRANULE_SHIFT) & (MEMORY_MAP_NUM_GRANULES - 1)];
+  }
+
+  // Regions needn't fill their page (or granule) out.
+  mapping = map->mappings + index;
+
+  return address - mapping->start < mapping->length
+    ? mapping : NULL;
+}
 
 #endif
 
@@ -0,0 +1,137 @@
+//
+// device/benchmark.c: Headless benchmark mode.
+//
+// CEN64: Cycle-Accurate Nintendo 64 Simulator.
+// Copyright (C) 2014, Tyler J. Stachecki.
+//
+// This file is subject to the terms and conditions defined in
+// 'LICENSE', which is part of this source code package.
+//
+
+#include "common.h"
+#include "device/benchmark.h"
+#include "device/device.h"
+#include "device/scheduler.h"
+#include "os/timer.h"
+
+// Snapshots the device counters and arms the VI frame limit.
+void benchmark_start(struct benchmark *benchmark,
+  struct cen64_device *device, unsigned frames) {
+  benchmark->start_vr4300_cycles = device->scheduler.now;
+  benchmark->start_vr4300_idle_cycles = device->vr4300.pipeline.idle_cycles;
+  benchmark->start_vr4300_skipped_cycles = device->vr4300.idle.skipped_cycles;
+  benchmark->start_rsp_active_cycles = device->rsp.active_cycles;
+  benchmark->start_frames = device->vi.frame_count;
+  rdp_collect_counters(&device->rdp, &benchmark->start_rdp);
+
+  device->vi.frame_limit = device->vi.frame_count + frames;
+
+  benchmark->start_host_cycles = get_host_cycles();
+  get_time(&benchmark->start_time);
+}
+
+// Prints the results of a benchmark run to stdout as JSON.
+void benchmark_report(const struct benchmark *benchmark,
+  const struct cen64_device *device, unsigned frames) {
+  uint64_t host_cycles, rcp_cycles, vr4300_cycles, vr4300_insns;
+  uint64_t frames_run, rsp_cycles, skipped_cycles, lookups;
+  struct rdp_counters rdp;
+  unsigned long long ns;
+  cen64_time end_time;
+  double secs, per_frame;
+  unsigned i;
+
+  host_cycles = get_host_cycles() - benchmark->start_host_cycles;
+  get_time(&end_time);
+
+  ns = compute_time_difference(&end_time, &benchmark->start_time);
+  secs = ns > 0 ? (double) ns / NS_PER_SEC : 1e-9;
+
+  vr4300_cycles = device->scheduler.now - benchmark->start_vr4300_cycles;
+  vr4300_insns = vr4300_cycles - (device->vr4300.pipeline.idle_cycles -
+    benchmark->start_vr4300_idle_cycles);
+
+  rcp_cycles = scheduler_vr4300_to_rcp(device->scheduler.now) -
+    scheduler_vr4300_to_rcp(benchmark->start_vr4300_cycles);
+  skipped_cycles = device->vr4300.idle.skipped_cycles -
+    benchmark->start_vr4300_skipped_cycles;
+
+  rsp_cycles = device->rsp.active_cycles - benchmark->start_rsp_active_cycles;
+  frames_run = device->vi.frame_count - benchmark->start_frames;
+  per_frame = frames_run > 0 ? 1.0 / frames_run : 0.0;
+
+  // The renderers have all been stopped (and tallied up) by now.
+  rdp = device->rdp.counters;
+  rdp.primitives -= benchmark->start_rdp.primitives;
+
+  for (i = 0; i < 4; i++)
+    rdp.pixels[i] -= benchmark->start_rdp.pixels[i];
+
+  rdp.texels -= benchmark->start_rdp.texels;
+  rdp.texcache_hits -= benchmark->start_rdp.texcache_hits;
+  rdp.texcache_misses -= benchmark->start_rdp.texcache_misses;
+  rdp.host_ns -= benchmark->start_rdp.host_ns;
+  lookups = rdp.texcache_hits + rdp.texcache_misses;
+
+  printf("{\n"
+    "  \"frames\": %llu,\n"
+    "  \"completed\": %s,\n"
+    "  \"wall_time\": %.6f,\n"
+    "  \"vi_per_second\": %.3f,\n"
+    "  \"vr4300_cycles\": %llu,\n"
+    "  \"vr4300_mips\": %.3f,\n"
+    "  \"vr4300_skipped_cycles\": %llu,\n"
+    "  \"rsp_active_ratio\": %.6f,\n",
+
+    (unsigned long long) frames_run,
+    frames_run >= frames ? "true" : "false",
+    secs,
+    frames_run / secs,
+    (unsigned long long) vr4300_cycles,
+    vr4300_insns / secs / 1e6,
+    (unsigned long long) skipped_cycles,
+    rcp_cycles > 0 ? (double) rsp_cycles / rcp_cycles : 0.0
+  );
+
+  printf(
+    "  \"rdp_primitives_per_frame\": %.1f,\n"
+    "  \"rdp_1cycle_pixels_per_frame\": %.1f,\n"
+    "  \"rdp_2cycle_pixels_per_frame\": %.1f,\n"
+    "  \"rdp_copy_pixels_per_frame\": %.1f,\n"
+    "  \"rdp_fill_pixels_per_frame\": %.1f,\n"
+    "  \"rdp_texels_per_frame\": %.1f,\n"
+    "  \"rdp_host_ms_per_frame\": %.3f,\n"
+    "  \"rdp_host_share\": %.6f,\n",
+
+    rdp.primitives * per_frame,
+    rdp.pixels[RDP_CYCLE_TYPE_1CYCLE] * per_frame,
+    rdp.pixels[RDP_CYCLE_TYPE_2CYCLE] * per_frame,
+    rdp.pixels[RDP_CYCLE_TYPE_COPY] * per_frame,
+    rdp.pixels[RDP_CYCLE_TYPE_FILL] * per_frame,
+    rdp.texels * per_frame,
+    rdp.host_ns * per_frame / 1e6,
+    ns > 0 ? (double) rdp.host_ns / ns : 0.0
+  );
+
+  // Without a texture cache (or textures), there's no hit rate.
+  if (lookups > 0) {
+    printf("  \"rdp_texcache_hit_rate\": %.6f,\n",
+      (double) rdp.texcache_hits / lookups);
+  }
+
+  else
+    printf("  \"rdp_texcache_hit_rate\": null,\n");
+
+  // Not every host has a cycle counter to offer.
+  if (host_cycles > 0 && vr4300_cycles > 0) {
+    printf("  \"host_cycles_per_cycle\": %.3f\n",
+      (double) host_cycles / vr4300_cycles);
+  }
+
+  else
+    printf("  \"host_cycles_per_cycle\": null\n");
+
+  printf("}\n");
+  fflush(stdout);
+}
+
@@ -0,0 +1,38 @@
+//
+// device/benchmark.h: Headless benchmark mode.
+//
+// CEN64: Cycle-Accurate Nintendo 64 Simulator.
+// Copyright (C) 2014, Tyler J. Stachecki.
+//
+// This file is subject to the terms and conditions defined in
+// 'LICENSE', which is part of this source code package.
+//
+
+#ifndef __device_benchmark_h__
+#define __device_benchmark_h__
+#include "common.h"
+#include "os/timer.h"
+#include "rdp/state.h"
+
+struct cen64_device;
+
+struct benchmark {
+  cen64_time start_time;
+  uint64_t start_host_cycles;
+
+  uint64_t start_vr4300_cycles;
+  uint64_t start_vr4300_idle_cycles;
+  uint64_t start_vr4300_skipped_cycles;
+  uint64_t start_rsp_active_cycles;
+  uint64_t start_frames;
+
+  struct rdp_counters start_rdp;
+};
+
+cen64_cold void benchmark_start(struct benchmark *benchmark,
+  struct cen64_device *device, unsigned frames);
+cen64_cold void benchmark_report(const struct benchmark *benchmark,
+  const struct cen64_device *device, unsigned frames);
+
+#endif
+
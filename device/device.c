@@ -12,8 +12,11 @@
 #include <stddef.h>
 #include <stdlib.h>
 #include "common.h"
+#include "device/benchmark.h"
 #include "device/device.h"
 #include "device/netapi.h"
+#include "device/pacer.h"
+#include "device/scheduler.h"
 #include "fpu/fpu.h"
 #include "os/gl_window.h"
 #include "os/rom_file.h"
@@ -24,13 +27,23 @@
 #include "pi/controller.h"
 #include "ri/controller.h"
 #include "si/controller.h"
+#include "rsp/cp0.h"
 #include "rsp/cpu.h"
 #include "vi/controller.h"
+#include "vi/dump.h"
+#include "vi/hash.h"
 #include "vr4300/cpu.h"
 #include "vr4300/cp1.h"
 
 cen64_cold static int device_debug_spin(struct cen64_device *device);
 cen64_flatten cen64_hot static int device_spin(struct cen64_device *device);
+cen64_flatten cen64_hot static int device_spin_threaded(
+  struct cen64_device *device);
+
+cen64_flatten cen64_hot static void device_spin_vr4300(
+  struct cen64_device *device);
+cen64_flatten cen64_hot static void device_spin_running(
+  struct cen64_device *device);
 
 // Creates and initializes a device.
 struct cen64_device *device_create(struct cen64_device *device, uint8_t *ram,
@@ -49,6 +62,9 @@ struct cen64_device *device_create(struct cen64_device *device, uint8_t *ram,
   device->bus.rsp = &device->rsp;
   device->bus.vr4300 = &device->vr4300;
 
+  device->bus.scheduler = &device->scheduler;
+  scheduler_init(&device->scheduler);
+
   // Initialize the bus.
   if (bus_init(&device->bus)) {
     debug("create_device: Failed to initialize the bus.\n");
@@ -116,6 +132,7 @@ struct cen64_device *device_create(struct cen64_device *device, uint8_t *ram,
 
 // Cleans up memory allocated for the device.
 void device_destroy(struct cen64_device *device) {
+  rdp_destroy(&device->rdp);
   rsp_destroy(&device->rsp);
 }
 
@@ -127,6 +144,8 @@ void device_exit(struct bus_controller *bus) {
 
 // Create a device and proceed to the main loop.
 void device_run(struct cen64_device *device) {
+  struct benchmark benchmark;
+  struct pacer pacer;
   fpu_state_t saved_fpu_state;
 
   // TODO: Preserve host registers pinned to the device.
@@ -134,40 +153,172 @@ void device_run(struct cen64_device *device) {
   vr4300_cp1_init(&device->vr4300);
   rsp_late_init(&device->rsp);
 
+  if (device->audio_sink != NULL &&
+    ai_sink_start(&device->ai, device->audio_sink))
+    printf("Failed to open the audio sink: %s\n", device->audio_sink);
+
+  if (device->rdp_threads > 1 &&
+    rdp_workers_start(&device->rdp, device->rdp_threads))
+    debug("device_run: Failed to start the RDP workers.\n");
+
+  if (device->rdp_capture_path != NULL &&
+    rdp_capture_start(&device->rdp, device->rdp_capture_path))
+    debug("device_run: Failed to start the RDP capture.\n");
+
+  if (device->dump_frames_target != NULL &&
+    vi_dump_start(&device->vi, device->dump_frames_target))
+    printf("Failed to open the frame dump: %s\n", device->dump_frames_target);
+
+  if (device->hash_frames_path != NULL &&
+    vi_hash_log_start(&device->vi, device->hash_frames_path))
+    printf("Failed to open the frame hash log: %s\n", device->hash_frames_path);
+
+  // Captures need every command to have run by the time the next one
+  // is read, so they keep the RDP on this thread.
+  if (device->rdp_async && device->rdp.capture == NULL &&
+    rdp_thread_start(&device->rdp))
+    debug("device_run: Failed to start the RDP thread.\n");
+
+  if (device->speed > 0)
+    pacer_start(&pacer, device, device->speed, device->pace_audio);
+
+  if (device->benchmark_frames > 0)
+    benchmark_start(&benchmark, device, device->benchmark_frames);
+
   // Spin the device until we return (from setjmp).
   if (unlikely(device->debug_sfd > 0))
     device_debug_spin(device);
 
+  else if (device->rsp_thread_window > 0 &&
+    !rsp_thread_start(&device->rsp, device->rsp_thread_window)) {
+    device_spin_threaded(device);
+    rsp_thread_stop(&device->rsp);
+  }
+
   else
     device_spin(device);
 
+  if (device->speed > 0)
+    pacer_stop(&pacer, device);
+
+  rdp_thread_stop(&device->rdp);
+  rdp_workers_stop(&device->rdp);
+  rdp_capture_stop(&device->rdp);
+  vi_dump_stop(&device->vi);
+  vi_hash_log_stop(&device->vi);
+  ai_sink_stop(&device->ai);
+
+  if (device->benchmark_frames > 0)
+    benchmark_report(&benchmark, device, device->benchmark_frames);
+
   // TODO: Restore host registers that were pinned.
   fpu_set_state(saved_fpu_state);
 }
 
 // Continually cycles the device until setjmp returns.
+//
+// Each trip through the loop runs the VR4300 (and the RSP, if it has
+// a slot on this cycle) up until the next scheduled event, which is
+// then serviced at the tail of the loop. The fast paths leave off
+// just after cycling the VR4300 for the cycle that hit the deadline.
 int device_spin(struct cen64_device *device) {
+  struct scheduler *scheduler = &device->scheduler;
+
   if (setjmp(device->bus.unwind_data))
     return 1;
 
   while (1) {
-    unsigned i;
+    if (device->rsp.regs[RSP_CP0_REGISTER_SP_STATUS] & SP_STATUS_HALT)
+      device_spin_vr4300(device);
 
-    for (i = 0; i < 2; i++) {
+    else if (scheduler->now % 3 == 0)
+      device_spin_running(device);
+
+    else
       vr4300_cycle(&device->vr4300);
+
+    if (scheduler->now % 3 != 2)
       rsp_cycle(&device->rsp);
-      vi_cycle(&device->vi);
 
-    }
+    if (unlikely(scheduler->now >= scheduler->deadline))
+      scheduler_dispatch(scheduler);
 
-    vr4300_cycle(&device->vr4300);
+    scheduler->now++;
+  }
+
+  return 0;
+}
+
+// Continually cycles the device until setjmp returns.
+// The RSP is cycled by its own thread, so only service events here.
+int device_spin_threaded(struct cen64_device *device) {
+  struct scheduler *scheduler = &device->scheduler;
+
+  if (setjmp(device->bus.unwind_data))
+    return 1;
+
+  while (1) {
+    device_spin_vr4300(device);
+    scheduler_dispatch(scheduler);
+    scheduler->now++;
   }
 
   return 0;
 }
 
+// Cycles the VR4300 alone until something needs servicing.
+void device_spin_vr4300(struct cen64_device *device) {
+  struct scheduler *scheduler = &device->scheduler;
+
+  while (1) {
+    vr4300_cycle(&device->vr4300);
+
+    if (unlikely(scheduler->now >= scheduler->deadline))
+      break;
+
+    scheduler->now++;
+  }
+}
+
+// Cycles the VR4300 and RSP at a 3:2 ratio until something needs
+// servicing or the RSP halts. Must be entered on a multiple of 3.
+void device_spin_running(struct cen64_device *device) {
+  struct scheduler *scheduler = &device->scheduler;
+  struct rsp *rsp = &device->rsp;
+
+  while (1) {
+    vr4300_cycle(&device->vr4300);
+
+    if (unlikely(scheduler->now >= scheduler->deadline))
+      break;
+
+    rsp_cycle(rsp);
+    scheduler->now++;
+
+    vr4300_cycle(&device->vr4300);
+
+    if (unlikely(scheduler->now >= scheduler->deadline))
+      break;
+
+    rsp_cycle(rsp);
+    scheduler->now++;
+
+    vr4300_cycle(&device->vr4300);
+
+    if (unlikely(scheduler->now >= scheduler->deadline))
+      break;
+
+    // Drop down to the halted loop if the RSP hit a BREAK, etc.
+    if (rsp->regs[RSP_CP0_REGISTER_SP_STATUS] & SP_STATUS_HALT)
+      break;
+
+    scheduler->now++;
+  }
+}
+
 // Continually cycles the device until setjmp returns.
 int device_debug_spin(struct cen64_device *device) {
+  struct scheduler *scheduler = &device->scheduler;
   struct vr4300_stats vr4300_stats;
 
   // Prepare stats, set a breakpoint @ VR4300 IPL vector.
@@ -178,19 +329,16 @@ int device_debug_spin(struct cen64_device *device) {
     return 1;
 
   while (1) {
-    unsigned i;
+    vr4300_cycle(&device->vr4300);
 
-    for (i = 0; i < 2; i++) {
-      vr4300_cycle(&device->vr4300);
+    if (scheduler->now % 3 != 2)
       rsp_cycle(&device->rsp);
-      vi_cycle(&device->vi);
-
-      vr4300_cycle_extra(&device->vr4300, &vr4300_stats);
 
-    }
+    if (scheduler->now >= scheduler->deadline)
+      scheduler_dispatch(scheduler);
 
-    vr4300_cycle(&device->vr4300);
     vr4300_cycle_extra(&device->vr4300, &vr4300_stats);
+    scheduler->now++;
   }
 
   return 0;
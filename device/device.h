@@ -12,6 +12,7 @@
 #define __device_h__
 #include "common.h"
 #include "options.h"
+#include "device/scheduler.h"
 #include "os/rom_file.h"
 
 #include "ai/controller.h"
@@ -32,6 +33,7 @@ extern bool device_exit_requested;
 
 struct cen64_device {
   struct bus_controller bus;
+  struct scheduler scheduler;
   struct vr4300 vr4300;
 
   struct ai_controller ai;
@@ -44,6 +46,35 @@ struct cen64_device {
   struct rdp rdp;
   struct rsp rsp;
   int debug_sfd;
+
+  // Nonzero if the RSP should be run on its own thread.
+  unsigned rsp_thread_window;
+
+  // If set, names the sink that audio samples get handed off to.
+  const char *audio_sink;
+
+  // Speed to run at, as a percentage of real time (0 if unlimited), and
+  // whether to go by the audio sink rather than the host's clock.
+  unsigned speed;
+  bool pace_audio;
+
+  // Number of threads to rasterize on (counting the RDP's own).
+  unsigned rdp_threads;
+
+  // Set if RDP commands should be rendered on their own thread.
+  bool rdp_async;
+
+  // If set, RDP command lists get captured to this file.
+  const char *rdp_capture_path;
+
+  // If set, VI frames get dumped to this path (or file descriptor).
+  const char *dump_frames_target;
+
+  // If set, the hash of each VI frame gets logged to this path.
+  const char *hash_frames_path;
+
+  // Nonzero if running a fixed number of frames for timing.
+  unsigned benchmark_frames;
 };
 
 cen64_cold void device_destroy(struct cen64_device *device);
@@ -10,18 +10,38 @@
 
 #include "common.h"
 #include "options.h"
+#include "os/thread.h"
+#include <ctype.h>
+
+#define DEFAULT_RSP_THREAD_WINDOW 8192
+#define MAX_DEFAULT_RDP_THREADS 8
 
 const struct cen64_options default_cen64_options = {
   NULL, // ddipl_path
   NULL, // ddrom_path
   NULL, // pifrom_path
   NULL, // cart_path
+  NULL, // audio_sink
   NULL, // debugger_addr
+  NULL, // rdp_capture_path
+  NULL, // dump_frames_target
+  NULL, // hash_frames_path
 #ifdef _WIN32
   false, // console
 #endif
   false, // enable_debugger
   false, // no_interface
+  false, // pace_audio
+  false, // rdp_async
+#ifdef CEN64_OPENGL
+  false, // software_presenter
+#else
+  true, // software_presenter
+#endif
+  0, // rsp_thread_window
+  0, // rdp_threads
+  0, // benchmark_frames
+  0, // speed
 };
 
 // Parses the passed command line arguments.
@@ -37,7 +57,28 @@ int parse_options(struct cen64_options *options, int argc, const char *argv[]) {
     else
 #endif
 
-    if (!strcmp(argv[i], "-debug")) {
+    if (!strcmp(argv[i], "-audio")) {
+      if ((i + 1) >= (argc - 1)) {
+        printf("-audio requires a sink (null or wav:<path>).\n\n");
+        return 1;
+      }
+
+      options->audio_sink = argv[++i];
+    }
+
+    else if (!strcmp(argv[i], "-benchmark")) {
+      if ((i + 1) >= (argc - 1) ||
+        (options->benchmark_frames = atoi(argv[i + 1])) == 0) {
+        printf("-benchmark requires a number of frames to run.\n\n");
+        return 1;
+      }
+
+      // Benchmarks always run headless.
+      options->no_interface = true;
+      i++;
+    }
+
+    else if (!strcmp(argv[i], "-debug")) {
       options->enable_debugger = true;
 
       // Check for optional host:port pair.
@@ -66,9 +107,123 @@ int parse_options(struct cen64_options *options, int argc, const char *argv[]) {
       options->ddrom_path = argv[++i];
     }
 
+    else if (!strcmp(argv[i], "-dump-frames")) {
+      if ((i + 1) >= (argc - 1)) {
+        printf("-dump-frames requires a path or file descriptor.\n\n");
+        return 1;
+      }
+
+      options->dump_frames_target = argv[++i];
+    }
+
+    else if (!strcmp(argv[i], "-hash-frames")) {
+      if ((i + 1) >= (argc - 1)) {
+        printf("-hash-frames requires a path to the log file.\n\n");
+        return 1;
+      }
+
+      options->hash_frames_path = argv[++i];
+    }
+
     else if (!strcmp(argv[i], "-nointerface"))
       options->no_interface = true;
 
+    else if (!strcmp(argv[i], "-pace")) {
+      if ((i + 1) >= (argc - 1)) {
+        printf("-pace requires clock or audio.\n\n");
+        return 1;
+      }
+
+      if (!strcmp(argv[++i], "audio"))
+        options->pace_audio = true;
+
+      else if (!strcmp(argv[i], "clock"))
+        options->pace_audio = false;
+
+      else {
+        printf("-pace requires clock or audio.\n\n");
+        return 1;
+      }
+    }
+
+    else if (!strcmp(argv[i], "-presenter")) {
+      if ((i + 1) >= (argc - 1)) {
+        printf("-presenter requires gl or shm.\n\n");
+        return 1;
+      }
+
+      if (!strcmp(argv[++i], "shm"))
+        options->software_presenter = true;
+
+#ifdef CEN64_OPENGL
+      else if (!strcmp(argv[i], "gl"))
+        options->software_presenter = false;
+#endif
+
+      else {
+#ifdef CEN64_OPENGL
+        printf("-presenter requires gl or shm.\n\n");
+#else
+        printf("-presenter: this build only supports shm.\n\n");
+#endif
+        return 1;
+      }
+    }
+
+    else if (!strcmp(argv[i], "-rdpasync"))
+      options->rdp_async = true;
+
+    else if (!strcmp(argv[i], "-rdpcapture")) {
+      if ((i + 1) >= (argc - 1)) {
+        printf("-rdpcapture requires a path to the capture file.\n\n");
+        return 1;
+      }
+
+      options->rdp_capture_path = argv[++i];
+    }
+
+    else if (!strcmp(argv[i], "-rdpthreads")) {
+      options->rdp_threads = cen64_thread_cpu_count();
+
+      if (options->rdp_threads > MAX_DEFAULT_RDP_THREADS)
+        options->rdp_threads = MAX_DEFAULT_RDP_THREADS;
+
+      // Check for optional thread count.
+      if ((i + 1) < (argc - 1) && isdigit((unsigned char) argv[i + 1][0])) {
+        if ((options->rdp_threads = atoi(argv[++i])) == 0) {
+          printf("-rdpthreads requires a nonzero thread count.\n\n");
+          return 1;
+        }
+      }
+    }
+
+    else if (!strcmp(argv[i], "-rspthread")) {
+      options->rsp_thread_window = DEFAULT_RSP_THREAD_WINDOW;
+
+      // Check for optional window size.
+      if ((i + 1) < (argc - 1) && isdigit((unsigned char) argv[i + 1][0])) {
+        if ((options->rsp_thread_window = atoi(argv[++i])) == 0) {
+          printf("-rspthread requires a nonzero window.\n\n");
+          return 1;
+        }
+      }
+    }
+
+    else if (!strcmp(argv[i], "-speed")) {
+      if ((i + 1) >= (argc - 1)) {
+        printf("-speed requires a percentage or unlimited.\n\n");
+        return 1;
+      }
+
+      if (!strcmp(argv[++i], "unlimited"))
+        options->speed = 0;
+
+      else if ((options->speed = atoi(argv[i])) == 0) {
+        printf("-speed requires a percentage or unlimited.\n\n");
+        return 1;
+      }
+    }
+
     // TODO: Handle this better.
     else
       break;
@@ -103,13 +258,34 @@ void print_command_line_usage(const char *invokation_string) {
 #ifdef _WIN32
       "  -console                   : Creates/shows the system console.\n"
 #endif
+      "  -audio <sink>              : Hand audio off to a sink: null (discard it)\n"
+      "                               or wav:<path> (write it to a 48kHz WAV file).\n"
+      "  -benchmark <frames>        : Run headless for <frames> VI interrupts, then\n"
+      "                               print performance statistics as JSON.\n"
       "  -debug [addr][:port]       : Starts the debugger on interface:port.\n"
       "                               By default, CEN64 uses localhost:64646.\n"
       "  -ddipl <path>              : Path to the 64DD IPL ROM (enables 64DD mode).\n"
       "  -ddrom <path>              : Path to the 64DD disk ROM (requires -ddipl).\n"
+      "  -dump-frames <path|fd>     : Write every VI frame out as Y4M (or as raw\n"
+      "                               RGBA, if the path ends with .rgba or .raw).\n"
+      "  -hash-frames <path>        : Log a hash of what's on screen at every VI\n"
+      "                               interrupt, for comparing output across runs.\n"
       "  -nointerface               : Run simulator without a user interface.\n"
+      "  -pace <clock|audio>        : With -speed, go by the host's clock (the\n"
+      "                               default) or by the audio sink's playback.\n"
+      "  -presenter <gl|shm>        : Draw frames with OpenGL (the default, where\n"
+      "                               built in) or in software, via MIT-SHM.\n"
+      "  -rdpasync                  : Render RDP commands on their own thread.\n"
+      "  -rdpcapture <path>         : Write every RDP command list (and the RDRAM\n"
+      "                               it uses) out to a file for cen64-rdp-replay.\n"
+      "  -rdpthreads [count]        : Rasterize on this many threads (defaults to\n"
+      "                               the number of host cores, up to %u).\n"
+      "  -rspthread [cycles]        : Run the RSP on its own thread, letting it lag\n"
+      "                               the VR4300 by up to this many cycles (%u).\n"
+      "  -speed <percent|unlimited> : Run at this percentage of real time (e.g.,\n"
+      "                               50, 100 or 200). Unlimited by default.\n"
 
-    ,invokation_string
+    ,invokation_string, MAX_DEFAULT_RDP_THREADS, DEFAULT_RSP_THREAD_WINDOW
   );
 }
 
@@ -17,7 +17,11 @@ struct cen64_options {
   const char *ddrom_path;
   const char *pifrom_path;
   const char *cart_path;
+  const char *audio_sink;
   const char *debugger_addr;
+  const char *rdp_capture_path;
+  const char *dump_frames_target;
+  const char *hash_frames_path;
 
 #ifdef _WIN32
   bool console;
@@ -25,6 +29,14 @@ struct cen64_options {
 
   bool enable_debugger;
   bool no_interface;
+  bool pace_audio;
+  bool rdp_async;
+  bool software_presenter;
+
+  unsigned rsp_thread_window;
+  unsigned rdp_threads;
+  unsigned benchmark_frames;
+  unsigned speed;
 };
 
 extern const struct cen64_options default_cen64_options;
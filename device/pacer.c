@@ -0,0 +1,93 @@
+//
+// device/pacer.c: Emulation speed control.
+//
+// CEN64: Cycle-Accurate Nintendo 64 Simulator.
+// Copyright (C) 2014, Tyler J. Stachecki.
+//
+// This file is subject to the terms and conditions defined in
+// 'LICENSE', which is part of this source code package.
+//
+
+#include "common.h"
+#include "ai/sink.h"
+#include "device/device.h"
+#include "device/pacer.h"
+#include "device/scheduler.h"
+#include "os/thread.h"
+#include "os/timer.h"
+
+// Nanoseconds in an RCP cycle (at 62.5MHz).
+#define PACER_NS_PER_RCP_CYCLE 16
+
+// If the device falls this far behind, it doesn't try to catch up.
+#define PACER_MAX_LAG (NS_PER_SEC / 10)
+
+// Milliseconds of audio to keep queued up when pacing against it.
+#define PACER_AUDIO_LATENCY 100
+
+// Starts pacing the device at speed percent of real time.
+void pacer_start(struct pacer *pacer,
+  struct cen64_device *device, unsigned speed, bool audio) {
+  memset(pacer, 0, sizeof(*pacer));
+
+  pacer->speed = speed;
+  pacer->last_cycle = scheduler_vr4300_to_rcp(device->scheduler.now);
+  pacer->deadline = get_sleep_time();
+
+  // The sink sets the pace, playing samples out at the same speed.
+  if (audio && device->ai.sink != NULL) {
+    pacer->sink = device->ai.sink;
+    cen64_atomic_store_u32(&pacer->sink->speed, speed);
+  }
+
+  device->vi.pacer = pacer;
+}
+
+// Stops pacing the device.
+void pacer_stop(struct pacer *pacer, struct cen64_device *device) {
+  if (pacer->sink != NULL)
+    cen64_atomic_store_u32(&pacer->sink->speed, 0);
+
+  device->vi.pacer = NULL;
+}
+
+// Sleeps until the host has caught up with the device.
+void pacer_refresh(struct pacer *pacer, uint64_t rcp_cycle) {
+  uint64_t elapsed = rcp_cycle - pacer->last_cycle;
+  uint64_t now;
+
+  pacer->last_cycle = rcp_cycle;
+  pacer->deadline += elapsed * PACER_NS_PER_RCP_CYCLE * 100 / pacer->speed;
+
+  // With audio playing, keep just enough of it queued up. Once it
+  // dries up (or if it never started), go by the clock instead.
+  if (pacer->sink != NULL) {
+    unsigned rate = pacer->sink->rate;
+    unsigned fill = ai_sink_fill(pacer->sink);
+
+    if (rate > 0 && fill > 0) {
+      unsigned target = rate * PACER_AUDIO_LATENCY / 1000;
+
+      now = get_sleep_time();
+
+      if (fill > target) {
+        now += (uint64_t) (fill - target) * NS_PER_SEC * 100 /
+          ((uint64_t) rate * pacer->speed);
+
+        sleep_until(now);
+      }
+
+      pacer->deadline = now;
+      return;
+    }
+  }
+
+  now = get_sleep_time();
+
+  if (now > pacer->deadline + PACER_MAX_LAG)
+    pacer->deadline = now;
+
+  else
+    sleep_until(pacer->deadline);
+}
+
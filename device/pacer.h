@@ -0,0 +1,40 @@
+//
+// device/pacer.h: Emulation speed control.
+//
+// CEN64: Cycle-Accurate Nintendo 64 Simulator.
+// Copyright (C) 2014, Tyler J. Stachecki.
+//
+// This file is subject to the terms and conditions defined in
+// 'LICENSE', which is part of this source code package.
+//
+
+#ifndef __device_pacer_h__
+#define __device_pacer_h__
+#include "common.h"
+
+struct ai_sink;
+struct cen64_device;
+
+// The pacer gets a look in at every VI refresh, and sleeps off however
+// far the device has run ahead of the host. That's measured against
+// either the host's clock (scaled by the speed), or the samples waiting
+// on the audio sink, which plays them out as a sound card would.
+//
+// At unlimited speed there's no pacer at all, so it costs nothing.
+struct pacer {
+  struct ai_sink *sink;
+  unsigned speed;
+
+  // Deadline (on the sleep clock) for the last refresh.
+  uint64_t deadline;
+  uint64_t last_cycle;
+};
+
+cen64_cold void pacer_start(struct pacer *pacer,
+  struct cen64_device *device, unsigned speed, bool audio);
+cen64_cold void pacer_stop(struct pacer *pacer, struct cen64_device *device);
+
+void pacer_refresh(struct pacer *pacer, uint64_t rcp_cycle);
+
+#endif
+
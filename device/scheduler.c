@@ -0,0 +1,156 @@
+//
+// device/scheduler.c: Device event scheduler.
+//
+// CEN64: Cycle-Accurate Nintendo 64 Simulator.
+// Copyright (C) 2014, Tyler J. Stachecki.
+//
+// This file is subject to the terms and conditions defined in
+// 'LICENSE', which is part of this source code package.
+//
+
+#include "common.h"
+#include "device/scheduler.h"
+
+static void scheduler_heap_remove(struct scheduler *scheduler, unsigned i);
+static void scheduler_heap_sift_down(struct scheduler *scheduler, unsigned i);
+static void scheduler_heap_sift_up(struct scheduler *scheduler, unsigned i);
+static void scheduler_heap_swap(struct scheduler *scheduler,
+  unsigned i, unsigned j);
+
+// Swaps two elements of the heap, keeping the indices in sync.
+void scheduler_heap_swap(struct scheduler *scheduler, unsigned i, unsigned j) {
+  uint8_t temp = scheduler->heap[i];
+
+  scheduler->heap[i] = scheduler->heap[j];
+  scheduler->heap[j] = temp;
+
+  scheduler->entries[scheduler->heap[i]].heap_index = i;
+  scheduler->entries[scheduler->heap[j]].heap_index = j;
+}
+
+// Moves an element towards the root of the heap.
+void scheduler_heap_sift_up(struct scheduler *scheduler, unsigned i) {
+  const struct scheduler_entry *entries = scheduler->entries;
+
+  while (i > 0) {
+    unsigned parent = (i - 1) >> 1;
+
+    if (entries[scheduler->heap[parent]].time <=
+      entries[scheduler->heap[i]].time)
+      break;
+
+    scheduler_heap_swap(scheduler, i, parent);
+    i = parent;
+  }
+}
+
+// Moves an element towards the leaves of the heap.
+void scheduler_heap_sift_down(struct scheduler *scheduler, unsigned i) {
+  const struct scheduler_entry *entries = scheduler->entries;
+
+  while (1) {
+    unsigned left = (i << 1) + 1;
+    unsigned right = left + 1;
+    unsigned smallest = i;
+
+    if (left < scheduler->heap_size && entries[scheduler->heap[left]].time <
+      entries[scheduler->heap[smallest]].time)
+      smallest = left;
+
+    if (right < scheduler->heap_size && entries[scheduler->heap[right]].time <
+      entries[scheduler->heap[smallest]].time)
+      smallest = right;
+
+    if (smallest == i)
+      break;
+
+    scheduler_heap_swap(scheduler, i, smallest);
+    i = smallest;
+  }
+}
+
+// Removes the element at the given position from the heap.
+void scheduler_heap_remove(struct scheduler *scheduler, unsigned i) {
+  unsigned last = --scheduler->heap_size;
+
+  scheduler->entries[scheduler->heap[i]].heap_index = -1;
+
+  if (i != last) {
+    scheduler->heap[i] = scheduler->heap[last];
+    scheduler->entries[scheduler->heap[i]].heap_index = i;
+
+    scheduler_heap_sift_up(scheduler, i);
+    scheduler_heap_sift_down(scheduler, i);
+  }
+}
+
+// Unschedules an event, if it is pending.
+void scheduler_cancel(struct scheduler *scheduler, enum scheduler_event event) {
+  struct scheduler_entry *entry = scheduler->entries + event;
+
+  // The deadline is left alone; if it was for this event, the
+  // device loop just takes one extra trip through the dispatcher.
+  if (entry->heap_index >= 0)
+    scheduler_heap_remove(scheduler, entry->heap_index);
+}
+
+// Runs the handlers of all events that are due.
+void scheduler_dispatch(struct scheduler *scheduler) {
+  struct scheduler_entry *entries = scheduler->entries;
+
+  while (scheduler->heap_size > 0) {
+    struct scheduler_entry *entry = entries + scheduler->heap[0];
+
+    if (entry->time > scheduler->now)
+      break;
+
+    // Handlers are free to reschedule the event they service.
+    scheduler_heap_remove(scheduler, 0);
+    entry->handler(entry->opaque);
+  }
+
+  scheduler->deadline = scheduler->heap_size > 0
+    ? entries[scheduler->heap[0]].time
+    : SCHEDULER_NEVER;
+}
+
+// Initializes the scheduler.
+void scheduler_init(struct scheduler *scheduler) {
+  unsigned i;
+
+  memset(scheduler, 0, sizeof(*scheduler));
+  scheduler->deadline = SCHEDULER_NEVER;
+
+  for (i = 0; i < NUM_SCHEDULER_EVENTS; i++)
+    scheduler->entries[i].heap_index = -1;
+}
+
+// Sets the function to invoke when an event comes due.
+void scheduler_register(struct scheduler *scheduler,
+  enum scheduler_event event, scheduler_handler handler, void *opaque) {
+  scheduler->entries[event].handler = handler;
+  scheduler->entries[event].opaque = opaque;
+}
+
+// Schedules (or reschedules) an event for the given VR4300 cycle.
+void scheduler_schedule(struct scheduler *scheduler,
+  enum scheduler_event event, uint64_t time) {
+  struct scheduler_entry *entry = scheduler->entries + event;
+
+  entry->time = time;
+
+  if (entry->heap_index < 0) {
+    entry->heap_index = scheduler->heap_size;
+    scheduler->heap[scheduler->heap_size++] = event;
+    scheduler_heap_sift_up(scheduler, entry->heap_index);
+  }
+
+  else {
+    scheduler_heap_sift_up(scheduler, entry->heap_index);
+    scheduler_heap_sift_down(scheduler, entry->heap_index);
+  }
+
+  if (time < scheduler->deadline)
+    scheduler->deadline = time;
+}
+
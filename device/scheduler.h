@@ -0,0 +1,77 @@
+//
+// device/scheduler.h: Device event scheduler.
+//
+// CEN64: Cycle-Accurate Nintendo 64 Simulator.
+// Copyright (C) 2014, Tyler J. Stachecki.
+//
+// This file is subject to the terms and conditions defined in
+// 'LICENSE', which is part of this source code package.
+//
+
+#ifndef __device_scheduler_h__
+#define __device_scheduler_h__
+#include "common.h"
+
+#define SCHEDULER_NEVER (~(uint64_t) 0)
+
+// Every source of timed work in the device gets an entry here.
+enum scheduler_event {
+  SCHEDULER_EVENT_VI,
+  SCHEDULER_EVENT_AI,
+  SCHEDULER_EVENT_RSP,
+  SCHEDULER_EVENT_COMPARE,
+  NUM_SCHEDULER_EVENTS
+};
+
+typedef void (*scheduler_handler)(void *opaque);
+
+struct scheduler_entry {
+  scheduler_handler handler;
+  void *opaque;
+
+  uint64_t time;
+  int heap_index;
+};
+
+// All times are expressed in VR4300 pipeline clocks. The RCP runs
+// at 2/3 the rate of the VR4300: it gets a slot on every VR4300 cycle
+// that isn't congruent to 2 (mod 3). Events scheduled for a VR4300
+// cycle are dispatched after both the VR4300 and RCP have been
+// cycled for it.
+struct scheduler {
+  uint64_t now;
+  uint64_t deadline;
+
+  struct scheduler_entry entries[NUM_SCHEDULER_EVENTS];
+  uint8_t heap[NUM_SCHEDULER_EVENTS];
+  unsigned heap_size;
+};
+
+cen64_cold void scheduler_init(struct scheduler *scheduler);
+cen64_cold void scheduler_register(struct scheduler *scheduler,
+  enum scheduler_event event, scheduler_handler handler, void *opaque);
+
+void scheduler_cancel(struct scheduler *scheduler, enum scheduler_event event);
+void scheduler_schedule(struct scheduler *scheduler,
+  enum scheduler_event event, uint64_t time);
+
+cen64_flatten cen64_hot void scheduler_dispatch(struct scheduler *scheduler);
+
+// Forces the device loop out of its fast path at the end of the
+// current cycle (i.e., when a component wakes up another one).
+static inline void scheduler_kick(struct scheduler *scheduler) {
+  scheduler->deadline = scheduler->now;
+}
+
+// Converts an RCP cycle number into the VR4300 cycle it occurs on.
+static inline uint64_t scheduler_rcp_to_vr4300(uint64_t rcp_cycle) {
+  return rcp_cycle / 2 * 3 + (rcp_cycle & 1);
+}
+
+// Returns the number of RCP cycles completed before a VR4300 cycle.
+static inline uint64_t scheduler_vr4300_to_rcp(uint64_t vr4300_cycle) {
+  return (vr4300_cycle * 2 + 2) / 3;
+}
+
+#endif
+
@@ -0,0 +1,70 @@
+//
+// os/frame_mailbox.c
+//
+// Lock-free handoff of frames from the device to the user interface.
+//
+// This file is subject to the terms and conditions defined in
+// 'LICENSE', which is part of this source code package.
+//
+
+#include "common.h"
+#include "os/frame_mailbox.h"
+#include "os/thread.h"
+
+// Allocates storage for each of the slots.
+int frame_mailbox_create(struct frame_mailbox *mailbox, size_t slot_size) {
+  unsigned i;
+
+  memset(mailbox, 0, sizeof(*mailbox));
+
+  if ((mailbox->storage = (uint8_t *) calloc(
+    FRAME_MAILBOX_SLOTS, slot_size)) == NULL)
+    return 1;
+
+  for (i = 0; i < FRAME_MAILBOX_SLOTS; i++)
+    mailbox->slots[i].data = mailbox->storage + i * slot_size;
+
+  mailbox->back = 0;
+  mailbox->ready = 1;
+  mailbox->front = 2;
+  return 0;
+}
+
+// Releases the storage held by the slots.
+void frame_mailbox_destroy(struct frame_mailbox *mailbox) {
+  free(mailbox->storage);
+  mailbox->storage = NULL;
+}
+
+// Swaps the back slot into the ready slot. Returns true if the frame
+// that was ready had already been taken, in which case the interface
+// may be waiting on a new one; otherwise, it still has a wakeup coming.
+bool frame_mailbox_publish(struct frame_mailbox *mailbox) {
+  uint32_t ready = cen64_atomic_exchange_u32(&mailbox->ready,
+    mailbox->back | FRAME_MAILBOX_FRESH);
+
+  mailbox->back = ready & (FRAME_MAILBOX_FRESH - 1);
+  cen64_atomic_store_u32(&mailbox->published, mailbox->published + 1);
+
+  if (ready & FRAME_MAILBOX_FRESH) {
+    cen64_atomic_store_u32(&mailbox->dropped, mailbox->dropped + 1);
+    return false;
+  }
+
+  return true;
+}
+
+// Swaps the ready slot into the front slot if it holds a frame that
+// hasn't been seen yet. Returns the new front slot, or NULL if not.
+const struct frame_mailbox_slot *frame_mailbox_take(
+  struct frame_mailbox *mailbox) {
+  uint32_t ready;
+
+  if (!(cen64_atomic_load_u32(&mailbox->ready) & FRAME_MAILBOX_FRESH))
+    return NULL;
+
+  ready = cen64_atomic_exchange_u32(&mailbox->ready, mailbox->front);
+  mailbox->front = ready & (FRAME_MAILBOX_FRESH - 1);
+  return mailbox->slots + mailbox->front;
+}
+
@@ -0,0 +1,60 @@
+//
+// os/frame_mailbox.h
+//
+// Lock-free handoff of frames from the device to the user interface.
+//
+// This file is subject to the terms and conditions defined in
+// 'LICENSE', which is part of this source code package.
+//
+
+#ifndef __os_frame_mailbox_h__
+#define __os_frame_mailbox_h__
+#include "common.h"
+
+#define FRAME_MAILBOX_SLOTS 3
+#define FRAME_MAILBOX_FRESH 0x4
+
+struct frame_mailbox_slot {
+  unsigned xres, yres, xskip, type;
+  uint8_t *data;
+};
+
+// A triple buffer: the device fills the back slot while the interface
+// draws from the front slot, and the two of them swap their slot with
+// the ready slot in the middle. The device never waits; if the ready
+// frame hasn't been taken by the time the next one is published, it's
+// replaced (and counted as dropped).
+struct frame_mailbox {
+  struct frame_mailbox_slot slots[FRAME_MAILBOX_SLOTS];
+  uint8_t *storage;
+
+  // Used only by the device.
+  unsigned back;
+
+  // Used only by the interface.
+  unsigned front;
+
+  // The ready slot, and FRAME_MAILBOX_FRESH if it hasn't been taken.
+  cen64_align(volatile uint32_t ready, CACHE_LINE_SIZE);
+
+  // Written by the device.
+  volatile uint32_t published;
+  volatile uint32_t dropped;
+};
+
+cen64_cold int frame_mailbox_create(struct frame_mailbox *mailbox,
+  size_t slot_size);
+cen64_cold void frame_mailbox_destroy(struct frame_mailbox *mailbox);
+
+bool frame_mailbox_publish(struct frame_mailbox *mailbox);
+const struct frame_mailbox_slot *frame_mailbox_take(
+  struct frame_mailbox *mailbox);
+
+// Returns the slot that the next frame should be written to.
+static inline struct frame_mailbox_slot *frame_mailbox_back(
+  struct frame_mailbox *mailbox) {
+  return mailbox->slots + mailbox->back;
+}
+
+#endif
+
@@ -9,13 +9,16 @@
 
 #ifndef __os_gl_window_h__
 #define __os_gl_window_h__
+#include "common.h"
 
 #ifdef _WIN32
 #include <windows.h>
 #define GL_UNSIGNED_SHORT_5_5_5_1 0x8034
 #endif
 
+#ifdef CEN64_OPENGL
 #include <GL/gl.h>
+#endif
 
 #define MAX_FRAME_DATA_SIZE (640 * 480 * 4)
 
@@ -41,6 +44,9 @@ struct gl_window_hints {
   char accum_color_bits;
   char accum_alpha_bits;
   char auxiliary_buffers;
+
+  // Present frames without OpenGL.
+  char software;
 };
 
 /* Default is 800x600, double-buffered; all else is don't care. */
@@ -53,8 +59,10 @@ cen64_cold int create_gl_window(struct bus_controller *bus,
 cen64_cold int gl_window_thread(struct gl_window *window,
   struct bus_controller *bus);
 
+#ifdef CEN64_OPENGL
 cen64_cold int gl_swap_buffers(const struct gl_window *window);
 cen64_cold void gl_window_resize_cb(int width, int height);
+#endif
 
 #endif
 
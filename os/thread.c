@@ -0,0 +1,84 @@
+//
+// os/thread.c
+//
+// Waiting primitives shared by the simulation threads.
+//
+// This file is subject to the terms and conditions defined in
+// 'LICENSE', which is part of this source code package.
+//
+
+#include "common.h"
+#include "os/thread.h"
+
+// Spin this many times before handing the core back to the host;
+// the thread being waited on may well need it to make progress.
+#define CEN64_THREAD_SPIN_COUNT 256
+
+// Called on each iteration of a wait loop.
+void cen64_thread_backoff(unsigned *spins) {
+  if (*spins < CEN64_THREAD_SPIN_COUNT) {
+    cen64_cpu_relax();
+    (*spins)++;
+  }
+
+  else
+    cen64_thread_yield();
+}
+
+// Initializes a sleeper.
+int cen64_sleeper_create(struct cen64_sleeper *sleeper) {
+  sleeper->sleeping = 0;
+
+  if (cen64_mutex_create(&sleeper->lock))
+    return 1;
+
+  if (cen64_cv_create(&sleeper->wake_cv)) {
+    cen64_mutex_destroy(&sleeper->lock);
+    return 1;
+  }
+
+  return 0;
+}
+
+// Releases resources acquired for a sleeper.
+void cen64_sleeper_destroy(struct cen64_sleeper *sleeper) {
+  cen64_cv_destroy(&sleeper->wake_cv);
+  cen64_mutex_destroy(&sleeper->lock);
+}
+
+// Called by the consumer once it has drained everything up to tail:
+// sleeps until the producer moves the head past it, or asks it to exit.
+//
+// The producer checks for a sleeper after it moves the head, and the
+// consumer checks the head after it says it's sleeping; with a fence on
+// both sides, one of them is bound to notice the other.
+void cen64_sleeper_wait(struct cen64_sleeper *sleeper,
+  const volatile uint64_t *head, uint64_t tail,
+  const volatile uint32_t *exit) {
+  cen64_mutex_lock(&sleeper->lock);
+  cen64_atomic_store_u32(&sleeper->sleeping, 1);
+  cen64_atomic_fence();
+
+  while (cen64_atomic_load_u64(head) == tail && !cen64_atomic_load_u32(exit))
+    cen64_cv_wait(&sleeper->wake_cv, &sleeper->lock);
+
+  cen64_atomic_store_u32(&sleeper->sleeping, 0);
+  cen64_mutex_unlock(&sleeper->lock);
+}
+
+// Called by the producer after it moves the head: wakes the consumer,
+// but only if it went to sleep.
+void cen64_sleeper_notify(struct cen64_sleeper *sleeper) {
+  cen64_atomic_fence();
+
+  if (cen64_atomic_load_u32(&sleeper->sleeping))
+    cen64_sleeper_wake(sleeper);
+}
+
+// Wakes the consumer regardless (e.g., after asking it to exit).
+void cen64_sleeper_wake(struct cen64_sleeper *sleeper) {
+  cen64_mutex_lock(&sleeper->lock);
+  cen64_cv_signal(&sleeper->wake_cv);
+  cen64_mutex_unlock(&sleeper->lock);
+}
+
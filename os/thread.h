@@ -0,0 +1,143 @@
+//
+// os/thread.h
+//
+// Threading and atomic primitives for the simulation threads.
+//
+// This file is subject to the terms and conditions defined in
+// 'LICENSE', which is part of this source code package.
+//
+
+#ifndef __os_thread_h__
+#define __os_thread_h__
+#include "common.h"
+
+#ifdef _WIN32
+#include <windows.h>
+typedef HANDLE cen64_thread;
+typedef CRITICAL_SECTION cen64_mutex;
+typedef CONDITION_VARIABLE cen64_cv;
+
+#else
+#include <pthread.h>
+typedef pthread_t cen64_thread;
+typedef pthread_mutex_t cen64_mutex;
+typedef pthread_cond_t cen64_cv;
+#endif
+
+typedef void *(*cen64_thread_func)(void *opaque);
+
+cen64_cold int cen64_thread_create(cen64_thread *thread,
+  cen64_thread_func func, void *opaque);
+cen64_cold int cen64_thread_join(cen64_thread *thread);
+void cen64_thread_yield(void);
+unsigned cen64_thread_cpu_count(void);
+
+cen64_cold int cen64_mutex_create(cen64_mutex *mutex);
+cen64_cold int cen64_mutex_destroy(cen64_mutex *mutex);
+int cen64_mutex_lock(cen64_mutex *mutex);
+int cen64_mutex_unlock(cen64_mutex *mutex);
+
+cen64_cold int cen64_cv_create(cen64_cv *cv);
+cen64_cold int cen64_cv_destroy(cen64_cv *cv);
+int cen64_cv_wait(cen64_cv *cv, cen64_mutex *mutex);
+int cen64_cv_signal(cen64_cv *cv);
+int cen64_cv_broadcast(cen64_cv *cv);
+
+void cen64_thread_backoff(unsigned *spins);
+
+//
+// Word-sized atomics. Loads acquire, stores release; that's all the
+// simulation threads need to hand data back and forth. A full fence is
+// there for the odd store that has to be ordered before a later load,
+// and an exchange (a full barrier) for handing buffers back and forth.
+//
+#ifdef _MSC_VER
+#include <intrin.h>
+
+static inline uint32_t cen64_atomic_load_u32(const volatile uint32_t *p) {
+  uint32_t value = *p;
+  _ReadWriteBarrier();
+  return value;
+}
+
+static inline void cen64_atomic_store_u32(volatile uint32_t *p, uint32_t v) {
+  _ReadWriteBarrier();
+  *p = v;
+}
+
+static inline uint64_t cen64_atomic_load_u64(const volatile uint64_t *p) {
+  uint64_t value = *p;
+  _ReadWriteBarrier();
+  return value;
+}
+
+static inline void cen64_atomic_store_u64(volatile uint64_t *p, uint64_t v) {
+  _ReadWriteBarrier();
+  *p = v;
+}
+
+static inline uint32_t cen64_atomic_exchange_u32(
+  volatile uint32_t *p, uint32_t v) {
+  return (uint32_t) _InterlockedExchange((volatile long *) p, (long) v);
+}
+
+static inline void cen64_cpu_relax(void) {
+  _mm_pause();
+}
+
+static inline void cen64_atomic_fence(void) {
+  _mm_mfence();
+}
+
+#else
+static inline uint32_t cen64_atomic_load_u32(const volatile uint32_t *p) {
+  return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+}
+
+static inline void cen64_atomic_store_u32(volatile uint32_t *p, uint32_t v) {
+  __atomic_store_n(p, v, __ATOMIC_RELEASE);
+}
+
+static inline uint64_t cen64_atomic_load_u64(const volatile uint64_t *p) {
+  return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+}
+
+static inline void cen64_atomic_store_u64(volatile uint64_t *p, uint64_t v) {
+  __atomic_store_n(p, v, __ATOMIC_RELEASE);
+}
+
+static inline uint32_t cen64_atomic_exchange_u32(
+  volatile uint32_t *p, uint32_t v) {
+  return __atomic_exchange_n(p, v, __ATOMIC_ACQ_REL);
+}
+
+static inline void cen64_cpu_relax(void) {
+#if defined(__i386__) || defined(__x86_64__)
+  __builtin_ia32_pause();
+#endif
+}
+
+static inline void cen64_atomic_fence(void) {
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+#endif
+
+// Lets a consumer thread sleep on an empty single-producer queue, and
+// the producer wake it up without taking a lock when it's not asleep.
+struct cen64_sleeper {
+  cen64_mutex lock;
+  cen64_cv wake_cv;
+  volatile uint32_t sleeping;
+};
+
+cen64_cold int cen64_sleeper_create(struct cen64_sleeper *sleeper);
+cen64_cold void cen64_sleeper_destroy(struct cen64_sleeper *sleeper);
+
+void cen64_sleeper_wait(struct cen64_sleeper *sleeper,
+  const volatile uint64_t *head, uint64_t tail,
+  const volatile uint32_t *exit);
+void cen64_sleeper_notify(struct cen64_sleeper *sleeper);
+void cen64_sleeper_wake(struct cen64_sleeper *sleeper);
+
+#endif
+
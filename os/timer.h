@@ -36,5 +36,14 @@ cen64_cold unsigned long long compute_time_difference(
 
 cen64_cold void get_time(cen64_time *t);
 
+// Returns a free-running host cycle count, or 0 if there isn't one.
+cen64_cold uint64_t get_host_cycles(void);
+
+// Deadlines for sleep_until() are in ns, as returned by get_sleep_time().
+// The clock isn't the same one get_time() reads from: not every host
+// can sleep against that.
+uint64_t get_sleep_time(void);
+void sleep_until(uint64_t deadline);
+
 #endif
 
@@ -143,6 +143,7 @@ int os_main(struct cen64_options *options, struct rom_file *ddipl,
   if (!options->no_interface) {
     device.vi.gl_window.window = &window;
     get_default_gl_window_hints(&hints);
+    hints.software = options->software_presenter;
 
     if (create_gl_window(&device.bus, &device.vi.gl_window, &hints)) {
       printf("Failed to create a window.\n");
@@ -157,6 +158,21 @@ int os_main(struct cen64_options *options, struct rom_file *ddipl,
       printf("Failed to register SIGINT handler.\n");
   }
 
+  // Let the dump fail gracefully if a pipe's reader goes away.
+  if (options->dump_frames_target != NULL)
+    signal(SIGPIPE, SIG_IGN);
+
+  device.rsp_thread_window = options->rsp_thread_window;
+  device.rdp_threads = options->rdp_threads;
+  device.rdp_async = options->rdp_async;
+  device.rdp_capture_path = options->rdp_capture_path;
+  device.audio_sink = options->audio_sink;
+  device.speed = options->speed;
+  device.pace_audio = options->pace_audio;
+  device.dump_frames_target = options->dump_frames_target;
+  device.hash_frames_path = options->hash_frames_path;
+  device.benchmark_frames = options->benchmark_frames;
+
   // Pull up the debug API if it was requested.
   device.debug_sfd = -1;
 
@@ -173,7 +189,9 @@ int os_main(struct cen64_options *options, struct rom_file *ddipl,
 
   // Start the device thread, hand over control to the UI thread on success.
   if ((pthread_create(&device_thread, NULL, run_device_thread, &device)) == 0) {
-    gl_window_thread(&device.vi.gl_window, &device.bus);
+    if (!options->no_interface)
+      gl_window_thread(&device.vi.gl_window, &device.bus);
+
     pthread_join(device_thread, NULL);
   }
 
@@ -0,0 +1,82 @@
+//
+// os/unix/thread.c
+//
+// Threading primitives for the simulation threads.
+//
+// This file is subject to the terms and conditions defined in
+// 'LICENSE', which is part of this source code package.
+//
+
+#include "os/thread.h"
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+
+// Spawns a thread running func(opaque).
+int cen64_thread_create(cen64_thread *thread,
+  cen64_thread_func func, void *opaque) {
+  return pthread_create(thread, NULL, func, opaque);
+}
+
+// Waits for a thread to exit.
+int cen64_thread_join(cen64_thread *thread) {
+  return pthread_join(*thread, NULL);
+}
+
+// Gives up the remainder of the thread's time slice.
+void cen64_thread_yield(void) {
+  sched_yield();
+}
+
+// Returns the number of processors available to the host.
+unsigned cen64_thread_cpu_count(void) {
+  long count = sysconf(_SC_NPROCESSORS_ONLN);
+
+  return count > 0 ? (unsigned) count : 1;
+}
+
+// Initializes a mutex.
+int cen64_mutex_create(cen64_mutex *mutex) {
+  return pthread_mutex_init(mutex, NULL);
+}
+
+// Releases resources held by a mutex.
+int cen64_mutex_destroy(cen64_mutex *mutex) {
+  return pthread_mutex_destroy(mutex);
+}
+
+// Acquires a mutex.
+int cen64_mutex_lock(cen64_mutex *mutex) {
+  return pthread_mutex_lock(mutex);
+}
+
+// Releases a mutex.
+int cen64_mutex_unlock(cen64_mutex *mutex) {
+  return pthread_mutex_unlock(mutex);
+}
+
+// Initializes a condition variable.
+int cen64_cv_create(cen64_cv *cv) {
+  return pthread_cond_init(cv, NULL);
+}
+
+// Releases resources held by a condition variable.
+int cen64_cv_destroy(cen64_cv *cv) {
+  return pthread_cond_destroy(cv);
+}
+
+// Atomically releases the mutex and waits on the condition variable.
+int cen64_cv_wait(cen64_cv *cv, cen64_mutex *mutex) {
+  return pthread_cond_wait(cv, mutex);
+}
+
+// Wakes up a thread waiting on the condition variable.
+int cen64_cv_signal(cen64_cv *cv) {
+  return pthread_cond_signal(cv);
+}
+
+// Wakes up every thread waiting on the condition variable.
+int cen64_cv_broadcast(cen64_cv *cv) {
+  return pthread_cond_broadcast(cv);
+}
+
@@ -8,9 +8,14 @@
 //
 
 #include "os/timer.h"
+#include <errno.h>
 #include <time.h>
 #include <sys/time.h>
 
+#if defined(__i386__) || defined(__x86_64__)
+#include <x86intrin.h>
+#endif
+
 // Computes the difference, in ns, between two times.
 unsigned long long compute_time_difference(
   const cen64_time *now, const cen64_time *before) {
@@ -32,3 +37,51 @@ void get_time(cen64_time *t) {
 #endif
 }
 
+// Returns a free-running host cycle count, or 0 if there isn't one.
+uint64_t get_host_cycles(void) {
+#if defined(__i386__) || defined(__x86_64__)
+  return __rdtsc();
+#else
+  return 0;
+#endif
+}
+
+// Gets the time (in ns) from the clock that sleep_until() uses.
+uint64_t get_sleep_time(void) {
+#if defined(__APPLE__)
+  struct timeval tv;
+
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec * NS_PER_SEC + tv.tv_usec * 1000ULL;
+#else
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * NS_PER_SEC + ts.tv_nsec;
+#endif
+}
+
+// Sleeps until the deadline has passed (or returns right away if it
+// already has). Absolute deadlines don't drift with wakeup latency.
+void sleep_until(uint64_t deadline) {
+#if defined(__APPLE__)
+  uint64_t now = get_sleep_time();
+  struct timespec ts;
+
+  while (now < deadline) {
+    ts.tv_sec = (deadline - now) / NS_PER_SEC;
+    ts.tv_nsec = (deadline - now) % NS_PER_SEC;
+
+    nanosleep(&ts, NULL);
+    now = get_sleep_time();
+  }
+#else
+  struct timespec ts;
+
+  ts.tv_sec = deadline / NS_PER_SEC;
+  ts.tv_nsec = deadline % NS_PER_SEC;
+
+  while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR);
+#endif
+}
+
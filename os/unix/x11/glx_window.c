@@ -10,13 +10,16 @@
 #include "bus/controller.h"
 #include "common.h"
 #include "common/debug.h"
+#include "os/frame_mailbox.h"
 #include "os/gl_window.h"
 #include "os/input.h"
+#include "os/thread.h"
 #include "os/timer.h"
 #include "os/unix/x11/glx_window.h"
 #include "vi/controller.h"
 
 #include <errno.h>
+#include <fcntl.h>
 #include <pthread.h>
 #include <stddef.h>
 #include <string.h>
@@ -24,23 +27,39 @@
 #include <sys/select.h>
 #include <unistd.h>
 
+#ifdef __linux__
+#include <sys/eventfd.h>
+#endif
+
+#ifdef CEN64_OPENGL
 #include <GL/glx.h>
+#endif
 #include <X11/Xatom.h>
 #include <X11/Xlib.h>
 #include <X11/Xutil.h>
 #include <X11/extensions/xf86vmode.h>
 
 // Functions to assist in taming X11.
+cen64_cold static int create_wake_fds(int *fds);
+cen64_cold static void drain_wake_fds(const int *fds);
+
+#ifdef CEN64_OPENGL
 cen64_cold static int create_glx_context(
   struct glx_window *glx_window, GLXContext *context);
+#endif
 
 cen64_cold static int destroy_glx_window(struct glx_window *glx_window);
 
+#ifdef CEN64_OPENGL
 cen64_cold static void generate_attribute_list(int *attribute_list,
   const struct gl_window_hints *hints);
 
 cen64_cold static int get_matching_visual_info(struct glx_window *glx_window,
   int *attribute_list, XVisualInfo **visual_info);
+#endif
+
+cen64_cold static int get_software_visual_info(struct glx_window *glx_window,
+  XVisualInfo **visual_info);
 
 cen64_cold static int get_matching_window_mode(struct glx_window *glx_window,
   const struct gl_window_hints *hints, XF86VidModeModeInfo *mode);
@@ -52,11 +71,45 @@ cen64_cold static int glx_window_thread(struct gl_window *gl_window,
   struct glx_window *glx_window, struct bus_controller *bus);
 
 cen64_cold static void glx_window_update_window_title(
-  struct glx_window *glx_window, cen64_time *last_report_time);
+  struct glx_window *glx_window, cen64_time *last_report_time,
+  uint32_t *last_report_frames);
 
 cen64_cold static int switch_to_fullscreen(struct glx_window *glx_window,
   const struct gl_window_hints *hints);
 
+// Opens the descriptors used to signal new frames. Neither end blocks,
+// so the device can't be held up by the user interface.
+int create_wake_fds(int *fds) {
+#ifdef __linux__
+  if ((fds[0] = eventfd(0, EFD_NONBLOCK)) < 0)
+    return 1;
+
+  fds[1] = fds[0];
+  return 0;
+#else
+  if (pipe(fds) < 0)
+    return 1;
+
+  fcntl(fds[0], F_SETFL, fcntl(fds[0], F_GETFL) | O_NONBLOCK);
+  fcntl(fds[1], F_SETFL, fcntl(fds[1], F_GETFL) | O_NONBLOCK);
+  return 0;
+#endif
+}
+
+// Clears any pending signals.
+void drain_wake_fds(const int *fds) {
+#ifdef __linux__
+  uint64_t count;
+
+  read(fds[0], &count, sizeof(count));
+#else
+  char dummy[64];
+
+  while (read(fds[0], dummy, sizeof(dummy)) > 0);
+#endif
+}
+
+#ifdef CEN64_OPENGL
 // Creates a new rendering context.
 int create_glx_context(struct glx_window *glx_window, GLXContext *context) {
   GLXContext check_context = glXCreateContext(glx_window->display,
@@ -85,6 +138,7 @@ int create_glx_context(struct glx_window *glx_window, GLXContext *context) {
   *context = check_context;
   return 0;
 }
+#endif
 
 // Jumps to the entry point for the user interface code.
 int gl_window_thread(struct gl_window *gl_window, struct bus_controller *bus) {
@@ -103,23 +157,33 @@ int create_gl_window(struct bus_controller *bus,
   // to change active the windowing mode.
   int fullscreen = hints->fullscreen;
 
+#ifdef CEN64_OPENGL
   // Magic number was chosen based on the glXChooseFBConfig man page.
   // It is at least large enough to hold the supported attributes, as
   // well as a few additional ones. Expand it at your convenience.
   int attribute_list[64];
+#endif
 
   debug("create_gl_window: Creating window...\n");
   glx_window = (struct glx_window *) (gl_window->window);
   memset(glx_window, 0, sizeof(*glx_window));
 
-  if (pipe(glx_window->select_pipefds) < 0) {
-    debug("create_gl_window: Could not open pipe for thread comm.\n");
+  if (create_wake_fds(glx_window->wake_fds)) {
+    debug("create_gl_window: Could not open descriptors for thread comm.\n");
+    return 1;
+  }
+
+  if (frame_mailbox_create(&glx_window->frames, MAX_FRAME_DATA_SIZE)) {
+    debug("create_gl_window: Could not allocate frame buffers.\n");
+    close(glx_window->wake_fds[0]);
+
+    if (glx_window->wake_fds[1] != glx_window->wake_fds[0])
+      close(glx_window->wake_fds[1]);
+
     return 1;
   }
 
   pthread_mutex_init(&glx_window->event_lock, NULL);
-  pthread_mutex_init(&glx_window->render_lock, NULL);
-  pthread_cond_init(&glx_window->render_cv, NULL);
 
   // Open a connection and get the default screen number.
   if ((glx_window->display = XOpenDisplay(NULL)) == NULL) {
@@ -130,19 +194,37 @@ int create_gl_window(struct bus_controller *bus,
   glx_window->screen = DefaultScreen(glx_window->display);
   root_window = RootWindow(glx_window->display, glx_window->screen);
 
+#ifdef CEN64_OPENGL
+  glx_window->software = hints->software;
+#else
+  glx_window->software = true;
+#endif
+
+  // Software windows just need a visual that pixels can be written to.
+  if (glx_window->software) {
+    if (get_software_visual_info(glx_window, &glx_window->visual_info)) {
+      debug("create_gl_window: Failed to find a TrueColor visual.\n");
+      goto create_out_destroy;
+    }
+  }
+
+#ifdef CEN64_OPENGL
   // Use hints to create a window, then bind the GL context.
-  generate_attribute_list(attribute_list, hints);
+  else {
+    generate_attribute_list(attribute_list, hints);
 
-  if (get_matching_visual_info(glx_window,
-    attribute_list, &glx_window->visual_info)) {
-    debug("create_gl_window: Failed to match window hints.\n");
-    goto create_out_destroy;
-  }
+    if (get_matching_visual_info(glx_window,
+      attribute_list, &glx_window->visual_info)) {
+      debug("create_gl_window: Failed to match window hints.\n");
+      goto create_out_destroy;
+    }
 
-  if (create_glx_context(glx_window, &glx_window->context)) {
-    debug("create_gl_window: Failed to acquire a GL context.\n");
-    goto create_out_destroy;
+    if (create_glx_context(glx_window, &glx_window->context)) {
+      debug("create_gl_window: Failed to acquire a GL context.\n");
+      goto create_out_destroy;
+    }
   }
+#endif
 
   glx_window->attr.event_mask = ExposureMask | KeyPressMask |
     KeyReleaseMask | ButtonPressMask | StructureNotifyMask;
@@ -212,8 +294,6 @@ int destroy_gl_window(struct gl_window *gl_window) {
   struct glx_window *glx_window = (struct glx_window *) (gl_window->window);
   destroy_glx_window(glx_window);
 
-  pthread_cond_destroy(&glx_window->render_cv);
-  pthread_mutex_destroy(&glx_window->render_lock);
   pthread_mutex_destroy(&glx_window->event_lock);
 
   return 0;
@@ -226,6 +306,10 @@ int destroy_glx_window(struct glx_window *glx_window) {
       glx_window->screen, &glx_window->old_mode);
   }
 
+  if (glx_window->software)
+    shm_presenter_destroy(&glx_window->presenter);
+
+#ifdef CEN64_OPENGL
   if (glx_window->context) {
     if (!glXMakeCurrent(glx_window->display, None, NULL)) {
       debug("destroy_glx_window: Could not release rendering context.\n");
@@ -235,6 +319,7 @@ int destroy_glx_window(struct glx_window *glx_window) {
     glXDestroyContext(glx_window->display, glx_window->context);
     glx_window->context = NULL;
   }
+#endif
 
   if (glx_window->window) {
     XDestroyWindow(glx_window->display, glx_window->window);
@@ -256,11 +341,18 @@ int destroy_glx_window(struct glx_window *glx_window) {
     glx_window->display = NULL;
   }
 
-  close(glx_window->select_pipefds[0]);
-  close(glx_window->select_pipefds[1]);
+  if (glx_window->frames.storage != NULL) {
+    frame_mailbox_destroy(&glx_window->frames);
+    close(glx_window->wake_fds[0]);
+
+    if (glx_window->wake_fds[1] != glx_window->wake_fds[0])
+      close(glx_window->wake_fds[1]);
+  }
+
   return 0;
 }
 
+#ifdef CEN64_OPENGL
 // Fills the array with attributes that best match the hints.
 void generate_attribute_list(int *attribute_list,
   const struct gl_window_hints *hints) {
@@ -305,6 +397,7 @@ void generate_attribute_list(int *attribute_list,
   /* Terminate the list. */
   attribute_list[idx++] = None;
 }
+#endif
 
 // Packs hints with a reasonable set of default hints.
 void get_default_gl_window_hints(struct gl_window_hints *hints) {
@@ -317,6 +410,7 @@ void get_default_gl_window_hints(struct gl_window_hints *hints) {
   hints->double_buffered = 1;
 }
 
+#ifdef CEN64_OPENGL
 // Generates a XVisualInfo that matches the attributes.
 int get_matching_visual_info(struct glx_window *window,
   int *attribute_list, XVisualInfo **visual_info) {
@@ -342,6 +436,24 @@ int get_matching_visual_info(struct glx_window *window,
   XFree(fb_configs);
   return status;
 }
+#endif
+
+// Finds a 24-bit TrueColor visual for the software presenter.
+int get_software_visual_info(struct glx_window *window,
+  XVisualInfo **visual_info) {
+  XVisualInfo visual_template;
+  int num_visuals;
+
+  visual_template.screen = window->screen;
+  visual_template.depth = 24;
+  visual_template.class = TrueColor;
+
+  *visual_info = XGetVisualInfo(window->display,
+    VisualScreenMask | VisualDepthMask | VisualClassMask,
+    &visual_template, &num_visuals);
+
+  return *visual_info == NULL || num_visuals == 0;
+}
 
 // Finds a windowing most at least as big as desired resolution.
 int get_matching_window_mode(struct glx_window *glx_window,
@@ -375,6 +487,7 @@ int get_matching_window_mode(struct glx_window *glx_window,
   return not_found;
 }
 
+#ifdef CEN64_OPENGL
 // Promotes the contents of the back buffer to the front buffer.
 int gl_swap_buffers(const struct gl_window *window) {
   const struct glx_window *glx_window;
@@ -383,6 +496,7 @@ int gl_swap_buffers(const struct gl_window *window) {
   glXSwapBuffers(glx_window->display, glx_window->window);
   return 0;
 }
+#endif
 
 // Informs the caller if an exit was requested.
 bool glx_window_exit_requested(struct glx_window *window) {
@@ -418,7 +532,17 @@ bool glx_window_poll_events(struct bus_controller *bus,
         break;
 
       case ConfigureNotify:
-        gl_window_resize_cb(event.xconfigure.width, event.xconfigure.height);
+        if (glx_window->software) {
+          if (shm_presenter_resize(&glx_window->presenter,
+            event.xconfigure.width, event.xconfigure.height))
+            debug("glx_window_poll_events: Failed to resize the image.\n");
+        }
+
+#ifdef CEN64_OPENGL
+        else
+          gl_window_resize_cb(event.xconfigure.width, event.xconfigure.height);
+#endif
+
         break;
 
       case KeyPress:
@@ -452,9 +576,11 @@ bool glx_window_poll_events(struct bus_controller *bus,
   return exit_requested;
 }
 
-// Copies the frame data to the render thread.
+// Copies the frame data to the render thread. This never waits on the
+// render thread; if it falls behind, it just misses out on frames.
 void glx_window_render_frame(struct glx_window *window, const void *data,
   unsigned xres, unsigned yres, unsigned xskip, unsigned type) {
+  struct frame_mailbox_slot *slot = frame_mailbox_back(&window->frames);
   size_t copy_size;
 
   switch (type & 0x3) {
@@ -475,58 +601,79 @@ void glx_window_render_frame(struct glx_window *window, const void *data,
 
   copy_size *= xres * yres;
 
-  // Grab the locks and pass the next frame to the UI.
-  // Wait for the UI if it didn't push out the last frame.
-  pthread_mutex_lock(&window->render_lock);
-
-  while (unlikely(window->frame_pending))
-    pthread_cond_wait(&window->render_cv, &window->render_lock);
-
-  memcpy(window->frame_data, data, copy_size);
-  window->frame_xres = xres;
-  window->frame_yres = yres;
-  window->frame_xskip = xskip;
-  window->frame_type = type;
-  window->frame_pending = true;
-
-  pthread_mutex_unlock(&window->render_lock);
-
-  // Write a dummy value to trigger the select() call.
-  write(window->select_pipefds[1], window, 1);
+  memcpy(slot->data, data, copy_size);
+  slot->xres = xres;
+  slot->yres = yres;
+  slot->xskip = xskip;
+  slot->type = type;
+
+  // Only signal the UI if it isn't already due to pick up a frame.
+  if (frame_mailbox_publish(&window->frames)) {
+#ifdef __linux__
+    uint64_t count = 1;
+
+    write(window->wake_fds[1], &count, sizeof(count));
+#else
+    write(window->wake_fds[1], window, 1);
+#endif
+  }
 }
 
 // Main window threads. Handles and pumps events.
 int glx_window_thread(struct gl_window *gl_window,
   struct glx_window *glx_window, struct bus_controller *bus) {
-  int frame_count, max_fds, x11_fd, pipe_fd;
+  int frame_count, max_fds, x11_fd, wake_fd;
   cen64_time last_report_time;
+  uint32_t last_report_frames;
   fd_set fdset;
 
+  // Software windows draw from THIS thread, too.
+  if (glx_window->software) {
+    XWindowAttributes attributes;
+
+    XGetWindowAttributes(glx_window->display,
+      glx_window->window, &attributes);
+
+    if (shm_presenter_create(&glx_window->presenter, glx_window->display,
+      glx_window->window, glx_window->visual_info,
+      attributes.width, attributes.height)) {
+      debug("glx_window_thread: Could not create the presenter.\n");
+
+      glx_window->software = false;
+      return 1;
+    }
+  }
+
+#ifdef CEN64_OPENGL
   // Activate the rendering context from THIS thread.
   // Any kind of GL call has to be done from here, or else.
-  if (!glXMakeCurrent(glx_window->display,
-    glx_window->window, glx_window->context)) {
-    debug("glx_window_thread: Could not attach rendering context.\n");
+  else {
+    if (!glXMakeCurrent(glx_window->display,
+      glx_window->window, glx_window->context)) {
+      debug("glx_window_thread: Could not attach rendering context.\n");
 
-    return 1;
-  }
+      return 1;
+    }
 
-  gl_window_init(gl_window);
+    gl_window_init(gl_window);
+  }
+#endif
 
   // Setup the fd_set and max_fds for the select() call.
   x11_fd = ConnectionNumber(glx_window->display);
-  pipe_fd = glx_window->select_pipefds[0];
+  wake_fd = glx_window->wake_fds[0];
 
-  max_fds = x11_fd > pipe_fd ? x11_fd: pipe_fd;
+  max_fds = x11_fd > wake_fd ? x11_fd: wake_fd;
   max_fds++;
 
   FD_ZERO(&fdset);
-  FD_SET(pipe_fd, &fdset);
+  FD_SET(wake_fd, &fdset);
   FD_SET(x11_fd, &fdset);
 
   // Prime the timer we use to report the VI/s.
   // Then stick ourselves into the UI main loop.
   get_time(&last_report_time);
+  last_report_frames = 0;
 
   for (frame_count = 0; ;) {
     fd_set ready_to_read = fdset;
@@ -538,26 +685,37 @@ int glx_window_thread(struct gl_window *gl_window,
           break;
       }
 
-      if (FD_ISSET(pipe_fd, &ready_to_read)) {
-        char dummy;
+      if (FD_ISSET(wake_fd, &ready_to_read)) {
+        const struct frame_mailbox_slot *slot;
 
-        // Deal with any of the synchronized state first.
-        pthread_mutex_lock(&glx_window->render_lock);
-        glx_window->frame_pending = false;
+        // Clear the notification before taking the frame, so that a
+        // frame published after this point signals us once more.
+        drain_wake_fds(glx_window->wake_fds);
 
-        gl_window_render_frame(gl_window, glx_window->frame_data,
-          glx_window->frame_xres, glx_window->frame_yres,
-          glx_window->frame_xskip, glx_window->frame_type);
+        if ((slot = frame_mailbox_take(&glx_window->frames)) != NULL) {
+          if (glx_window->software) {
+            shm_presenter_draw(&glx_window->presenter, slot->data,
+              slot->xres, slot->yres, slot->xskip, slot->type);
+          }
 
-        pthread_mutex_unlock(&glx_window->render_lock);
-        pthread_cond_signal(&glx_window->render_cv);
+#ifdef CEN64_OPENGL
+          else {
+            gl_window_render_frame(gl_window, slot->data,
+              slot->xres, slot->yres, slot->xskip, slot->type);
+          }
+#endif
 
-        // Clear the notification, possible update VI/s indicator.
-        read(pipe_fd, &dummy, sizeof(dummy));
+          if (unlikely(++frame_count == 60)) {
+            glx_window_update_window_title(glx_window,
+              &last_report_time, &last_report_frames);
 
-        if (unlikely(++frame_count == 60)) {
-          glx_window_update_window_title(glx_window, &last_report_time);
-          frame_count = 0;
+            frame_count = 0;
+          }
+
+          // Waiting on the server can pull events off the connection;
+          // don't leave them in the queue until the next one arrives.
+          if (unlikely(glx_window_poll_events(bus, glx_window)))
+            break;
         }
       }
     }
@@ -566,19 +724,28 @@ int glx_window_thread(struct gl_window *gl_window,
   return 0;
 }
 
-// Updates the window title.
+// Updates the window title. The VI/s rate counts every frame the
+// device produced, including any that were dropped.
 void glx_window_update_window_title(
-  struct glx_window *glx_window, cen64_time *last_report_time) {
+  struct glx_window *glx_window, cen64_time *last_report_time,
+  uint32_t *last_report_frames) {
+  uint32_t frames, dropped;
   cen64_time current_time;
   unsigned long long ns;
-  char window_title[64];
+  char window_title[128];
+
+  frames = cen64_atomic_load_u32(&glx_window->frames.published);
+  dropped = cen64_atomic_load_u32(&glx_window->frames.dropped);
 
   get_time(&current_time);
   ns = compute_time_difference(&current_time, last_report_time);
 
   snprintf(window_title, sizeof(window_title),
     "CEN64 ["CEN64_COMPILER" - "CEN64_ARCH_DIR"/"CEN64_ARCH_SUPPORT"]"
-    " - %.1f VI/s", (60 / ((double) ns / NS_PER_SEC)));
+    " - %.1f VI/s, %u dropped", ((frames - *last_report_frames) /
+    ((double) ns / NS_PER_SEC)), dropped);
+
+  *last_report_frames = frames;
 
   XStoreName(glx_window->display, glx_window->window, window_title);
   XFlush(glx_window->display);
@@ -10,10 +10,14 @@
 #ifndef __unix_x11_glx_window_h__
 #define __unix_x11_glx_window_h__
 #include "common.h"
+#include "os/frame_mailbox.h"
 #include "os/gl_window.h"
+#include "os/unix/x11/shm_presenter.h"
 
 #include <pthread.h>
+#ifdef CEN64_OPENGL
 #include <GL/glx.h>
+#endif
 #include <X11/Xatom.h>
 #include <X11/Xlib.h>
 #include <X11/Xutil.h>
@@ -29,10 +33,18 @@ struct glx_window {
   Window window;
   int screen;
 
+  // Frames are drawn with OpenGL, unless the window is in software mode
+  // (always the case when built without OpenGL).
+  bool software;
+  struct shm_presenter presenter;
+
+#ifdef CEN64_OPENGL
   GLXContext context;
+#endif
 
-  // Constant state used by threads.
-  int select_pipefds[2];
+  // Constant state used by threads. Frames are signalled through an
+  // eventfd where there is one (both ends are the same descriptor).
+  int wake_fds[2];
 
   uint8_t fixed_pad[CACHE_LINE_SIZE];
 
@@ -44,15 +56,8 @@ struct glx_window {
 
   uint8_t event_pad[CACHE_LINE_SIZE];
 
-  // Locks and whatnot for rendering.
-  pthread_mutex_t render_lock;
-  pthread_cond_t render_cv;
-
-  unsigned frame_xres, frame_yres, frame_xskip, frame_type;
-  uint8_t frame_data[MAX_FRAME_DATA_SIZE];
-  bool frame_pending;
-
-  uint8_t render_pad[CACHE_LINE_SIZE];
+  // Frames handed over for rendering.
+  struct frame_mailbox frames;
 };
 
 cen64_cold bool glx_window_exit_requested(struct glx_window *window);
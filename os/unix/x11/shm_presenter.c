@@ -0,0 +1,401 @@
+//
+// os/unix/x11/shm_presenter.c
+//
+// Presents frames without OpenGL, through MIT-SHM where possible.
+//
+// This file is subject to the terms and conditions defined in
+// 'LICENSE', which is part of this source code package.
+//
+
+#include "common.h"
+#include "common/debug.h"
+#include "os/gl_window.h"
+#include "os/unix/x11/shm_presenter.h"
+#include "vi/vi.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+#include <X11/extensions/XShm.h>
+
+cen64_cold static int shm_presenter_attach_error(
+  Display *display, XErrorEvent *event);
+static void shm_presenter_convert(const struct shm_presenter *presenter,
+  uint32_t *dest, const uint8_t *src, unsigned count, unsigned type);
+cen64_cold static int shm_presenter_create_image(
+  struct shm_presenter *presenter, unsigned width, unsigned height);
+cen64_cold static void shm_presenter_mask(unsigned long mask,
+  unsigned *shift, unsigned *bits);
+static uint32_t shm_presenter_pack(const struct shm_presenter *presenter,
+  unsigned r, unsigned g, unsigned b);
+cen64_cold static void shm_presenter_release_image(
+  struct shm_presenter *presenter);
+
+// Set if the server refuses to attach to a segment.
+static bool shm_presenter_attach_failed;
+
+// Catches the error raised when attaching fails (i.e., on a remote
+// display), which would otherwise bring the whole process down.
+int shm_presenter_attach_error(Display *display, XErrorEvent *event) {
+  shm_presenter_attach_failed = true;
+  return 0;
+}
+
+// Converts a row of the frame to the window's pixel format.
+void shm_presenter_convert(const struct shm_presenter *presenter,
+  uint32_t *dest, const uint8_t *src, unsigned count, unsigned type) {
+  unsigned i = 0;
+
+#ifdef VI_VECT_KERNELS
+  if (presenter->fast_path) {
+    i = count & ~0x7;
+
+    if (type == 2)
+      vi_vect_rgba5551_to_xrgb8888(dest, src, i);
+    else
+      vi_vect_rgba8888_to_xrgb8888(dest, src, i);
+  }
+#endif
+
+  for (; i < count; i++) {
+    unsigned r, g, b;
+
+    if (type == 2) {
+      unsigned pixel = src[i * 2] << 8 | src[i * 2 + 1];
+
+      r = pixel >> 11 & 0x1F;
+      g = pixel >> 6 & 0x1F;
+      b = pixel >> 1 & 0x1F;
+
+      r = r << 3 | r >> 2;
+      g = g << 3 | g >> 2;
+      b = b << 3 | b >> 2;
+    }
+
+    else {
+      r = src[i * 4];
+      g = src[i * 4 + 1];
+      b = src[i * 4 + 2];
+    }
+
+    dest[i] = shm_presenter_pack(presenter, r, g, b);
+  }
+}
+
+// Allocates an image the size of the window, in shared memory if the
+// server will have it.
+int shm_presenter_create_image(struct shm_presenter *presenter,
+  unsigned width, unsigned height) {
+  XShmSegmentInfo *shm_info = &presenter->shm_info;
+  int (*handler)(Display *, XErrorEvent *);
+  XImage *image;
+  char *data;
+
+  if (presenter->use_shm) {
+    if ((image = XShmCreateImage(presenter->display, presenter->visual,
+      presenter->depth, ZPixmap, NULL, shm_info, width, height)) == NULL)
+      goto create_out_noshm;
+
+    if ((shm_info->shmid = shmget(IPC_PRIVATE,
+      image->bytes_per_line * image->height, IPC_CREAT | 0600)) < 0) {
+      XDestroyImage(image);
+      goto create_out_noshm;
+    }
+
+    if ((shm_info->shmaddr = (char *) shmat(
+      shm_info->shmid, NULL, 0)) == (char *) -1) {
+      shmctl(shm_info->shmid, IPC_RMID, NULL);
+      XDestroyImage(image);
+      goto create_out_noshm;
+    }
+
+    image->data = shm_info->shmaddr;
+    shm_info->readOnly = False;
+
+    XSync(presenter->display, False);
+    shm_presenter_attach_failed = false;
+    handler = XSetErrorHandler(shm_presenter_attach_error);
+    XShmAttach(presenter->display, shm_info);
+    XSync(presenter->display, False);
+    XSetErrorHandler(handler);
+
+    // The segment goes away once both sides have detached from it.
+    shmctl(shm_info->shmid, IPC_RMID, NULL);
+
+    if (!shm_presenter_attach_failed) {
+      presenter->image = image;
+      return 0;
+    }
+
+    shmdt(shm_info->shmaddr);
+    image->data = NULL;
+    XDestroyImage(image);
+
+create_out_noshm:
+    debug("shm_presenter_create_image: MIT-SHM unavailable; using XPutImage.\n");
+    presenter->use_shm = false;
+  }
+
+  if ((image = XCreateImage(presenter->display, presenter->visual,
+    presenter->depth, ZPixmap, 0, NULL, width, height, 32, 0)) == NULL)
+    return 1;
+
+  if ((data = (char *) calloc(image->height, image->bytes_per_line)) == NULL) {
+    XDestroyImage(image);
+    return 1;
+  }
+
+  image->data = data;
+  presenter->image = image;
+  return 0;
+}
+
+// Finds where a channel lies within a pixel.
+void shm_presenter_mask(unsigned long mask, unsigned *shift, unsigned *bits) {
+  *shift = *bits = 0;
+
+  if (mask == 0)
+    return;
+
+  for (; !(mask & 0x1); mask >>= 1)
+    (*shift)++;
+
+  for (; mask & 0x1; mask >>= 1)
+    (*bits)++;
+}
+
+// Packs an 8-bit per channel color into the window's pixel format.
+uint32_t shm_presenter_pack(const struct shm_presenter *presenter,
+  unsigned r, unsigned g, unsigned b) {
+  unsigned channels[3] = {r, g, b};
+  uint32_t pixel = 0;
+  unsigned i;
+
+  for (i = 0; i < 3; i++) {
+    unsigned bits = presenter->bits[i];
+
+    pixel |= (bits >= 8 ? channels[i] << (bits - 8) :
+      channels[i] >> (8 - bits)) << presenter->shift[i];
+  }
+
+  if (presenter->swap_bytes) {
+    pixel = (pixel >> 24) | (pixel >> 8 & 0xFF00) |
+      (pixel << 8 & 0xFF0000) | (pixel << 24);
+  }
+
+  return pixel;
+}
+
+// Releases the image (and any shared memory behind it).
+void shm_presenter_release_image(struct shm_presenter *presenter) {
+  if (presenter->image == NULL)
+    return;
+
+  if (presenter->use_shm) {
+    XShmDetach(presenter->display, &presenter->shm_info);
+    XSync(presenter->display, False);
+    shmdt(presenter->shm_info.shmaddr);
+    presenter->image->data = NULL;
+  }
+
+  XDestroyImage(presenter->image);
+  presenter->image = NULL;
+}
+
+// Sets up a presenter for a window. Only TrueColor visuals with 32-bit
+// pixels are supported.
+int shm_presenter_create(struct shm_presenter *presenter,
+  Display *display, Window window, const XVisualInfo *visual_info,
+  unsigned width, unsigned height) {
+  memset(presenter, 0, sizeof(*presenter));
+
+  if (visual_info->class != TrueColor) {
+    debug("shm_presenter_create: The visual isn't TrueColor.\n");
+    return 1;
+  }
+
+  presenter->display = display;
+  presenter->window = window;
+  presenter->visual = visual_info->visual;
+  presenter->depth = visual_info->depth;
+
+  shm_presenter_mask(visual_info->red_mask,
+    presenter->shift + 0, presenter->bits + 0);
+  shm_presenter_mask(visual_info->green_mask,
+    presenter->shift + 1, presenter->bits + 1);
+  shm_presenter_mask(visual_info->blue_mask,
+    presenter->shift + 2, presenter->bits + 2);
+
+  presenter->gc = XCreateGC(display, window, 0, NULL);
+  presenter->use_shm = XShmQueryExtension(display) == True;
+
+  if (shm_presenter_resize(presenter, width, height)) {
+    shm_presenter_destroy(presenter);
+    return 1;
+  }
+
+  return 0;
+}
+
+// Releases any resources held by the presenter.
+void shm_presenter_destroy(struct shm_presenter *presenter) {
+  shm_presenter_release_image(presenter);
+
+  if (presenter->gc) {
+    XFreeGC(presenter->display, presenter->gc);
+    presenter->gc = NULL;
+  }
+
+  free(presenter->xmap);
+  free(presenter->row);
+
+  presenter->xmap = NULL;
+  presenter->row = NULL;
+}
+
+// Reallocates the image to match the size of the window.
+int shm_presenter_resize(struct shm_presenter *presenter,
+  unsigned width, unsigned height) {
+  static const union { uint16_t word; uint8_t bytes[2]; } host = {1};
+  unsigned *xmap;
+
+  if (width == 0)
+    width = 1;
+
+  if (height == 0)
+    height = 1;
+
+  shm_presenter_release_image(presenter);
+
+  if (shm_presenter_create_image(presenter, width, height)) {
+    debug("shm_presenter_resize: Failed to create an image.\n");
+    return 1;
+  }
+
+  if (presenter->image->bits_per_pixel != 32) {
+    debug("shm_presenter_resize: Only 32-bit pixels are supported.\n");
+    shm_presenter_release_image(presenter);
+    return 1;
+  }
+
+  // Anything outside of the view stays black.
+  memset(presenter->image->data, 0,
+    presenter->image->bytes_per_line * presenter->image->height);
+
+  presenter->swap_bytes = (presenter->image->byte_order == LSBFirst) !=
+    (host.bytes[0] == 1);
+
+  presenter->fast_path = !presenter->swap_bytes &&
+    presenter->shift[0] == 16 && presenter->bits[0] == 8 &&
+    presenter->shift[1] == 8 && presenter->bits[1] == 8 &&
+    presenter->shift[2] == 0 && presenter->bits[2] == 8;
+
+  // Fit the largest 4:3 view that'll go into the window.
+  if (width * 3 > height * 4) {
+    presenter->view_height = height;
+    presenter->view_width = height * 4 / 3;
+  }
+
+  else {
+    presenter->view_width = width;
+    presenter->view_height = width * 3 / 4;
+  }
+
+  if (presenter->view_width == 0)
+    presenter->view_width = 1;
+
+  if (presenter->view_height == 0)
+    presenter->view_height = 1;
+
+  presenter->view_x = (width - presenter->view_width) / 2;
+  presenter->view_y = (height - presenter->view_height) / 2;
+  presenter->width = width;
+  presenter->height = height;
+
+  if ((xmap = (unsigned *) realloc(presenter->xmap,
+    presenter->view_width * sizeof(*xmap))) == NULL) {
+    shm_presenter_release_image(presenter);
+    return 1;
+  }
+
+  presenter->xmap = xmap;
+  presenter->xmap_hres = 0;
+  return 0;
+}
+
+// Converts a frame, scales it into the view and sends it to the server.
+void shm_presenter_draw(struct shm_presenter *presenter,
+  const uint8_t *buffer, unsigned hres, unsigned vres,
+  unsigned hskip, unsigned type) {
+  const uint32_t *last_dest = NULL;
+  unsigned bpp, stride, x, y, last_sy;
+  XImage *image = presenter->image;
+
+  if (image == NULL || type < 2 || hres == 0 || vres == 0)
+    return;
+
+  bpp = type == 2 ? 2 : 4;
+  stride = (hres + hskip) * bpp;
+
+  if ((size_t) stride * vres > MAX_FRAME_DATA_SIZE)
+    return;
+
+  if (presenter->row_size < hres) {
+    uint32_t *row;
+
+    if ((row = (uint32_t *) realloc(presenter->row,
+      hres * sizeof(*row))) == NULL)
+      return;
+
+    presenter->row = row;
+    presenter->row_size = hres;
+  }
+
+  if (presenter->xmap_hres != hres) {
+    for (x = 0; x < presenter->view_width; x++)
+      presenter->xmap[x] = x * hres / presenter->view_width;
+
+    presenter->xmap_hres = hres;
+  }
+
+  // Rows of the view that sample the same row of the frame are copies.
+  for (last_sy = ~0U, y = 0; y < presenter->view_height; y++) {
+    unsigned sy = y * vres / presenter->view_height;
+    uint32_t *dest = (uint32_t *) (image->data + (presenter->view_y + y) *
+      image->bytes_per_line) + presenter->view_x;
+
+    if (sy == last_sy)
+      memcpy(dest, last_dest, presenter->view_width * sizeof(*dest));
+
+    else {
+      shm_presenter_convert(presenter, presenter->row,
+        buffer + sy * stride, hres, type);
+
+      for (x = 0; x < presenter->view_width; x++)
+        dest[x] = presenter->row[presenter->xmap[x]];
+    }
+
+    last_dest = dest;
+    last_sy = sy;
+  }
+
+  // Wait for the server to finish with the image before it's reused.
+  if (presenter->use_shm) {
+    XShmPutImage(presenter->display, presenter->window, presenter->gc,
+      image, 0, 0, 0, 0, presenter->width, presenter->height, False);
+
+    XSync(presenter->display, False);
+  }
+
+  else {
+    XPutImage(presenter->display, presenter->window, presenter->gc,
+      image, 0, 0, 0, 0, presenter->width, presenter->height);
+
+    XFlush(presenter->display);
+  }
+}
+
@@ -0,0 +1,65 @@
+//
+// os/unix/x11/shm_presenter.h
+//
+// Presents frames without OpenGL, through MIT-SHM where possible.
+//
+// This file is subject to the terms and conditions defined in
+// 'LICENSE', which is part of this source code package.
+//
+
+#ifndef __unix_x11_shm_presenter_h__
+#define __unix_x11_shm_presenter_h__
+#include "common.h"
+
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+#include <X11/extensions/XShm.h>
+
+// Frames are converted to the window's pixel format on the host and
+// scaled (nearest neighbour, keeping a 4:3 aspect) into an XImage the
+// size of the window. The image lives in memory shared with the X
+// server when it supports MIT-SHM; otherwise, it's sent over the wire.
+struct shm_presenter {
+  Display *display;
+  Window window;
+  Visual *visual;
+  int depth;
+  GC gc;
+
+  XImage *image;
+  XShmSegmentInfo shm_info;
+  bool use_shm;
+
+  // Set if pixels can be written as xRGB8888 in host byte order.
+  bool fast_path;
+  bool swap_bytes;
+  unsigned shift[3];
+  unsigned bits[3];
+
+  // The part of the window that frames are drawn to.
+  unsigned width, height;
+  unsigned view_x, view_y;
+  unsigned view_width, view_height;
+
+  // Source column sampled by each column of the view.
+  unsigned *xmap;
+  unsigned xmap_hres;
+
+  // A row of the frame, converted to the window's pixel format.
+  uint32_t *row;
+  unsigned row_size;
+};
+
+cen64_cold int shm_presenter_create(struct shm_presenter *presenter,
+  Display *display, Window window, const XVisualInfo *visual_info,
+  unsigned width, unsigned height);
+cen64_cold void shm_presenter_destroy(struct shm_presenter *presenter);
+cen64_cold int shm_presenter_resize(struct shm_presenter *presenter,
+  unsigned width, unsigned height);
+
+void shm_presenter_draw(struct shm_presenter *presenter,
+  const uint8_t *buffer, unsigned hres, unsigned vres,
+  unsigned hskip, unsigned type);
+
+#endif
+
@@ -235,6 +235,17 @@ int os_main(struct cen64_options *options, struct rom_file *ddipl,
         MB_OK | MB_ICONEXCLAMATION);
   }
 
+  device.rsp_thread_window = options->rsp_thread_window;
+  device.rdp_threads = options->rdp_threads;
+  device.rdp_async = options->rdp_async;
+  device.rdp_capture_path = options->rdp_capture_path;
+  device.audio_sink = options->audio_sink;
+  device.speed = options->speed;
+  device.pace_audio = options->pace_audio;
+  device.dump_frames_target = options->dump_frames_target;
+  device.hash_frames_path = options->hash_frames_path;
+  device.benchmark_frames = options->benchmark_frames;
+
   // Pull up the debug API if it was requested.
   device.debug_sfd = -1;
 
@@ -255,7 +266,9 @@ int os_main(struct cen64_options *options, struct rom_file *ddipl,
   if ((t_hnd = CreateThread(NULL, 0,
     run_device_thread, &device, 0, NULL)) != NULL) {
 
-    gl_window_thread(&device.vi.gl_window, &device.bus);
+    if (!options->no_interface)
+      gl_window_thread(&device.vi.gl_window, &device.bus);
+
     WaitForSingleObject(t_hnd, INFINITE);
   }
 
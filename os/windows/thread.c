@@ -0,0 +1,120 @@
+//
+// os/windows/thread.c
+//
+// Threading primitives for the simulation threads.
+//
+// This file is subject to the terms and conditions defined in
+// 'LICENSE', which is part of this source code package.
+//
+
+#include "os/thread.h"
+#include <windows.h>
+
+struct cen64_thread_start {
+  cen64_thread_func func;
+  void *opaque;
+};
+
+// Adapts the thread function to what CreateThread expects.
+static DWORD WINAPI cen64_thread_trampoline(LPVOID opaque) {
+  struct cen64_thread_start start = *(struct cen64_thread_start *) opaque;
+
+  free(opaque);
+  start.func(start.opaque);
+  return 0;
+}
+
+// Spawns a thread running func(opaque).
+int cen64_thread_create(cen64_thread *thread,
+  cen64_thread_func func, void *opaque) {
+  struct cen64_thread_start *start;
+
+  if ((start = malloc(sizeof(*start))) == NULL)
+    return 1;
+
+  start->func = func;
+  start->opaque = opaque;
+
+  if ((*thread = CreateThread(NULL, 0,
+    cen64_thread_trampoline, start, 0, NULL)) == NULL) {
+    free(start);
+    return 1;
+  }
+
+  return 0;
+}
+
+// Waits for a thread to exit.
+int cen64_thread_join(cen64_thread *thread) {
+  if (WaitForSingleObject(*thread, INFINITE) != WAIT_OBJECT_0)
+    return 1;
+
+  CloseHandle(*thread);
+  return 0;
+}
+
+// Gives up the remainder of the thread's time slice.
+void cen64_thread_yield(void) {
+  SwitchToThread();
+}
+
+// Returns the number of processors available to the host.
+unsigned cen64_thread_cpu_count(void) {
+  SYSTEM_INFO info;
+
+  GetSystemInfo(&info);
+  return info.dwNumberOfProcessors > 0 ? info.dwNumberOfProcessors : 1;
+}
+
+// Initializes a mutex.
+int cen64_mutex_create(cen64_mutex *mutex) {
+  InitializeCriticalSection(mutex);
+  return 0;
+}
+
+// Releases resources held by a mutex.
+int cen64_mutex_destroy(cen64_mutex *mutex) {
+  DeleteCriticalSection(mutex);
+  return 0;
+}
+
+// Acquires a mutex.
+int cen64_mutex_lock(cen64_mutex *mutex) {
+  EnterCriticalSection(mutex);
+  return 0;
+}
+
+// Releases a mutex.
+int cen64_mutex_unlock(cen64_mutex *mutex) {
+  LeaveCriticalSection(mutex);
+  return 0;
+}
+
+// Initializes a condition variable.
+int cen64_cv_create(cen64_cv *cv) {
+  InitializeConditionVariable(cv);
+  return 0;
+}
+
+// Releases resources held by a condition variable.
+int cen64_cv_destroy(cen64_cv *cv) {
+  return 0;
+}
+
+// Atomically releases the mutex and waits on the condition variable.
+int cen64_cv_wait(cen64_cv *cv, cen64_mutex *mutex) {
+  return !SleepConditionVariableCS(cv, mutex, INFINITE);
+}
+
+// Wakes up a thread waiting on the condition variable.
+int cen64_cv_signal(cen64_cv *cv) {
+  WakeConditionVariable(cv);
+  return 0;
+}
+
+// Wakes up every thread waiting on the condition variable.
+int cen64_cv_broadcast(cen64_cv *cv) {
+  WakeAllConditionVariable(cv);
+  return 0;
+}
+
@@ -8,6 +8,7 @@
 //
 
 #include "os/timer.h"
+#include <intrin.h>
 #include <windows.h>
 
 // Computes the difference, in ns, between two times.
@@ -24,3 +25,22 @@ void get_time(cen64_time *t) {
   *t = timeGetTime();
 }
 
+// Returns a free-running host cycle count, or 0 if there isn't one.
+uint64_t get_host_cycles(void) {
+  return __rdtsc();
+}
+
+// Gets the time (in ns) from the clock that sleep_until() uses.
+uint64_t get_sleep_time(void) {
+  return timeGetTime() * 1000000ULL;
+}
+
+// Sleeps until the deadline has passed (or returns right away if it
+// already has). There's only millisecond resolution to be had here.
+void sleep_until(uint64_t deadline) {
+  uint64_t now = get_sleep_time();
+
+  if (now < deadline)
+    Sleep((DWORD) ((deadline - now + 999999) / 1000000));
+}
+
@@ -25,9 +25,28 @@ const char *pi_register_mnemonics[NUM_PI_REGISTERS] = {
 };
 #endif
  
+static void pi_dma_copy(struct pi_controller *pi,
+  uint32_t dest, uint32_t source, uint32_t length);
 static int pi_dma_read(struct pi_controller *pi);
 static int pi_dma_write(struct pi_controller *pi);
  
+// Moves words between two devices on the bus, a block at a time.
+void pi_dma_copy(struct pi_controller *pi,
+  uint32_t dest, uint32_t source, uint32_t length) {
+  uint32_t words[64];
+  unsigned i, count;
+
+  for (i = 0; i < length / 4; i += count) {
+    count = length / 4 - i;
+
+    if (count > sizeof(words) / sizeof(*words))
+      count = sizeof(words) / sizeof(*words);
+
+    bus_read_block(pi, source + i * 4, words, count);
+    bus_write_block(pi, dest + i * 4, words, count);
+  }
+}
+
 // Copies data from the the PI into RDRAM.
 static int pi_dma_read(struct pi_controller *pi) {
   uint32_t dest = pi->regs[PI_CART_ADDR_REG] & 0xFFFFFFF;
@@ -46,17 +65,10 @@ static int pi_dma_read(struct pi_controller *pi) {
     length = (length + 7) & ~7;
 
   if (pi->bus->dd->rom && ((dest & 0x05000000) == 0x05000000)) {
-    unsigned i;
- 
     source &= ~0xC; // Word-aligned.
     dest &= ~0xC; // Word-aligned.
 
-    for (i = 0; i < length / 4; i++) {
-      uint32_t word;
- 
-      bus_read_word(pi, source + (i * 4), &word);
-      bus_write_word(pi, dest + (i * 4), word, ~0U);
-    }
+    pi_dma_copy(pi, dest, source, length);
   }
  
   pi->regs[PI_DRAM_ADDR_REG] += length;
@@ -98,17 +110,10 @@ static int pi_dma_write(struct pi_controller *pi) {
   }
  
   else if (pi->bus->dd->rom && ((source & 0x05000000) == 0x05000000)) {
-    unsigned i;
- 
     source &= ~0xC; // Word-aligned.
     dest &= ~0xC; // Word-aligned.
 
-    for (i = 0; i < length / 4; i++) {
-      uint32_t word;
- 
-      bus_read_word(pi, source + (i * 4), &word);
-      bus_write_word(pi, dest + (i * 4), word, ~0U);
-    }
+    pi_dma_copy(pi, dest, source, length);
   }
  
   else if ((source & 0x08000000) == 0x08000000) {
@@ -0,0 +1,135 @@
+//
+// rdp/blender.c: RDP blender.
+//
+// CEN64: Cycle-Accurate Nintendo 64 Simulator.
+// Copyright (C) 2014, Tyler J. Stachecki.
+//
+// This file is subject to the terms and conditions defined in
+// 'LICENSE', which is part of this source code package.
+//
+
+#include "common.h"
+#include "rdp/blender.h"
+#include "rdp/rdp.h"
+#include "rdp/state.h"
+
+static const struct rdp_color_lanes *rdp_blend_color(
+  const struct rdp_blender *blender,
+  const struct rdp_blender_inputs *inputs, unsigned sel);
+static void rdp_blender_broadcast(int16_t *lanes, int32_t value);
+
+// Resolves the selectors shared by both color inputs.
+const struct rdp_color_lanes *rdp_blend_color(
+  const struct rdp_blender *blender,
+  const struct rdp_blender_inputs *inputs, unsigned sel) {
+  switch (sel & 0x3) {
+    case 0: return &inputs->pixel;
+    case 1: return &inputs->memory;
+    case 2: return &blender->blend;
+  }
+
+  return &blender->fog;
+}
+
+void rdp_blender_broadcast(int16_t *lanes, int32_t value) {
+  unsigned i;
+
+  for (i = 0; i < RDP_LANES; i++)
+    lanes[i] = value;
+}
+
+// Resolves the selectors in the state against a set of inputs.
+void rdp_blender_setup(struct rdp_blender *blender,
+  const struct rdp_state *state, const struct rdp_blender_inputs *inputs) {
+  const struct rdp_other_modes *modes = &state->other_modes;
+  unsigned cycle, ch;
+
+  rdp_blender_broadcast(blender->blend.c[0], state->blend_color.r);
+  rdp_blender_broadcast(blender->blend.c[1], state->blend_color.g);
+  rdp_blender_broadcast(blender->blend.c[2], state->blend_color.b);
+  rdp_blender_broadcast(blender->blend.c[3], state->blend_color.a);
+  rdp_blender_broadcast(blender->fog.c[0], state->fog_color.r);
+  rdp_blender_broadcast(blender->fog.c[1], state->fog_color.g);
+  rdp_blender_broadcast(blender->fog.c[2], state->fog_color.b);
+  rdp_blender_broadcast(blender->fog.c[3], state->fog_color.a);
+  rdp_blender_broadcast(blender->always, -1);
+
+  for (cycle = 0; cycle < 2; cycle++) {
+    const struct rdp_color_lanes *p, *m;
+
+    p = rdp_blend_color(blender, inputs, modes->blend_m1a[cycle]);
+    m = rdp_blend_color(blender, inputs, modes->blend_m2a[cycle]);
+
+    for (ch = 0; ch < 3; ch++) {
+      blender->src[cycle][ch][0] = p->c[ch];
+      blender->src[cycle][ch][1] = m->c[ch];
+    }
+
+    blender->m1b[cycle] = modes->blend_m1b[cycle] & 0x3;
+    blender->m2b[cycle] = modes->blend_m2b[cycle] & 0x3;
+  }
+
+  blender->force = modes->force_blend;
+}
+
+// Evaluates (P * A + M * B) / (A + B) for one cycle of the blender.
+// Lanes that aren't enabled pass the first color input through.
+void rdp_blend(const struct rdp_blender *blender, unsigned cycle,
+  const struct rdp_blender_inputs *inputs, const int16_t *enable,
+  struct rdp_color_lanes *out) {
+  cen64_align(int16_t a[RDP_LANES], 16);
+  cen64_align(int16_t b[RDP_LANES], 16);
+  unsigned ch, i;
+
+  for (i = 0; i < RDP_LANES; i++) {
+    switch (blender->m1b[cycle]) {
+      case 0: a[i] = inputs->pixel.c[3][i]; break;
+      case 1: a[i] = blender->fog.c[3][i]; break;
+      case 2: a[i] = inputs->shade_alpha[i]; break;
+      default: a[i] = 0; break;
+    }
+
+    switch (blender->m2b[cycle]) {
+      case 0: b[i] = 0xFF - a[i]; break;
+      case 1: b[i] = inputs->memory_cvg[i] << 5; break;
+      case 2: b[i] = 0xFF; break;
+      default: b[i] = 0; break;
+    }
+  }
+
+  for (ch = 0; ch < 3; ch++) {
+    const int16_t * const *src = blender->src[cycle][ch];
+
+#if defined(RDP_VECT_KERNELS) && !defined(RDP_SCALAR_PIPELINE)
+    rdp_vect_blend(out->c[ch], src[0], src[1], a, b, enable, blender->force);
+#else
+    rdp_blend_lanes_scalar(out->c[ch], src[0], src[1],
+      a, b, enable, blender->force);
+#endif
+  }
+
+  if (out != &inputs->pixel)
+    memcpy(out->c[3], inputs->pixel.c[3], sizeof(out->c[3]));
+}
+
+// Reference version of the per-channel kernel; the host's vector
+// kernel must produce exactly the same results.
+void rdp_blend_lanes_scalar(int16_t *out, const int16_t *p,
+  const int16_t *m, const int16_t *a, const int16_t *b,
+  const int16_t *enable, bool force) {
+  unsigned i;
+
+  for (i = 0; i < RDP_LANES; i++) {
+    int32_t sum = force ? 0xFF : a[i] + b[i];
+    int32_t value;
+
+    // Forced blends skip the normalization step entirely.
+    if (!enable[i] || sum == 0)
+      value = p[i];
+    else
+      value = (p[i] * a[i] + m[i] * b[i]) / sum;
+
+    out[i] = value > 0xFF ? 0xFF : value;
+  }
+}
+
@@ -0,0 +1,56 @@
+//
+// rdp/blender.h: RDP blender.
+//
+// CEN64: Cycle-Accurate Nintendo 64 Simulator.
+// Copyright (C) 2014, Tyler J. Stachecki.
+//
+// This file is subject to the terms and conditions defined in
+// 'LICENSE', which is part of this source code package.
+//
+
+#ifndef __rdp_blender_h__
+#define __rdp_blender_h__
+#include "common.h"
+#include "rdp/state.h"
+
+struct rdp_blender_inputs {
+  struct rdp_color_lanes pixel;
+  struct rdp_color_lanes memory;
+  cen64_align(int16_t shade_alpha[RDP_LANES], 16);
+  cen64_align(int16_t memory_cvg[RDP_LANES], 16);
+
+  // Lanes that blend (all bits set) rather than pass through.
+  cen64_align(int16_t enable[RDP_LANES], 16);
+};
+
+// The blender's selectors, resolved against a set of inputs.
+struct rdp_blender {
+  struct rdp_color_lanes blend;
+  struct rdp_color_lanes fog;
+  cen64_align(int16_t always[RDP_LANES], 16);
+
+  // Sources for P and M; indexed by cycle, channel and input.
+  const int16_t *src[2][3][2];
+  unsigned m1b[2];
+  unsigned m2b[2];
+  bool force;
+};
+
+// Resolves the selectors in the state against a set of inputs.
+void rdp_blender_setup(struct rdp_blender *blender,
+  const struct rdp_state *state, const struct rdp_blender_inputs *inputs);
+
+// Evaluates (P * A + M * B) / (A + B) for one cycle of the blender.
+// Lanes that aren't enabled pass the first color input through.
+void rdp_blend(const struct rdp_blender *blender, unsigned cycle,
+  const struct rdp_blender_inputs *inputs, const int16_t *enable,
+  struct rdp_color_lanes *out);
+
+// Reference version of the per-channel kernel; the host's vector
+// kernel must produce exactly the same results.
+void rdp_blend_lanes_scalar(int16_t *out, const int16_t *p,
+  const int16_t *m, const int16_t *a, const int16_t *b,
+  const int16_t *enable, bool force);
+
+#endif
+
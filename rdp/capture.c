@@ -0,0 +1,260 @@
+//
+// rdp/capture.c: RDP command list capture.
+//
+// CEN64: Cycle-Accurate Nintendo 64 Simulator.
+// Copyright (C) 2014, Tyler J. Stachecki.
+//
+// This file is subject to the terms and conditions defined in
+// 'LICENSE', which is part of this source code package.
+//
+
+#include "common.h"
+#include "bus/controller.h"
+#include "rdp/capture.h"
+#include "rdp/commands.h"
+#include "rdp/cpu.h"
+#include "rdp/framebuffer.h"
+#include "rdp/state.h"
+#include "ri/controller.h"
+
+static void rdp_capture_image(struct rdp_image *image, uint64_t word);
+static void rdp_capture_range(struct rdp_capture *capture,
+  const uint8_t *ram, uint32_t address, uint32_t length);
+static void rdp_capture_rows(struct rdp_capture *capture,
+  const uint8_t *ram, uint32_t address, unsigned width, unsigned size);
+static void rdp_capture_write32(struct rdp_capture *capture, uint32_t word);
+
+// Decodes a SET_*_IMAGE command.
+void rdp_capture_image(struct rdp_image *image, uint64_t word) {
+  image->format = (enum rdp_format) (word >> 53 & 0x7);
+  image->size = (enum rdp_size) (word >> 51 & 0x3);
+  image->width = (word >> 32 & 0x3FF) + 1;
+  image->address = word & 0xFFFFFF;
+}
+
+// Records any pages in the range that a replay doesn't have yet.
+void rdp_capture_range(struct rdp_capture *capture,
+  const uint8_t *ram, uint32_t address, uint32_t length) {
+  uint32_t page, last;
+
+  if (length == 0)
+    return;
+
+  if (length > RDP_RAM_MASK + 1)
+    length = RDP_RAM_MASK + 1;
+
+  last = (address + length - 1) / RDP_CAPTURE_PAGE_SIZE;
+
+  for (page = address / RDP_CAPTURE_PAGE_SIZE; page <= last; page++) {
+    unsigned index = page % RDP_CAPTURE_PAGES;
+    uint32_t offset = index * RDP_CAPTURE_PAGE_SIZE;
+
+    if (capture->referenced[index])
+      continue;
+
+    capture->referenced[index] = 1;
+
+    if (!memcmp(capture->shadow + offset, ram + offset,
+      RDP_CAPTURE_PAGE_SIZE))
+      continue;
+
+    memcpy(capture->shadow + offset, ram + offset, RDP_CAPTURE_PAGE_SIZE);
+    rdp_capture_write32(capture, RDP_CAPTURE_TAG_PAGE);
+    rdp_capture_write32(capture, offset);
+    fwrite(ram + offset, RDP_CAPTURE_PAGE_SIZE, 1, capture->file);
+  }
+}
+
+// Records the scissored rows of an image that a primitive can touch.
+void rdp_capture_rows(struct rdp_capture *capture,
+  const uint8_t *ram, uint32_t address, unsigned width, unsigned size) {
+  unsigned yh = capture->scissor.yh >> 2, yl = capture->scissor.yl >> 2;
+  uint32_t stride = (width << size) >> 1;
+
+  if (yl >= yh)
+    rdp_capture_range(capture, ram, address + yh * stride,
+      (yl - yh + 1) * stride);
+}
+
+void rdp_capture_write32(struct rdp_capture *capture, uint32_t word) {
+  uint8_t bytes[4];
+
+  bytes[0] = word >> 24;
+  bytes[1] = word >> 16;
+  bytes[2] = word >> 8;
+  bytes[3] = word;
+
+  fwrite(bytes, sizeof(bytes), 1, capture->file);
+}
+
+// Starts writing every command list the RDP sees out to a file.
+int rdp_capture_start(struct rdp *rdp, const char *path) {
+  struct rdp_capture *capture;
+
+  if ((capture = (struct rdp_capture *) calloc(1, sizeof(*capture))) == NULL)
+    return 1;
+
+  capture->max_words = 0x1000;
+  capture->shadow = (uint8_t *) calloc(1, RDP_RAM_MASK + 1);
+  capture->words = (uint64_t *) malloc(
+    capture->max_words * sizeof(*capture->words));
+
+  if (capture->shadow == NULL || capture->words == NULL ||
+    (capture->file = fopen(path, "wb")) == NULL) {
+    free(capture->words);
+    free(capture->shadow);
+    free(capture);
+    return 1;
+  }
+
+  // Start out with the same state rdp_init leaves behind.
+  capture->color_image = rdp->state.color_image;
+  capture->texture_image = rdp->state.texture_image;
+  capture->z_image = rdp->state.z_image;
+  capture->scissor = rdp->state.scissor;
+
+  fwrite(RDP_CAPTURE_MAGIC, 8, 1, capture->file);
+  rdp_capture_write32(capture, RDP_CAPTURE_VERSION);
+
+  rdp->capture = capture;
+  return 0;
+}
+
+// Finishes off the capture file, if there is one.
+void rdp_capture_stop(struct rdp *rdp) {
+  struct rdp_capture *capture = rdp->capture;
+
+  if (capture == NULL)
+    return;
+
+  rdp_capture_list(capture, rdp->bus->ri->ram);
+
+  if (ferror(capture->file))
+    debug("rdp_capture_stop: Failed to write out the capture.\n");
+
+  fclose(capture->file);
+  free(capture->words);
+  free(capture->shadow);
+  free(capture);
+
+  rdp->capture = NULL;
+}
+
+// Adds a command to the list being captured. RDRAM that the command
+// reads (or draws over) is recorded before the command has run.
+void rdp_capture_command(struct rdp_capture *capture,
+  const uint8_t *ram, const uint64_t *cmd, unsigned length) {
+  const struct rdp_image *texture = &capture->texture_image;
+  const struct rdp_image *color = &capture->color_image;
+  unsigned sl, tl, sh, th;
+  uint32_t start, end;
+
+  sl = cmd[0] >> 44 & 0xFFF;
+  tl = cmd[0] >> 32 & 0xFFF;
+  sh = cmd[0] >> 12 & 0xFFF;
+  th = cmd[0] & 0xFFF;
+
+  switch (cmd[0] >> 56 & 0x3F) {
+    case RDP_CMD_SET_SCISSOR:
+      capture->scissor.xh = sl;
+      capture->scissor.yh = tl;
+      capture->scissor.xl = sh;
+      capture->scissor.yl = th;
+      break;
+
+    case RDP_CMD_SET_TEXTURE_IMAGE:
+      rdp_capture_image(&capture->texture_image, cmd[0]);
+      break;
+
+    case RDP_CMD_SET_Z_IMAGE:
+      capture->z_image = cmd[0] & 0xFFFFFF;
+      break;
+
+    case RDP_CMD_SET_COLOR_IMAGE:
+      rdp_capture_image(&capture->color_image, cmd[0]);
+      break;
+
+    case RDP_CMD_LOAD_BLOCK:
+      start = texture->address + (((tl * texture->width + sl) <<
+        texture->size) >> 1);
+      end = (((sh - sl + 1) << texture->size) + 1) >> 1;
+
+      if (sh >= sl)
+        rdp_capture_range(capture, ram, start, (end + 7) & ~0x7);
+
+      break;
+
+    case RDP_CMD_LOAD_TILE:
+      start = texture->address + (((tl >> 2) * texture->width + (sl >> 2))
+        << texture->size >> 1);
+      end = texture->address + (((th >> 2) * texture->width + (sh >> 2) + 1)
+        << texture->size >> 1);
+
+      if (end > start)
+        rdp_capture_range(capture, ram, start, end - start);
+
+      break;
+
+    case RDP_CMD_LOAD_TLUT:
+      start = texture->address + ((tl >> 2) * texture->width + (sl >> 2)) * 2;
+
+      if (sh >= sl)
+        rdp_capture_range(capture, ram, start, ((sh >> 2) - (sl >> 2) + 1) * 2);
+
+      break;
+
+    // Anything that draws: the color and depth images are read from as
+    // well as written to, so they're recorded as they stand.
+    case 0x08: case 0x09: case 0x0A: case 0x0B:
+    case 0x0C: case 0x0D: case 0x0E: case 0x0F:
+    case 0x24: case 0x25: case 0x36:
+      rdp_capture_rows(capture, ram, color->address, color->width, color->size);
+      rdp_capture_rows(capture, ram, capture->z_image, color->width,
+        RDP_SIZE_16BPP);
+      break;
+  }
+
+  if (capture->num_words + length > capture->max_words) {
+    uint64_t *words = (uint64_t *) realloc(capture->words,
+      capture->max_words * 2 * sizeof(*words));
+
+    if (words == NULL)
+      return;
+
+    capture->words = words;
+    capture->max_words *= 2;
+  }
+
+  memcpy(capture->words + capture->num_words, cmd, length * sizeof(*cmd));
+  capture->num_words += length;
+}
+
+// Writes out the commands captured since the last list. They must have
+// been drawn by now: a replay leaves the pages they referenced looking
+// just like RDRAM does, so those pages aren't recorded again unless
+// something else changes them.
+void rdp_capture_list(struct rdp_capture *capture, const uint8_t *ram) {
+  unsigned i;
+
+  if (capture->num_words > 0) {
+    rdp_capture_write32(capture, RDP_CAPTURE_TAG_LIST);
+    rdp_capture_write32(capture, capture->num_words);
+
+    for (i = 0; i < capture->num_words; i++) {
+      uint64_t word = htonll(capture->words[i]);
+      fwrite(&word, sizeof(word), 1, capture->file);
+    }
+  }
+
+  for (i = 0; i < RDP_CAPTURE_PAGES; i++) {
+    uint32_t offset = i * RDP_CAPTURE_PAGE_SIZE;
+
+    if (capture->referenced[i]) {
+      memcpy(capture->shadow + offset, ram + offset, RDP_CAPTURE_PAGE_SIZE);
+      capture->referenced[i] = 0;
+    }
+  }
+
+  capture->num_words = 0;
+}
+
@@ -0,0 +1,65 @@
+//
+// rdp/capture.h: RDP command list capture.
+//
+// CEN64: Cycle-Accurate Nintendo 64 Simulator.
+// Copyright (C) 2014, Tyler J. Stachecki.
+//
+// This file is subject to the terms and conditions defined in
+// 'LICENSE', which is part of this source code package.
+//
+
+#ifndef __rdp_capture_h__
+#define __rdp_capture_h__
+#include "common.h"
+#include "rdp/framebuffer.h"
+#include "rdp/state.h"
+#include <stdio.h>
+
+// A capture is an 8-byte magic and a 32-bit version, then a series of
+// records that each start with a 32-bit tag:
+//
+//   PAGE: a 32-bit RDRAM address, then RDP_CAPTURE_PAGE_SIZE bytes.
+//   LIST: a 32-bit word count, then that many 64-bit command words.
+//
+// Everything is big-endian. A page is recorded ahead of the list that
+// references it, but only if a replay wouldn't already have its data.
+#define RDP_CAPTURE_MAGIC "CEN64RDP"
+#define RDP_CAPTURE_VERSION 1
+
+#define RDP_CAPTURE_TAG_PAGE 0x50414745U
+#define RDP_CAPTURE_TAG_LIST 0x4C495354U
+
+#define RDP_CAPTURE_PAGE_SIZE 0x1000
+#define RDP_CAPTURE_PAGES ((RDP_RAM_MASK + 1) / RDP_CAPTURE_PAGE_SIZE)
+
+struct rdp;
+
+struct rdp_capture {
+  FILE *file;
+
+  // RDRAM as a replay of the capture so far would have it.
+  uint8_t *shadow;
+
+  // Pages already checked against the shadow for the current list.
+  uint8_t referenced[RDP_CAPTURE_PAGES];
+
+  uint64_t *words;
+  unsigned num_words;
+  unsigned max_words;
+
+  // Just enough state to work out which pages commands touch.
+  struct rdp_image color_image;
+  struct rdp_image texture_image;
+  uint32_t z_image;
+  struct rdp_scissor scissor;
+};
+
+cen64_cold int rdp_capture_start(struct rdp *rdp, const char *path);
+cen64_cold void rdp_capture_stop(struct rdp *rdp);
+
+void rdp_capture_command(struct rdp_capture *capture,
+  const uint8_t *ram, const uint64_t *cmd, unsigned length);
+void rdp_capture_list(struct rdp_capture *capture, const uint8_t *ram);
+
+#endif
+
@@ -0,0 +1,201 @@
+//
+// rdp/combiner.c: RDP color combiner.
+//
+// CEN64: Cycle-Accurate Nintendo 64 Simulator.
+// Copyright (C) 2014, Tyler J. Stachecki.
+//
+// This file is subject to the terms and conditions defined in
+// 'LICENSE', which is part of this source code package.
+//
+
+#include "common.h"
+#include "rdp/combiner.h"
+#include "rdp/rdp.h"
+#include "rdp/state.h"
+
+static const struct rdp_color_lanes *rdp_combine_color(
+  const struct rdp_combiner *combiner,
+  const struct rdp_combiner_inputs *inputs, unsigned sel);
+static const int16_t *rdp_combine_alpha(const struct rdp_combiner *combiner,
+  const struct rdp_combiner_inputs *inputs, unsigned sel);
+static void rdp_combiner_broadcast(int16_t *lanes, int32_t value);
+static int32_t rdp_combine_clamp(int32_t value);
+static void rdp_combiner_setup_cycle(struct rdp_combiner *combiner,
+  const struct rdp_combine *combine,
+  const struct rdp_combiner_inputs *inputs, unsigned cycle);
+
+// Resolves the selectors that every color input shares.
+const struct rdp_color_lanes *rdp_combine_color(
+  const struct rdp_combiner *combiner,
+  const struct rdp_combiner_inputs *inputs, unsigned sel) {
+  switch (sel) {
+    case 0: return &inputs->combined;
+    case 1: return &inputs->texel0;
+    case 2: return &inputs->texel1;
+    case 3: return &combiner->prim;
+    case 4: return &inputs->shade;
+    case 5: return &combiner->env;
+  }
+
+  return NULL;
+}
+
+// Resolves the selectors that every alpha input shares.
+const int16_t *rdp_combine_alpha(const struct rdp_combiner *combiner,
+  const struct rdp_combiner_inputs *inputs, unsigned sel) {
+  const struct rdp_color_lanes *color;
+
+  if ((color = rdp_combine_color(combiner, inputs, sel)) != NULL)
+    return color->c[3];
+
+  return sel == 6 ? combiner->one : combiner->zero;
+}
+
+void rdp_combiner_broadcast(int16_t *lanes, int32_t value) {
+  unsigned i;
+
+  for (i = 0; i < RDP_LANES; i++)
+    lanes[i] = value;
+}
+
+int32_t rdp_combine_clamp(int32_t value) {
+  if (value < 0)
+    return 0;
+
+  return value > 0xFF ? 0xFF : value;
+}
+
+// Resolves the selectors of one cycle into lane sources.
+void rdp_combiner_setup_cycle(struct rdp_combiner *combiner,
+  const struct rdp_combine *combine,
+  const struct rdp_combiner_inputs *inputs, unsigned cycle) {
+  const struct rdp_color_lanes *color;
+  const int16_t **src;
+  unsigned ch, sel;
+
+  for (ch = 0; ch < 3; ch++) {
+    src = combiner->src[cycle][ch];
+
+    // RGB subtrahend A.
+    sel = combine->rgb_sub_a[cycle];
+
+    if ((color = rdp_combine_color(combiner, inputs, sel)) != NULL)
+      src[0] = color->c[ch];
+    else if (sel == 6)
+      src[0] = combiner->one;
+    else if (sel == 7)
+      src[0] = inputs->noise;
+    else
+      src[0] = combiner->zero;
+
+    // RGB subtrahend B.
+    sel = combine->rgb_sub_b[cycle];
+
+    if ((color = rdp_combine_color(combiner, inputs, sel)) != NULL)
+      src[1] = color->c[ch];
+    else if (sel == 6)
+      src[1] = combiner->key_center.c[ch];
+    else if (sel == 7)
+      src[1] = combiner->convert4;
+    else
+      src[1] = combiner->zero;
+
+    // RGB multiplier C.
+    sel = combine->rgb_mul[cycle];
+
+    if ((color = rdp_combine_color(combiner, inputs, sel)) != NULL)
+      src[2] = color->c[ch];
+    else if (sel == 6)
+      src[2] = combiner->key_scale.c[ch];
+    else if (sel >= 7 && sel <= 12)
+      src[2] = rdp_combine_alpha(combiner, inputs, sel - 7);
+    else if (sel == 13)
+      src[2] = inputs->lod_frac;
+    else if (sel == 14)
+      src[2] = combiner->prim_lod_frac;
+    else if (sel == 15)
+      src[2] = combiner->convert5;
+    else
+      src[2] = combiner->zero;
+
+    // RGB addend D.
+    sel = combine->rgb_add[cycle];
+
+    if ((color = rdp_combine_color(combiner, inputs, sel)) != NULL)
+      src[3] = color->c[ch];
+    else if (sel == 6)
+      src[3] = combiner->one;
+    else
+      src[3] = combiner->zero;
+  }
+
+  // Alpha inputs; the multiplier swaps combined alpha for LOD fractions.
+  src = combiner->src[cycle][3];
+  src[0] = rdp_combine_alpha(combiner, inputs, combine->alpha_sub_a[cycle]);
+  src[1] = rdp_combine_alpha(combiner, inputs, combine->alpha_sub_b[cycle]);
+  src[3] = rdp_combine_alpha(combiner, inputs, combine->alpha_add[cycle]);
+
+  switch ((sel = combine->alpha_mul[cycle])) {
+    case 0: src[2] = inputs->lod_frac; break;
+    case 6: src[2] = combiner->prim_lod_frac; break;
+    default: src[2] = rdp_combine_alpha(combiner, inputs, sel); break;
+  }
+}
+
+// Resolves the selectors in the state against a set of inputs.
+void rdp_combiner_setup(struct rdp_combiner *combiner,
+  const struct rdp_state *state, const struct rdp_combiner_inputs *inputs) {
+  unsigned ch;
+
+  for (ch = 0; ch < 3; ch++) {
+    rdp_combiner_broadcast(combiner->key_center.c[ch], state->key_center[ch]);
+    rdp_combiner_broadcast(combiner->key_scale.c[ch], state->key_scale[ch]);
+  }
+
+  rdp_combiner_broadcast(combiner->prim.c[0], state->prim_color.r);
+  rdp_combiner_broadcast(combiner->prim.c[1], state->prim_color.g);
+  rdp_combiner_broadcast(combiner->prim.c[2], state->prim_color.b);
+  rdp_combiner_broadcast(combiner->prim.c[3], state->prim_color.a);
+  rdp_combiner_broadcast(combiner->env.c[0], state->env_color.r);
+  rdp_combiner_broadcast(combiner->env.c[1], state->env_color.g);
+  rdp_combiner_broadcast(combiner->env.c[2], state->env_color.b);
+  rdp_combiner_broadcast(combiner->env.c[3], state->env_color.a);
+
+  rdp_combiner_broadcast(combiner->convert4, state->convert[4]);
+  rdp_combiner_broadcast(combiner->convert5, state->convert[5]);
+  rdp_combiner_broadcast(combiner->prim_lod_frac, state->prim_lod_frac);
+  rdp_combiner_broadcast(combiner->one, 0x100);
+  rdp_combiner_broadcast(combiner->zero, 0);
+
+  rdp_combiner_setup_cycle(combiner, &state->combine, inputs, 0);
+  rdp_combiner_setup_cycle(combiner, &state->combine, inputs, 1);
+}
+
+// Evaluates (A - B) * C + D for one cycle of the combiner.
+void rdp_combine(const struct rdp_combiner *combiner, unsigned cycle,
+  struct rdp_color_lanes *out) {
+  unsigned ch;
+
+  for (ch = 0; ch < 4; ch++) {
+    const int16_t * const *src = combiner->src[cycle][ch];
+
+#if defined(RDP_VECT_KERNELS) && !defined(RDP_SCALAR_PIPELINE)
+    rdp_vect_combine(out->c[ch], src[0], src[1], src[2], src[3]);
+#else
+    rdp_combine_lanes_scalar(out->c[ch], src[0], src[1], src[2], src[3]);
+#endif
+  }
+}
+
+// Reference version of the per-channel kernel; the host's vector
+// kernel must produce exactly the same results.
+void rdp_combine_lanes_scalar(int16_t *out, const int16_t *a,
+  const int16_t *b, const int16_t *c, const int16_t *d) {
+  unsigned i;
+
+  for (i = 0; i < RDP_LANES; i++) {
+    int32_t value = (a[i] - b[i]) * c[i] + (d[i] << 8) + 0x80;
+    out[i] = rdp_combine_clamp(value >> 8);
+  }
+}
+
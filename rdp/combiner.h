@@ -0,0 +1,56 @@
+//
+// rdp/combiner.h: RDP color combiner.
+//
+// CEN64: Cycle-Accurate Nintendo 64 Simulator.
+// Copyright (C) 2014, Tyler J. Stachecki.
+//
+// This file is subject to the terms and conditions defined in
+// 'LICENSE', which is part of this source code package.
+//
+
+#ifndef __rdp_combiner_h__
+#define __rdp_combiner_h__
+#include "common.h"
+#include "rdp/state.h"
+
+struct rdp_combiner_inputs {
+  struct rdp_color_lanes combined;
+  struct rdp_color_lanes texel0;
+  struct rdp_color_lanes texel1;
+  struct rdp_color_lanes shade;
+  cen64_align(int16_t lod_frac[RDP_LANES], 16);
+  cen64_align(int16_t noise[RDP_LANES], 16);
+};
+
+// The combiner's selectors, resolved against a set of inputs. Constant
+// inputs are broadcast across the lanes so every source looks alike.
+struct rdp_combiner {
+  struct rdp_color_lanes prim;
+  struct rdp_color_lanes env;
+  struct rdp_color_lanes key_center;
+  struct rdp_color_lanes key_scale;
+  cen64_align(int16_t convert4[RDP_LANES], 16);
+  cen64_align(int16_t convert5[RDP_LANES], 16);
+  cen64_align(int16_t prim_lod_frac[RDP_LANES], 16);
+  cen64_align(int16_t one[RDP_LANES], 16);
+  cen64_align(int16_t zero[RDP_LANES], 16);
+
+  // Sources for A, B, C and D; indexed by cycle, channel and input.
+  const int16_t *src[2][4][4];
+};
+
+// Resolves the selectors in the state against a set of inputs.
+void rdp_combiner_setup(struct rdp_combiner *combiner,
+  const struct rdp_state *state, const struct rdp_combiner_inputs *inputs);
+
+// Evaluates (A - B) * C + D for one cycle of the combiner.
+void rdp_combine(const struct rdp_combiner *combiner, unsigned cycle,
+  struct rdp_color_lanes *out);
+
+// Reference version of the per-channel kernel; the host's vector
+// kernel must produce exactly the same results.
+void rdp_combine_lanes_scalar(int16_t *out, const int16_t *a,
+  const int16_t *b, const int16_t *c, const int16_t *d);
+
+#endif
+
@@ -0,0 +1,582 @@
+//
+// rdp/commands.c: RDP command list processing.
+//
+// CEN64: Cycle-Accurate Nintendo 64 Simulator.
+// Copyright (C) 2014, Tyler J. Stachecki.
+//
+// This file is subject to the terms and conditions defined in
+// 'LICENSE', which is part of this source code package.
+//
+
+#include "common.h"
+#include "rdp/commands.h"
+#include "rdp/framebuffer.h"
+#include "rdp/raster.h"
+#include "rdp/state.h"
+#include "rdp/texcache.h"
+#include "rdp/texture.h"
+
+typedef void (*rdp_command_func)(struct rdp_state *state,
+  uint8_t *ram, const uint64_t *cmd);
+
+static int32_t rdp_sign_extend(uint32_t value, unsigned bits);
+static void rdp_parse_attrs(const uint64_t *block, int32_t *attr,
+  int32_t *dadx, int32_t *dade, int32_t *dady, unsigned count);
+static void rdp_parse_color(uint64_t word, struct rdp_color *color);
+static void rdp_bind_textures(struct rdp_state *state, unsigned tile);
+static void rdp_draw_triangle_cmd(struct rdp_state *state, uint8_t *ram,
+  const uint64_t *cmd, bool shade, bool texture, bool zbuffer);
+static void rdp_draw_rectangle_cmd(struct rdp_state *state, uint8_t *ram,
+  const uint64_t *cmd, bool texture, bool flip);
+
+static void rdp_cmd_noop(struct rdp_state *state,
+  uint8_t *ram, const uint64_t *cmd);
+static void rdp_cmd_fill_triangle(struct rdp_state *state,
+  uint8_t *ram, const uint64_t *cmd);
+static void rdp_cmd_fill_z_triangle(struct rdp_state *state,
+  uint8_t *ram, const uint64_t *cmd);
+static void rdp_cmd_texture_triangle(struct rdp_state *state,
+  uint8_t *ram, const uint64_t *cmd);
+static void rdp_cmd_texture_z_triangle(struct rdp_state *state,
+  uint8_t *ram, const uint64_t *cmd);
+static void rdp_cmd_shade_triangle(struct rdp_state *state,
+  uint8_t *ram, const uint64_t *cmd);
+static void rdp_cmd_shade_z_triangle(struct rdp_state *state,
+  uint8_t *ram, const uint64_t *cmd);
+static void rdp_cmd_shade_texture_triangle(struct rdp_state *state,
+  uint8_t *ram, const uint64_t *cmd);
+static void rdp_cmd_shade_texture_z_triangle(struct rdp_state *state,
+  uint8_t *ram, const uint64_t *cmd);
+static void rdp_cmd_texture_rectangle(struct rdp_state *state,
+  uint8_t *ram, const uint64_t *cmd);
+static void rdp_cmd_texture_rectangle_flip(struct rdp_state *state,
+  uint8_t *ram, const uint64_t *cmd);
+static void rdp_cmd_set_key_gb(struct rdp_state *state,
+  uint8_t *ram, const uint64_t *cmd);
+static void rdp_cmd_set_key_r(struct rdp_state *state,
+  uint8_t *ram, const uint64_t *cmd);
+static void rdp_cmd_set_convert(struct rdp_state *state,
+  uint8_t *ram, const uint64_t *cmd);
+static void rdp_cmd_set_scissor(struct rdp_state *state,
+  uint8_t *ram, const uint64_t *cmd);
+static void rdp_cmd_set_prim_depth(struct rdp_state *state,
+  uint8_t *ram, const uint64_t *cmd);
+static void rdp_cmd_set_other_modes(struct rdp_state *state,
+  uint8_t *ram, const uint64_t *cmd);
+static void rdp_cmd_load_tlut(struct rdp_state *state,
+  uint8_t *ram, const uint64_t *cmd);
+static void rdp_cmd_set_tile_size(struct rdp_state *state,
+  uint8_t *ram, const uint64_t *cmd);
+static void rdp_cmd_load_block(struct rdp_state *state,
+  uint8_t *ram, const uint64_t *cmd);
+static void rdp_cmd_load_tile(struct rdp_state *state,
+  uint8_t *ram, const uint64_t *cmd);
+static void rdp_cmd_set_tile(struct rdp_state *state,
+  uint8_t *ram, const uint64_t *cmd);
+static void rdp_cmd_fill_rectangle(struct rdp_state *state,
+  uint8_t *ram, const uint64_t *cmd);
+static void rdp_cmd_set_fill_color(struct rdp_state *state,
+  uint8_t *ram, const uint64_t *cmd);
+static void rdp_cmd_set_fog_color(struct rdp_state *state,
+  uint8_t *ram, const uint64_t *cmd);
+static void rdp_cmd_set_blend_color(struct rdp_state *state,
+  uint8_t *ram, const uint64_t *cmd);
+static void rdp_cmd_set_prim_color(struct rdp_state *state,
+  uint8_t *ram, const uint64_t *cmd);
+static void rdp_cmd_set_env_color(struct rdp_state *state,
+  uint8_t *ram, const uint64_t *cmd);
+static void rdp_cmd_set_combine(struct rdp_state *state,
+  uint8_t *ram, const uint64_t *cmd);
+static void rdp_cmd_set_texture_image(struct rdp_state *state,
+  uint8_t *ram, const uint64_t *cmd);
+static void rdp_cmd_set_z_image(struct rdp_state *state,
+  uint8_t *ram, const uint64_t *cmd);
+static void rdp_cmd_set_color_image(struct rdp_state *state,
+  uint8_t *ram, const uint64_t *cmd);
+
+// Command handlers and lengths (in 64-bit words), indexed by opcode.
+static const struct {
+  rdp_command_func func;
+  unsigned length;
+} rdp_commands[64] = {
+  /* 0x00 */ {rdp_cmd_noop, 1}, {rdp_cmd_noop, 1},
+  /* 0x02 */ {rdp_cmd_noop, 1}, {rdp_cmd_noop, 1},
+  /* 0x04 */ {rdp_cmd_noop, 1}, {rdp_cmd_noop, 1},
+  /* 0x06 */ {rdp_cmd_noop, 1}, {rdp_cmd_noop, 1},
+  /* 0x08 */ {rdp_cmd_fill_triangle, 4},
+  /* 0x09 */ {rdp_cmd_fill_z_triangle, 6},
+  /* 0x0A */ {rdp_cmd_texture_triangle, 12},
+  /* 0x0B */ {rdp_cmd_texture_z_triangle, 14},
+  /* 0x0C */ {rdp_cmd_shade_triangle, 12},
+  /* 0x0D */ {rdp_cmd_shade_z_triangle, 14},
+  /* 0x0E */ {rdp_cmd_shade_texture_triangle, 20},
+  /* 0x0F */ {rdp_cmd_shade_texture_z_triangle, 22},
+  /* 0x10 */ {rdp_cmd_noop, 1}, {rdp_cmd_noop, 1},
+  /* 0x12 */ {rdp_cmd_noop, 1}, {rdp_cmd_noop, 1},
+  /* 0x14 */ {rdp_cmd_noop, 1}, {rdp_cmd_noop, 1},
+  /* 0x16 */ {rdp_cmd_noop, 1}, {rdp_cmd_noop, 1},
+  /* 0x18 */ {rdp_cmd_noop, 1}, {rdp_cmd_noop, 1},
+  /* 0x1A */ {rdp_cmd_noop, 1}, {rdp_cmd_noop, 1},
+  /* 0x1C */ {rdp_cmd_noop, 1}, {rdp_cmd_noop, 1},
+  /* 0x1E */ {rdp_cmd_noop, 1}, {rdp_cmd_noop, 1},
+  /* 0x20 */ {rdp_cmd_noop, 1}, {rdp_cmd_noop, 1},
+  /* 0x22 */ {rdp_cmd_noop, 1}, {rdp_cmd_noop, 1},
+  /* 0x24 */ {rdp_cmd_texture_rectangle, 2},
+  /* 0x25 */ {rdp_cmd_texture_rectangle_flip, 2},
+  /* 0x26 */ {rdp_cmd_noop, 1},
+  /* 0x27 */ {rdp_cmd_noop, 1},
+  /* 0x28 */ {rdp_cmd_noop, 1},
+  /* 0x29 */ {rdp_cmd_noop, 1},
+  /* 0x2A */ {rdp_cmd_set_key_gb, 1},
+  /* 0x2B */ {rdp_cmd_set_key_r, 1},
+  /* 0x2C */ {rdp_cmd_set_convert, 1},
+  /* 0x2D */ {rdp_cmd_set_scissor, 1},
+  /* 0x2E */ {rdp_cmd_set_prim_depth, 1},
+  /* 0x2F */ {rdp_cmd_set_other_modes, 1},
+  /* 0x30 */ {rdp_cmd_load_tlut, 1},
+  /* 0x31 */ {rdp_cmd_noop, 1},
+  /* 0x32 */ {rdp_cmd_set_tile_size, 1},
+  /* 0x33 */ {rdp_cmd_load_block, 1},
+  /* 0x34 */ {rdp_cmd_load_tile, 1},
+  /* 0x35 */ {rdp_cmd_set_tile, 1},
+  /* 0x36 */ {rdp_cmd_fill_rectangle, 1},
+  /* 0x37 */ {rdp_cmd_set_fill_color, 1},
+  /* 0x38 */ {rdp_cmd_set_fog_color, 1},
+  /* 0x39 */ {rdp_cmd_set_blend_color, 1},
+  /* 0x3A */ {rdp_cmd_set_prim_color, 1},
+  /* 0x3B */ {rdp_cmd_set_env_color, 1},
+  /* 0x3C */ {rdp_cmd_set_combine, 1},
+  /* 0x3D */ {rdp_cmd_set_texture_image, 1},
+  /* 0x3E */ {rdp_cmd_set_z_image, 1},
+  /* 0x3F */ {rdp_cmd_set_color_image, 1},
+};
+
+// Sign-extends the low bits of a field.
+int32_t rdp_sign_extend(uint32_t value, unsigned bits) {
+  return (int32_t) (value << (32 - bits)) >> (32 - bits);
+}
+
+// Unpacks a block of edge coefficients. Each value is split into an
+// integer half (words 0, 1, 4, 5) and a fractional half (2, 3, 6, 7).
+void rdp_parse_attrs(const uint64_t *block, int32_t *attr,
+  int32_t *dadx, int32_t *dade, int32_t *dady, unsigned count) {
+  unsigned i;
+
+  for (i = 0; i < count; i++) {
+    unsigned shift = 48 - i * 16;
+
+    attr[i] = (int32_t) ((block[0] >> shift & 0xFFFF) << 16 |
+      (block[2] >> shift & 0xFFFF));
+    dadx[i] = (int32_t) ((block[1] >> shift & 0xFFFF) << 16 |
+      (block[3] >> shift & 0xFFFF));
+    dade[i] = (int32_t) ((block[4] >> shift & 0xFFFF) << 16 |
+      (block[6] >> shift & 0xFFFF));
+    dady[i] = (int32_t) ((block[5] >> shift & 0xFFFF) << 16 |
+      (block[7] >> shift & 0xFFFF));
+  }
+}
+
+// Unpacks an RGBA8888 color from the low word of a command.
+void rdp_parse_color(uint64_t word, struct rdp_color *color) {
+  color->r = word >> 24 & 0xFF;
+  color->g = word >> 16 & 0xFF;
+  color->b = word >> 8 & 0xFF;
+  color->a = word & 0xFF;
+}
+
+// Gets the texels of the tiles that a primitive samples ready.
+// Copy mode fetches raw texels, so it doesn't need them decoded.
+void rdp_bind_textures(struct rdp_state *state, unsigned tile) {
+  enum rdp_cycle_type cycle_type = state->other_modes.cycle_type;
+
+  if (cycle_type == RDP_CYCLE_TYPE_1CYCLE)
+    rdp_texcache_bind(state, tile);
+
+  else if (cycle_type == RDP_CYCLE_TYPE_2CYCLE) {
+    rdp_texcache_bind(state, tile);
+    rdp_texcache_bind(state, tile + 1);
+  }
+}
+
+// Decodes the edge coefficients (and any attributes) of a triangle.
+void rdp_draw_triangle_cmd(struct rdp_state *state, uint8_t *ram,
+  const uint64_t *cmd, bool shade, bool texture, bool zbuffer) {
+  const uint64_t *block = cmd + 4;
+  struct rdp_triangle triangle;
+
+  memset(&triangle, 0, sizeof(triangle));
+  triangle.left_major = cmd[0] >> 55 & 0x1;
+  triangle.tile = cmd[0] >> 48 & 0x7;
+  triangle.shade = shade;
+  triangle.texture = texture;
+  triangle.zbuffer = zbuffer;
+
+  triangle.yl = rdp_sign_extend(cmd[0] >> 32 & 0x3FFF, 14);
+  triangle.ym = rdp_sign_extend(cmd[0] >> 16 & 0x3FFF, 14);
+  triangle.yh = rdp_sign_extend(cmd[0] & 0x3FFF, 14);
+
+  triangle.xl = rdp_sign_extend(cmd[1] >> 32, 28);
+  triangle.dxldy = rdp_sign_extend(cmd[1], 30);
+  triangle.xh = rdp_sign_extend(cmd[2] >> 32, 28);
+  triangle.dxhdy = rdp_sign_extend(cmd[2], 30);
+  triangle.xm = rdp_sign_extend(cmd[3] >> 32, 28);
+  triangle.dxmdy = rdp_sign_extend(cmd[3], 30);
+
+  if (shade) {
+    rdp_parse_attrs(block, triangle.attr + RDP_ATTR_R,
+      triangle.dadx + RDP_ATTR_R, triangle.dade + RDP_ATTR_R,
+      triangle.dady + RDP_ATTR_R, 4);
+
+    block += 8;
+  }
+
+  if (texture) {
+    rdp_parse_attrs(block, triangle.attr + RDP_ATTR_S,
+      triangle.dadx + RDP_ATTR_S, triangle.dade + RDP_ATTR_S,
+      triangle.dady + RDP_ATTR_S, 3);
+
+    block += 8;
+  }
+
+  if (zbuffer) {
+    triangle.attr[RDP_ATTR_Z] = (int32_t) (block[0] >> 32);
+    triangle.dadx[RDP_ATTR_Z] = (int32_t) block[0];
+    triangle.dade[RDP_ATTR_Z] = (int32_t) (block[1] >> 32);
+    triangle.dady[RDP_ATTR_Z] = (int32_t) block[1];
+  }
+
+  if (texture)
+    rdp_bind_textures(state, triangle.tile);
+
+  rdp_draw_triangle(state, ram, &triangle);
+}
+
+// Decodes the bounds (and texture coordinates) of a rectangle.
+void rdp_draw_rectangle_cmd(struct rdp_state *state, uint8_t *ram,
+  const uint64_t *cmd, bool texture, bool flip) {
+  struct rdp_rectangle rectangle;
+
+  memset(&rectangle, 0, sizeof(rectangle));
+  rectangle.xl = cmd[0] >> 44 & 0xFFF;
+  rectangle.yl = cmd[0] >> 32 & 0xFFF;
+  rectangle.tile = cmd[0] >> 24 & 0x7;
+  rectangle.xh = cmd[0] >> 12 & 0xFFF;
+  rectangle.yh = cmd[0] & 0xFFF;
+  rectangle.texture = texture;
+  rectangle.flip = flip;
+
+  if (texture) {
+    rectangle.s = (int16_t) (cmd[1] >> 48);
+    rectangle.t = (int16_t) (cmd[1] >> 32);
+    rectangle.dsdx = (int16_t) (cmd[1] >> 16);
+    rectangle.dtdy = (int16_t) cmd[1];
+  }
+
+  if (texture)
+    rdp_bind_textures(state, rectangle.tile);
+
+  rdp_draw_rectangle(state, ram, &rectangle);
+}
+
+// NOOP (and any unimplemented command): Does nothing.
+void rdp_cmd_noop(struct rdp_state *state,
+  uint8_t *ram, const uint64_t *cmd) {
+}
+
+// TRI_FILL: Draws a flat triangle.
+void rdp_cmd_fill_triangle(struct rdp_state *state,
+  uint8_t *ram, const uint64_t *cmd) {
+  rdp_draw_triangle_cmd(state, ram, cmd, false, false, false);
+}
+
+// TRI_FILL_ZBUFF: Draws a flat, depth-tested triangle.
+void rdp_cmd_fill_z_triangle(struct rdp_state *state,
+  uint8_t *ram, const uint64_t *cmd) {
+  rdp_draw_triangle_cmd(state, ram, cmd, false, false, true);
+}
+
+// TRI_TXTR: Draws a textured triangle.
+void rdp_cmd_texture_triangle(struct rdp_state *state,
+  uint8_t *ram, const uint64_t *cmd) {
+  rdp_draw_triangle_cmd(state, ram, cmd, false, true, false);
+}
+
+// TRI_TXTR_ZBUFF: Draws a textured, depth-tested triangle.
+void rdp_cmd_texture_z_triangle(struct rdp_state *state,
+  uint8_t *ram, const uint64_t *cmd) {
+  rdp_draw_triangle_cmd(state, ram, cmd, false, true, true);
+}
+
+// TRI_SHADE: Draws a Gouraud shaded triangle.
+void rdp_cmd_shade_triangle(struct rdp_state *state,
+  uint8_t *ram, const uint64_t *cmd) {
+  rdp_draw_triangle_cmd(state, ram, cmd, true, false, false);
+}
+
+// TRI_SHADE_ZBUFF: Draws a shaded, depth-tested triangle.
+void rdp_cmd_shade_z_triangle(struct rdp_state *state,
+  uint8_t *ram, const uint64_t *cmd) {
+  rdp_draw_triangle_cmd(state, ram, cmd, true, false, true);
+}
+
+// TRI_SHADE_TXTR: Draws a shaded, textured triangle.
+void rdp_cmd_shade_texture_triangle(struct rdp_state *state,
+  uint8_t *ram, const uint64_t *cmd) {
+  rdp_draw_triangle_cmd(state, ram, cmd, true, true, false);
+}
+
+// TRI_SHADE_TXTR_ZBUFF: Draws a shaded, textured, depth-tested triangle.
+void rdp_cmd_shade_texture_z_triangle(struct rdp_state *state,
+  uint8_t *ram, const uint64_t *cmd) {
+  rdp_draw_triangle_cmd(state, ram, cmd, true, true, true);
+}
+
+// TEXRECT: Draws a textured rectangle.
+void rdp_cmd_texture_rectangle(struct rdp_state *state,
+  uint8_t *ram, const uint64_t *cmd) {
+  rdp_draw_rectangle_cmd(state, ram, cmd, true, false);
+}
+
+// TEXRECT_FLIP: Draws a textured rectangle with S and T swapped.
+void rdp_cmd_texture_rectangle_flip(struct rdp_state *state,
+  uint8_t *ram, const uint64_t *cmd) {
+  rdp_draw_rectangle_cmd(state, ram, cmd, true, true);
+}
+
+// FILLRECT: Draws an untextured rectangle.
+void rdp_cmd_fill_rectangle(struct rdp_state *state,
+  uint8_t *ram, const uint64_t *cmd) {
+  rdp_draw_rectangle_cmd(state, ram, cmd, false, false);
+}
+
+// SET_KEY_GB: Sets the green and blue chroma key center and scale.
+void rdp_cmd_set_key_gb(struct rdp_state *state,
+  uint8_t *ram, const uint64_t *cmd) {
+  state->key_center[1] = cmd[0] >> 24 & 0xFF;
+  state->key_scale[1] = cmd[0] >> 16 & 0xFF;
+  state->key_center[2] = cmd[0] >> 8 & 0xFF;
+  state->key_scale[2] = cmd[0] & 0xFF;
+}
+
+// SET_KEY_R: Sets the red chroma key center and scale.
+void rdp_cmd_set_key_r(struct rdp_state *state,
+  uint8_t *ram, const uint64_t *cmd) {
+  state->key_center[0] = cmd[0] >> 8 & 0xFF;
+  state->key_scale[0] = cmd[0] & 0xFF;
+}
+
+// SET_CONVERT: Sets the YUV conversion coefficients (K0-K5).
+void rdp_cmd_set_convert(struct rdp_state *state,
+  uint8_t *ram, const uint64_t *cmd) {
+  unsigned i;
+
+  for (i = 0; i < 6; i++)
+    state->convert[i] = rdp_sign_extend(cmd[0] >> (45 - i * 9) & 0x1FF, 9);
+}
+
+// SET_SCISSOR: Sets the scissor box (in 10.2 fixed point).
+void rdp_cmd_set_scissor(struct rdp_state *state,
+  uint8_t *ram, const uint64_t *cmd) {
+  state->scissor.xh = cmd[0] >> 44 & 0xFFF;
+  state->scissor.yh = cmd[0] >> 32 & 0xFFF;
+  state->scissor.xl = cmd[0] >> 12 & 0xFFF;
+  state->scissor.yl = cmd[0] & 0xFFF;
+}
+
+// SET_PRIM_DEPTH: Sets the primitive Z and delta Z.
+void rdp_cmd_set_prim_depth(struct rdp_state *state,
+  uint8_t *ram, const uint64_t *cmd) {
+  state->prim_z = cmd[0] >> 16 & 0x7FFF;
+  state->prim_dz = cmd[0] & 0xFFFF;
+}
+
+// SET_OTHER_MODES: Sets the cycle type, blender and Z modes.
+void rdp_cmd_set_other_modes(struct rdp_state *state,
+  uint8_t *ram, const uint64_t *cmd) {
+  struct rdp_other_modes *modes = &state->other_modes;
+  uint64_t word = cmd[0];
+
+  modes->cycle_type = (enum rdp_cycle_type) (word >> 52 & 0x3);
+  modes->persp_tex_en = word >> 51 & 0x1;
+  modes->tex_lod_en = word >> 48 & 0x1;
+  modes->en_tlut = word >> 47 & 0x1;
+  modes->tlut_type = word >> 46 & 0x1;
+  modes->sample_type = word >> 45 & 0x1;
+  modes->key_en = word >> 40 & 0x1;
+
+  modes->blend_m1a[0] = word >> 30 & 0x3;
+  modes->blend_m1a[1] = word >> 28 & 0x3;
+  modes->blend_m1b[0] = word >> 26 & 0x3;
+  modes->blend_m1b[1] = word >> 24 & 0x3;
+  modes->blend_m2a[0] = word >> 22 & 0x3;
+  modes->blend_m2a[1] = word >> 20 & 0x3;
+  modes->blend_m2b[0] = word >> 18 & 0x3;
+  modes->blend_m2b[1] = word >> 16 & 0x3;
+
+  modes->force_blend = word >> 14 & 0x1;
+  modes->alpha_cvg_select = word >> 13 & 0x1;
+  modes->cvg_times_alpha = word >> 12 & 0x1;
+  modes->z_mode = (enum rdp_z_mode) (word >> 10 & 0x3);
+  modes->cvg_dest = (enum rdp_cvg_dest) (word >> 8 & 0x3);
+  modes->color_on_cvg = word >> 7 & 0x1;
+  modes->image_read_en = word >> 6 & 0x1;
+  modes->z_update_en = word >> 5 & 0x1;
+  modes->z_compare_en = word >> 4 & 0x1;
+  modes->antialias_en = word >> 3 & 0x1;
+  modes->z_source_sel = word >> 2 & 0x1;
+  modes->dither_alpha_en = word >> 1 & 0x1;
+  modes->alpha_compare_en = word & 0x1;
+}
+
+// LOAD_TLUT: Copies palette entries into the upper half of TMEM.
+void rdp_cmd_load_tlut(struct rdp_state *state,
+  uint8_t *ram, const uint64_t *cmd) {
+  rdp_load_tlut(state, ram, cmd[0] >> 24 & 0x7,
+    cmd[0] >> 44 & 0xFFF, cmd[0] >> 32 & 0xFFF,
+    cmd[0] >> 12 & 0xFFF, cmd[0] & 0xFFF);
+}
+
+// SET_TILE_SIZE: Sets the bounds of a tile.
+void rdp_cmd_set_tile_size(struct rdp_state *state,
+  uint8_t *ram, const uint64_t *cmd) {
+  struct rdp_tile *tile = state->tiles + (cmd[0] >> 24 & 0x7);
+
+  tile->sl = cmd[0] >> 44 & 0xFFF;
+  tile->tl = cmd[0] >> 32 & 0xFFF;
+  tile->sh = cmd[0] >> 12 & 0xFFF;
+  tile->th = cmd[0] & 0xFFF;
+}
+
+// LOAD_BLOCK: Copies a contiguous span of texels into TMEM.
+void rdp_cmd_load_block(struct rdp_state *state,
+  uint8_t *ram, const uint64_t *cmd) {
+  rdp_load_block(state, ram, cmd[0] >> 24 & 0x7,
+    cmd[0] >> 44 & 0xFFF, cmd[0] >> 32 & 0xFFF,
+    cmd[0] >> 12 & 0xFFF, cmd[0] & 0xFFF);
+}
+
+// LOAD_TILE: Copies a rectangle of texels into TMEM.
+void rdp_cmd_load_tile(struct rdp_state *state,
+  uint8_t *ram, const uint64_t *cmd) {
+  rdp_load_tile(state, ram, cmd[0] >> 24 & 0x7,
+    cmd[0] >> 44 & 0xFFF, cmd[0] >> 32 & 0xFFF,
+    cmd[0] >> 12 & 0xFFF, cmd[0] & 0xFFF);
+}
+
+// SET_TILE: Sets the format, layout and addressing of a tile.
+void rdp_cmd_set_tile(struct rdp_state *state,
+  uint8_t *ram, const uint64_t *cmd) {
+  struct rdp_tile *tile = state->tiles + (cmd[0] >> 24 & 0x7);
+  uint64_t word = cmd[0];
+
+  tile->format = (enum rdp_format) (word >> 53 & 0x7);
+  tile->size = (enum rdp_size) (word >> 51 & 0x3);
+  tile->line = word >> 41 & 0x1FF;
+  tile->tmem = word >> 32 & 0x1FF;
+  tile->palette = word >> 20 & 0xF;
+
+  tile->clamp_t = word >> 19 & 0x1;
+  tile->mirror_t = word >> 18 & 0x1;
+  tile->mask_t = word >> 14 & 0xF;
+  tile->shift_t = word >> 10 & 0xF;
+  tile->clamp_s = word >> 9 & 0x1;
+  tile->mirror_s = word >> 8 & 0x1;
+  tile->mask_s = word >> 4 & 0xF;
+  tile->shift_s = word & 0xF;
+}
+
+// SET_FILL_COLOR: Sets the packed color that fill mode writes.
+void rdp_cmd_set_fill_color(struct rdp_state *state,
+  uint8_t *ram, const uint64_t *cmd) {
+  state->fill_color = (uint32_t) cmd[0];
+}
+
+// SET_FOG_COLOR: Sets the fog color.
+void rdp_cmd_set_fog_color(struct rdp_state *state,
+  uint8_t *ram, const uint64_t *cmd) {
+  rdp_parse_color(cmd[0], &state->fog_color);
+}
+
+// SET_BLEND_COLOR: Sets the blend color.
+void rdp_cmd_set_blend_color(struct rdp_state *state,
+  uint8_t *ram, const uint64_t *cmd) {
+  rdp_parse_color(cmd[0], &state->blend_color);
+}
+
+// SET_PRIM_COLOR: Sets the primitive color and LOD fraction.
+void rdp_cmd_set_prim_color(struct rdp_state *state,
+  uint8_t *ram, const uint64_t *cmd) {
+  state->prim_lod_frac = cmd[0] >> 32 & 0xFF;
+  rdp_parse_color(cmd[0], &state->prim_color);
+}
+
+// SET_ENV_COLOR: Sets the environment color.
+void rdp_cmd_set_env_color(struct rdp_state *state,
+  uint8_t *ram, const uint64_t *cmd) {
+  rdp_parse_color(cmd[0], &state->env_color);
+}
+
+// SET_COMBINE: Selects the color combiner inputs for both cycles.
+void rdp_cmd_set_combine(struct rdp_state *state,
+  uint8_t *ram, const uint64_t *cmd) {
+  struct rdp_combine *combine = &state->combine;
+  uint64_t word = cmd[0];
+
+  combine->rgb_sub_a[0] = word >> 52 & 0xF;
+  combine->rgb_mul[0] = word >> 47 & 0x1F;
+  combine->alpha_sub_a[0] = word >> 44 & 0x7;
+  combine->alpha_mul[0] = word >> 41 & 0x7;
+  combine->rgb_sub_a[1] = word >> 37 & 0xF;
+  combine->rgb_mul[1] = word >> 32 & 0x1F;
+
+  combine->rgb_sub_b[0] = word >> 28 & 0xF;
+  combine->rgb_sub_b[1] = word >> 24 & 0xF;
+  combine->alpha_sub_a[1] = word >> 21 & 0x7;
+  combine->alpha_mul[1] = word >> 18 & 0x7;
+  combine->rgb_add[0] = word >> 15 & 0x7;
+  combine->alpha_sub_b[0] = word >> 12 & 0x7;
+  combine->alpha_add[0] = word >> 9 & 0x7;
+  combine->rgb_add[1] = word >> 6 & 0x7;
+  combine->alpha_sub_b[1] = word >> 3 & 0x7;
+  combine->alpha_add[1] = word & 0x7;
+}
+
+// SET_TEXTURE_IMAGE: Sets the source image for texture loads.
+void rdp_cmd_set_texture_image(struct rdp_state *state,
+  uint8_t *ram, const uint64_t *cmd) {
+  struct rdp_image *image = &state->texture_image;
+
+  image->format = (enum rdp_format) (cmd[0] >> 53 & 0x7);
+  image->size = (enum rdp_size) (cmd[0] >> 51 & 0x3);
+  image->width = (cmd[0] >> 32 & 0x3FF) + 1;
+  image->address = cmd[0] & 0xFFFFFF;
+}
+
+// SET_Z_IMAGE: Sets the address of the depth buffer.
+void rdp_cmd_set_z_image(struct rdp_state *state,
+  uint8_t *ram, const uint64_t *cmd) {
+  state->z_image = cmd[0] & 0xFFFFFF;
+}
+
+// SET_COLOR_IMAGE: Sets the format and address of the framebuffer.
+void rdp_cmd_set_color_image(struct rdp_state *state,
+  uint8_t *ram, const uint64_t *cmd) {
+  struct rdp_image *image = &state->color_image;
+
+  image->format = (enum rdp_format) (cmd[0] >> 53 & 0x7);
+  image->size = (enum rdp_size) (cmd[0] >> 51 & 0x3);
+  image->width = (cmd[0] >> 32 & 0x3FF) + 1;
+  image->address = cmd[0] & 0xFFFFFF;
+}
+
+// Returns the length of a command (in 64-bit words).
+unsigned rdp_command_length(uint64_t word) {
+  return rdp_commands[word >> 56 & 0x3F].length;
+}
+
+// Applies a complete command to a renderer's state.
+void rdp_execute_command(struct rdp_state *state,
+  uint8_t *ram, const uint64_t *cmd) {
+  rdp_commands[cmd[0] >> 56 & 0x3F].func(state, ram, cmd);
+}
+
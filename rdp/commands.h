@@ -0,0 +1,35 @@
+//
+// rdp/commands.h: RDP command list processing.
+//
+// CEN64: Cycle-Accurate Nintendo 64 Simulator.
+// Copyright (C) 2014, Tyler J. Stachecki.
+//
+// This file is subject to the terms and conditions defined in
+// 'LICENSE', which is part of this source code package.
+//
+
+#ifndef __rdp_commands_h__
+#define __rdp_commands_h__
+#include "common.h"
+
+// The largest command (a shaded, textured, z-buffered triangle).
+#define RDP_MAX_COMMAND_WORDS 22
+
+// Commands the list processor needs to pick out of the stream.
+#define RDP_CMD_SYNC_FULL         0x29
+#define RDP_CMD_SET_SCISSOR       0x2D
+#define RDP_CMD_LOAD_TLUT         0x30
+#define RDP_CMD_LOAD_BLOCK        0x33
+#define RDP_CMD_LOAD_TILE         0x34
+#define RDP_CMD_SET_TEXTURE_IMAGE 0x3D
+#define RDP_CMD_SET_Z_IMAGE       0x3E
+#define RDP_CMD_SET_COLOR_IMAGE   0x3F
+
+struct rdp_state;
+
+unsigned rdp_command_length(uint64_t word);
+cen64_hot void rdp_execute_command(struct rdp_state *state,
+  uint8_t *ram, const uint64_t *cmd);
+
+#endif
+
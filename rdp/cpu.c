@@ -10,6 +10,7 @@
 
 #include "common.h"
 #include "rdp/cpu.h"
+#include "rdp/texcache.h"
 
 #ifdef DEBUG_MMIO_REGISTER_ACCESS
 const char *dp_register_mnemonics[NUM_DP_REGISTERS] = {
@@ -28,6 +29,40 @@ static void rdp_connect_bus(struct rdp *rdp, struct bus_controller *bus) {
 int rdp_init(struct rdp *rdp, struct bus_controller *bus) {
   rdp_connect_bus(rdp, bus);
 
+  rdp->regs[DPC_STATUS_REG] = DP_STATUS_CBUF_READY;
+  rdp->state.band_count = 1;
+  rdp->workers = NULL;
+  rdp->capture = NULL;
+  rdp->thread.enabled = false;
+
+  memset(&rdp->counters, 0, sizeof(rdp->counters));
+  memset(rdp->counter_base, 0, sizeof(rdp->counter_base));
+  rdp->state.counters = &rdp->counters;
+  rdp->command_words = 0;
+
+  // Without a cache, texels just get decoded every time they're used.
+  if ((rdp->state.texcache = rdp_texcache_create()) == NULL)
+    debug("rdp_init: Failed to allocate the texture cache.\n");
+
   return 0;
 }
 
+// Releases any resources held by the RDP component.
+void rdp_destroy(struct rdp *rdp) {
+  rdp_texcache_destroy(rdp->state.texcache);
+  rdp->state.texcache = NULL;
+}
+
+// Totals up the work done by every renderer once it's all been drawn.
+void rdp_collect_counters(struct rdp *rdp, struct rdp_counters *counters) {
+  if (rdp->thread.enabled)
+    rdp_thread_sync(&rdp->thread);
+  else if (rdp->workers)
+    rdp_workers_flush(rdp->workers);
+
+  *counters = rdp->counters;
+
+  if (rdp->workers)
+    rdp_workers_add_counters(rdp->workers, counters);
+}
+
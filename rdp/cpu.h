@@ -11,6 +11,11 @@
 #ifndef __rdp_cpu_h__
 #define __rdp_cpu_h__
 #include "common.h"
+#include "rdp/capture.h"
+#include "rdp/commands.h"
+#include "rdp/state.h"
+#include "rdp/thread.h"
+#include "rdp/workers.h"
 
 enum dp_register {
 #define X(reg) reg,
@@ -19,16 +24,62 @@ enum dp_register {
   NUM_DP_REGISTERS
 };
 
+#define DP_STATUS_XBUS_DMA     0x0001
+#define DP_STATUS_FREEZE       0x0002
+#define DP_STATUS_FLUSH        0x0004
+#define DP_STATUS_START_GCLK   0x0008
+#define DP_STATUS_TMEM_BUSY    0x0010
+#define DP_STATUS_PIPE_BUSY    0x0020
+#define DP_STATUS_CMD_BUSY     0x0040
+#define DP_STATUS_CBUF_READY   0x0080
+#define DP_STATUS_DMA_BUSY     0x0100
+#define DP_STATUS_END_VALID    0x0200
+#define DP_STATUS_START_VALID  0x0400
+
+#define DP_CLR_XBUS_DMA        0x0001
+#define DP_SET_XBUS_DMA        0x0002
+#define DP_CLR_FREEZE          0x0004
+#define DP_SET_FREEZE          0x0008
+#define DP_CLR_FLUSH           0x0010
+#define DP_SET_FLUSH           0x0020
+#define DP_CLR_TMEM_CTR        0x0040
+#define DP_CLR_PIPE_CTR        0x0080
+#define DP_CLR_CMD_CTR         0x0100
+#define DP_CLR_CLOCK_CTR       0x0200
+
 #ifdef DEBUG_MMIO_REGISTER_ACCESS
 extern const char *dp_register_mnemonics[NUM_DP_REGISTERS];
 #endif
 
 struct rdp {
+  struct rdp_state state;
+
   uint32_t regs[NUM_DP_REGISTERS];
   struct bus_controller *bus;
+
+  uint64_t cmd_buffer[RDP_MAX_COMMAND_WORDS];
+  unsigned cmd_length;
+
+  // Set while rasterization is split across threads.
+  struct rdp_workers *workers;
+
+  // Set while command lists are being captured to a file.
+  struct rdp_capture *capture;
+
+  // Used when commands are rendered on their own thread.
+  struct rdp_thread thread;
+
+  // Work done by the first renderer (or the only one), the number of
+  // command words read and where the DP counters were last cleared.
+  struct rdp_counters counters;
+  uint64_t command_words;
+  uint64_t counter_base[4];
 };
 
+cen64_cold void rdp_destroy(struct rdp *rdp);
 cen64_cold int rdp_init(struct rdp *rdp, struct bus_controller *bus);
 
+void rdp_collect_counters(struct rdp *rdp, struct rdp_counters *counters);
+
 #endif
 
@@ -0,0 +1,187 @@
+//
+// rdp/framebuffer.c: RDP color and depth image accesses.
+//
+// CEN64: Cycle-Accurate Nintendo 64 Simulator.
+// Copyright (C) 2014, Tyler J. Stachecki.
+//
+// This file is subject to the terms and conditions defined in
+// 'LICENSE', which is part of this source code package.
+//
+
+#include "common.h"
+#include "rdp/framebuffer.h"
+#include "rdp/state.h"
+
+// Depth values are stored as a 3-bit exponent and an 11-bit mantissa,
+// with more precision the further away they are.
+static const struct {
+  unsigned shift;
+  uint32_t base;
+} rdp_z_format[8] = {
+  {6, 0x00000}, {5, 0x20000}, {4, 0x30000}, {3, 0x38000},
+  {2, 0x3C000}, {1, 0x3E000}, {0, 0x3F000}, {0, 0x3F800},
+};
+
+static uint16_t rdp_z_compress(uint32_t z);
+static uint32_t rdp_z_decompress(uint16_t word);
+
+// Compresses an 18-bit depth value into its 14-bit stored form.
+uint16_t rdp_z_compress(uint32_t z) {
+  unsigned exponent = 0;
+
+  while (exponent < 7 && z >= rdp_z_format[exponent + 1].base)
+    exponent++;
+
+  return exponent << 11 | ((z - rdp_z_format[exponent].base) >>
+    rdp_z_format[exponent].shift & 0x7FF);
+}
+
+// Expands a 14-bit stored depth value to 18 bits.
+uint32_t rdp_z_decompress(uint16_t word) {
+  unsigned exponent = word >> 11 & 0x7;
+
+  return ((word & 0x7FF) << rdp_z_format[exponent].shift) +
+    rdp_z_format[exponent].base;
+}
+
+// Reduces a depth slope to the power of two that contains it.
+unsigned rdp_dz_compress(uint32_t dz) {
+  unsigned result = 0;
+
+  while (result < 15 && (dz >> (result + 1)) != 0)
+    result++;
+
+  return result;
+}
+
+// Reads a pixel (and its coverage) from the color image.
+void rdp_fb_read(const struct rdp_state *state, const uint8_t *ram,
+  unsigned x, unsigned y, struct rdp_color *color, unsigned *cvg) {
+  const struct rdp_image *image = &state->color_image;
+  uint32_t offset = y * image->width + x;
+
+  switch (image->size) {
+    case RDP_SIZE_16BPP: {
+      uint16_t pixel = rdp_ram_read16(ram, image->address + offset * 2);
+
+      color->r = (pixel >> 8 & 0xF8) | (pixel >> 13 & 0x7);
+      color->g = (pixel >> 3 & 0xF8) | (pixel >> 8 & 0x7);
+      color->b = (pixel << 2 & 0xF8) | (pixel >> 3 & 0x7);
+      *cvg = (pixel & 0x1) ? 7 : 0;
+      break;
+    }
+
+    case RDP_SIZE_32BPP: {
+      uint32_t pixel = rdp_ram_read32(ram, image->address + offset * 4);
+
+      color->r = pixel >> 24;
+      color->g = pixel >> 16 & 0xFF;
+      color->b = pixel >> 8 & 0xFF;
+      *cvg = pixel >> 5 & 0x7;
+      break;
+    }
+
+    default:
+      color->r = color->g = color->b = ram[(image->address +
+        offset) & RDP_RAM_MASK];
+
+      *cvg = 7;
+      break;
+  }
+
+  color->a = *cvg << 5;
+}
+
+// Writes a pixel to the color image. When the color is held back,
+// only the coverage bits get updated.
+void rdp_fb_write(const struct rdp_state *state, uint8_t *ram,
+  unsigned x, unsigned y, const struct rdp_color *color, unsigned cvg,
+  bool write_color) {
+  const struct rdp_image *image = &state->color_image;
+  uint32_t offset = y * image->width + x;
+
+  switch (image->size) {
+    case RDP_SIZE_16BPP: {
+      uint32_t address = image->address + offset * 2;
+      uint16_t pixel;
+
+      if (write_color) {
+        pixel = (color->r & 0xF8) << 8 | (color->g & 0xF8) << 3 |
+          (color->b & 0xF8) >> 2;
+      }
+
+      else
+        pixel = rdp_ram_read16(ram, address) & ~0x1;
+
+      rdp_ram_write16(ram, address, pixel | cvg >> 2);
+      break;
+    }
+
+    case RDP_SIZE_32BPP: {
+      uint32_t address = image->address + offset * 4;
+      uint32_t pixel;
+
+      if (write_color) {
+        pixel = (uint32_t) color->r << 24 | color->g << 16 |
+          color->b << 8;
+      }
+
+      else
+        pixel = rdp_ram_read32(ram, address) & ~0xFF;
+
+      rdp_ram_write32(ram, address, pixel | cvg << 5);
+      break;
+    }
+
+    default:
+      if (write_color)
+        ram[(image->address + offset) & RDP_RAM_MASK] = color->r;
+
+      break;
+  }
+}
+
+// Writes the fill color to the color image. Narrow pixels take their
+// value from the part of the fill color that lines up with them.
+void rdp_fb_fill(const struct rdp_state *state, uint8_t *ram,
+  unsigned x, unsigned y) {
+  const struct rdp_image *image = &state->color_image;
+  uint32_t offset = y * image->width + x;
+
+  switch (image->size) {
+    case RDP_SIZE_16BPP:
+      rdp_ram_write16(ram, image->address + offset * 2,
+        state->fill_color >> ((x & 0x1) ? 0 : 16));
+      break;
+
+    case RDP_SIZE_32BPP:
+      rdp_ram_write32(ram, image->address + offset * 4, state->fill_color);
+      break;
+
+    default:
+      ram[(image->address + offset) & RDP_RAM_MASK] =
+        state->fill_color >> ((~x & 0x3) << 3);
+      break;
+  }
+}
+
+// Reads a depth value (and its slope) from the depth image.
+uint32_t rdp_z_read(const struct rdp_state *state, const uint8_t *ram,
+  unsigned x, unsigned y, unsigned *dz) {
+  uint32_t offset = y * state->color_image.width + x;
+  uint16_t word = rdp_ram_read16(ram, state->z_image + offset * 2);
+
+  *dz = (word & 0x3) << 2;
+  return rdp_z_decompress(word >> 2);
+}
+
+// Writes a depth value (and its slope) to the depth image. Only the
+// upper half of the slope fits; the rest would live in hidden bits.
+void rdp_z_write(const struct rdp_state *state, uint8_t *ram,
+  unsigned x, unsigned y, uint32_t z, unsigned dz) {
+  uint32_t offset = y * state->color_image.width + x;
+
+  rdp_ram_write16(ram, state->z_image + offset * 2,
+    rdp_z_compress(z) << 2 | dz >> 2);
+}
+
@@ -0,0 +1,65 @@
+//
+// rdp/framebuffer.h: RDP color and depth image accesses.
+//
+// CEN64: Cycle-Accurate Nintendo 64 Simulator.
+// Copyright (C) 2014, Tyler J. Stachecki.
+//
+// This file is subject to the terms and conditions defined in
+// 'LICENSE', which is part of this source code package.
+//
+
+#ifndef __rdp_framebuffer_h__
+#define __rdp_framebuffer_h__
+#include "common.h"
+#include "rdp/state.h"
+
+#define RDP_RAM_MASK 0x7FFFFF
+
+// Depth values are 18 bits wide once decompressed.
+#define RDP_Z_MAX 0x3FFFF
+
+// RDRAM holds everything in big-endian byte order.
+static inline uint16_t rdp_ram_read16(const uint8_t *ram, uint32_t address) {
+  address &= RDP_RAM_MASK & ~0x1;
+  return ram[address] << 8 | ram[address + 1];
+}
+
+static inline uint32_t rdp_ram_read32(const uint8_t *ram, uint32_t address) {
+  address &= RDP_RAM_MASK & ~0x3;
+  return (uint32_t) ram[address] << 24 | ram[address + 1] << 16 |
+    ram[address + 2] << 8 | ram[address + 3];
+}
+
+static inline void rdp_ram_write16(uint8_t *ram,
+  uint32_t address, uint16_t value) {
+  address &= RDP_RAM_MASK & ~0x1;
+  ram[address] = value >> 8;
+  ram[address + 1] = value;
+}
+
+static inline void rdp_ram_write32(uint8_t *ram,
+  uint32_t address, uint32_t value) {
+  address &= RDP_RAM_MASK & ~0x3;
+  ram[address] = value >> 24;
+  ram[address + 1] = value >> 16;
+  ram[address + 2] = value >> 8;
+  ram[address + 3] = value;
+}
+
+void rdp_fb_read(const struct rdp_state *state, const uint8_t *ram,
+  unsigned x, unsigned y, struct rdp_color *color, unsigned *cvg);
+void rdp_fb_write(const struct rdp_state *state, uint8_t *ram,
+  unsigned x, unsigned y, const struct rdp_color *color, unsigned cvg,
+  bool write_color);
+void rdp_fb_fill(const struct rdp_state *state, uint8_t *ram,
+  unsigned x, unsigned y);
+
+uint32_t rdp_z_read(const struct rdp_state *state, const uint8_t *ram,
+  unsigned x, unsigned y, unsigned *dz);
+void rdp_z_write(const struct rdp_state *state, uint8_t *ram,
+  unsigned x, unsigned y, uint32_t z, unsigned dz);
+
+unsigned rdp_dz_compress(uint32_t dz);
+
+#endif
+
@@ -10,8 +10,51 @@
 
 #include "common.h"
 #include "bus/address.h"
+#include "bus/controller.h"
+#include "device/scheduler.h"
+#include "os/timer.h"
+#include "rdp/capture.h"
+#include "rdp/commands.h"
 #include "rdp/cpu.h"
+#include "rdp/framebuffer.h"
 #include "rdp/interface.h"
+#include "rdp/thread.h"
+#include "rdp/workers.h"
+#include "ri/controller.h"
+#include "rsp/cpu.h"
+#include "vr4300/cpu.h"
+#include "vr4300/idle.h"
+#include "vr4300/interface.h"
+
+// Cycles spent setting up a primitive before its first span.
+#define RDP_SETUP_CYCLES 32
+
+static void rdp_estimate_counters(struct rdp *rdp, uint64_t *values);
+static void rdp_status_write(struct rdp *rdp, uint32_t word);
+
+// Works out running totals for DPC_CLOCK, DPC_BUFBUSY, DPC_PIPEBUSY and
+// DPC_TMEM, in that order. The RDP isn't cycle-accurate, so the busy
+// counters are estimates based on the work done: a pixel per cycle
+// (two cycles in 2-cycle mode), four pixels per cycle when filling or
+// copying, a cycle per texel fetched or TMEM word loaded, and a cycle
+// per command word on top of the pipeline for the command buffer.
+void rdp_estimate_counters(struct rdp *rdp, uint64_t *values) {
+  struct rdp_counters counters;
+  uint64_t pipe;
+
+  rdp_collect_counters(rdp, &counters);
+
+  pipe = counters.primitives * RDP_SETUP_CYCLES +
+    counters.pixels[RDP_CYCLE_TYPE_1CYCLE] +
+    counters.pixels[RDP_CYCLE_TYPE_2CYCLE] * 2 +
+    (counters.pixels[RDP_CYCLE_TYPE_COPY] +
+    counters.pixels[RDP_CYCLE_TYPE_FILL]) / 4;
+
+  values[0] = scheduler_vr4300_to_rcp(rdp->bus->scheduler->now);
+  values[1] = pipe + rdp->command_words;
+  values[2] = pipe;
+  values[3] = counters.tmem_words + counters.texels;
+}
 
 // Reads a word from the DP MMIO register space.
 int read_dp_regs(void *opaque, uint32_t address, uint32_t *word) {
@@ -19,7 +62,53 @@ int read_dp_regs(void *opaque, uint32_t address, uint32_t *word) {
   uint32_t offset = address - DP_REGS_BASE_ADDRESS;
   enum dp_register reg = (offset >> 2);
 
-  *word = rdp->regs[reg];
+  switch (reg) {
+    // The counters are 24 bits wide; none of them can outrun the clock.
+    case DPC_CLOCK_REG:
+    case DPC_BUFBUSY_REG:
+    case DPC_PIPEBUSY_REG:
+    case DPC_TMEM_REG: {
+      struct scheduler *scheduler = rdp->bus->scheduler;
+      uint64_t clock, count;
+
+      clock = scheduler_vr4300_to_rcp(scheduler->now) - rdp->counter_base[0];
+      count = clock;
+
+      // Only the busy counters need the renderers to catch up first;
+      // the clock is just the time, so reading it doesn't stall them.
+      if (reg != DPC_CLOCK_REG) {
+        unsigned i = reg - DPC_CLOCK_REG;
+        uint64_t values[4];
+
+        rdp_estimate_counters(rdp, values);
+        count = values[i] - rdp->counter_base[i];
+      }
+
+      *word = (count < clock ? count : clock) & 0xFFFFFF;
+
+#ifdef VR4300_BUSY_WAIT_DETECTION
+      // The counters move on every cycle, so a loop polling them
+      // mustn't be fast-forwarded at all.
+      vr4300_idle_limit(&rdp->bus->vr4300->idle, scheduler->now);
+#endif
+      break;
+    }
+
+    // The RDP looks busy for as long as the RDP thread has commands
+    // left to draw. Polling it doesn't wait, so the two keep overlapping.
+    case DPC_STATUS_REG:
+      *word = rdp->regs[reg];
+
+      if (rdp->thread.enabled && rdp_thread_busy(&rdp->thread))
+        *word |= DP_STATUS_TMEM_BUSY | DP_STATUS_PIPE_BUSY | DP_STATUS_CMD_BUSY;
+
+      break;
+
+    default:
+      *word = rdp->regs[reg];
+      break;
+  }
+
   debug_mmio_read(dp, dp_register_mnemonics[reg], *word);
   return 0;
 }
@@ -30,9 +119,172 @@ int write_dp_regs(void *opaque, uint32_t address, uint32_t word, uint32_t dqm) {
   uint32_t offset = address - DP_REGS_BASE_ADDRESS;
   enum dp_register reg = (offset >> 2);
 
-  debug_mmio_write(dp, dp_register_mnemonics[reg], word, dqm);
-  rdp->regs[reg] &= ~dqm;
-  rdp->regs[reg] |= word;
+  // Over the XBUS, the RDP reads its commands out of DMEM; let a
+  // threaded RSP finish writing them out before it does.
+  if (rdp->regs[DPC_STATUS_REG] & DP_STATUS_XBUS_DMA)
+    rsp_sync(rdp->bus->rsp);
+
+  rdp_write_reg(rdp, reg, word, dqm);
   return 0;
 }
 
+// Writes a DP register on behalf of either processor. The RSP comes
+// straight here, as it's already in step with everything it shares.
+void rdp_write_reg(struct rdp *rdp, unsigned reg,
+  uint32_t word, uint32_t dqm) {
+  debug_mmio_write(dp, dp_register_mnemonics[reg], word, dqm);
+  word = (rdp->regs[reg] & ~dqm) | (word & dqm);
+
+  switch (reg) {
+    // A new start address only takes once the current list is done.
+    case DPC_START_REG:
+      if (!(rdp->regs[DPC_STATUS_REG] & DP_STATUS_START_VALID)) {
+        rdp->regs[DPC_START_REG] = word & 0xFFFFF8;
+        rdp->regs[DPC_STATUS_REG] |= DP_STATUS_START_VALID;
+      }
+
+      break;
+
+    case DPC_END_REG:
+      rdp->regs[DPC_END_REG] = word & 0xFFFFF8;
+
+      if (rdp->regs[DPC_STATUS_REG] & DP_STATUS_START_VALID) {
+        rdp->regs[DPC_CURRENT_REG] = rdp->regs[DPC_START_REG];
+        rdp->regs[DPC_STATUS_REG] &= ~DP_STATUS_START_VALID;
+      }
+
+      if (!(rdp->regs[DPC_STATUS_REG] & DP_STATUS_FREEZE))
+        rdp_process_list(rdp);
+
+      break;
+
+    case DPC_STATUS_REG:
+      rdp_status_write(rdp, word);
+      break;
+
+    // The rest of the registers are read-only.
+    default:
+      break;
+  }
+}
+
+// Applies the set/clear bits written to DPC_STATUS.
+void rdp_status_write(struct rdp *rdp, uint32_t word) {
+  uint32_t status = rdp->regs[DPC_STATUS_REG];
+
+  if (word & DP_CLR_XBUS_DMA)
+    status &= ~DP_STATUS_XBUS_DMA;
+  else if (word & DP_SET_XBUS_DMA)
+    status |= DP_STATUS_XBUS_DMA;
+
+  if (word & DP_CLR_FREEZE)
+    status &= ~DP_STATUS_FREEZE;
+  else if (word & DP_SET_FREEZE)
+    status |= DP_STATUS_FREEZE;
+
+  if (word & DP_CLR_FLUSH)
+    status &= ~DP_STATUS_FLUSH;
+  else if (word & DP_SET_FLUSH)
+    status |= DP_STATUS_FLUSH;
+
+  rdp->regs[DPC_STATUS_REG] = status;
+
+  if (word & (DP_CLR_CLOCK_CTR | DP_CLR_CMD_CTR |
+    DP_CLR_PIPE_CTR | DP_CLR_TMEM_CTR)) {
+    uint64_t values[4];
+
+    rdp_estimate_counters(rdp, values);
+
+    if (word & DP_CLR_CLOCK_CTR)
+      rdp->counter_base[0] = values[0];
+
+    if (word & DP_CLR_CMD_CTR)
+      rdp->counter_base[1] = values[1];
+
+    if (word & DP_CLR_PIPE_CTR)
+      rdp->counter_base[2] = values[2];
+
+    if (word & DP_CLR_TMEM_CTR)
+      rdp->counter_base[3] = values[3];
+  }
+
+  // Anything held back by a freeze gets run once it's lifted.
+  if ((word & DP_CLR_FREEZE) && !(status & DP_STATUS_FREEZE))
+    rdp_process_list(rdp);
+}
+
+// Runs the command list from DPC_CURRENT up to DPC_END. Commands can
+// straddle the end of a list; any partial command is held onto until
+// the next list completes it.
+void rdp_process_list(struct rdp *rdp) {
+  uint32_t current = rdp->regs[DPC_CURRENT_REG];
+  uint32_t end = rdp->regs[DPC_END_REG];
+  bool xbus = (rdp->regs[DPC_STATUS_REG] & DP_STATUS_XBUS_DMA) != 0;
+  cen64_time start_time, end_time;
+
+  // When there's an RDP thread, it keeps track of its own time.
+  if (!rdp->thread.enabled)
+    get_time(&start_time);
+
+  while (current < end) {
+    uint64_t word;
+
+    if (xbus)
+      memcpy(&word, rdp->bus->rsp->mem + (current & 0xFF8), sizeof(word));
+
+    else {
+      memcpy(&word, rdp->bus->ri->ram + (current & RDP_RAM_MASK & ~0x7),
+        sizeof(word));
+    }
+
+    rdp->cmd_buffer[rdp->cmd_length++] = ntohll(word);
+    current += sizeof(word);
+
+    if (rdp->cmd_length < rdp_command_length(rdp->cmd_buffer[0]))
+      continue;
+
+    if (rdp->capture) {
+      rdp_capture_command(rdp->capture, rdp->bus->ri->ram,
+        rdp->cmd_buffer, rdp->cmd_length);
+    }
+
+    if (rdp->thread.enabled)
+      rdp_thread_push(&rdp->thread, rdp->cmd_buffer, rdp->cmd_length);
+    else if (rdp->workers)
+      rdp_workers_submit(rdp->workers, rdp->cmd_buffer, rdp->cmd_length);
+    else
+      rdp_execute_command(&rdp->state, rdp->bus->ri->ram, rdp->cmd_buffer);
+
+    // Everything before a full sync has been drawn; let the CPU know.
+    if ((rdp->cmd_buffer[0] >> 56 & 0x3F) == RDP_CMD_SYNC_FULL) {
+      if (rdp->thread.enabled)
+        rdp_thread_sync(&rdp->thread);
+      else if (rdp->workers)
+        rdp_workers_flush(rdp->workers);
+
+      signal_rcp_interrupt(rdp->bus->vr4300, MI_INTR_DP);
+    }
+
+    rdp->cmd_length = 0;
+  }
+
+  rdp->command_words += (current - rdp->regs[DPC_CURRENT_REG]) >> 3;
+  rdp->regs[DPC_CURRENT_REG] = current;
+
+  if (rdp->thread.enabled)
+    rdp_thread_publish(&rdp->thread);
+
+  // Pages are captured as they stand, so the list has to land first.
+  if (rdp->capture) {
+    if (rdp->workers)
+      rdp_workers_flush(rdp->workers);
+
+    rdp_capture_list(rdp->capture, rdp->bus->ri->ram);
+  }
+
+  if (!rdp->thread.enabled) {
+    get_time(&end_time);
+    rdp->counters.host_ns += compute_time_difference(&end_time, &start_time);
+  }
+}
+
@@ -12,8 +12,14 @@
 #define __rdp_interface_h__
 #include "common.h"
 
+struct rdp;
+
+cen64_hot void rdp_process_list(struct rdp *rdp);
+
 int read_dp_regs(void *opaque, uint32_t address, uint32_t *word);
 int write_dp_regs(void *opaque, uint32_t address, uint32_t word, uint32_t dqm);
 
+void rdp_write_reg(struct rdp *rdp, unsigned reg, uint32_t word, uint32_t dqm);
+
 #endif
 
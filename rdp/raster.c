@@ -0,0 +1,262 @@
+//
+// rdp/raster.c: RDP triangle and rectangle rasterization.
+//
+// CEN64: Cycle-Accurate Nintendo 64 Simulator.
+// Copyright (C) 2014, Tyler J. Stachecki.
+//
+// This file is subject to the terms and conditions defined in
+// 'LICENSE', which is part of this source code package.
+//
+
+#include "common.h"
+#include "rdp/framebuffer.h"
+#include "rdp/raster.h"
+#include "rdp/span.h"
+#include "rdp/state.h"
+
+static void rdp_dispatch_span(const struct rdp_state *state,
+  uint8_t *ram, const struct rdp_span *span);
+static void rdp_scissor_x(const struct rdp_state *state,
+  int32_t *x0, int32_t *x1);
+
+// Hands a span off to whichever pipeline the cycle type selects.
+void rdp_dispatch_span(const struct rdp_state *state,
+  uint8_t *ram, const struct rdp_span *span) {
+  enum rdp_cycle_type cycle_type = state->other_modes.cycle_type;
+  unsigned width = span->x1 - span->x0;
+
+  // Copy mode always reads texels; the 2-cycle pipe reads two tiles.
+  state->counters->pixels[cycle_type] += width;
+
+  if (cycle_type == RDP_CYCLE_TYPE_COPY)
+    state->counters->texels += width;
+  else if (span->texture && cycle_type != RDP_CYCLE_TYPE_FILL)
+    state->counters->texels += width << (cycle_type == RDP_CYCLE_TYPE_2CYCLE);
+
+  switch (cycle_type) {
+    case RDP_CYCLE_TYPE_FILL:
+      rdp_fill_span(state, ram, span);
+      break;
+
+    case RDP_CYCLE_TYPE_COPY:
+      rdp_copy_span(state, ram, span);
+      break;
+
+    default:
+      rdp_render_span(state, ram, span);
+      break;
+  }
+}
+
+// Returns the horizontal pixel bounds of the scissor box.
+void rdp_scissor_x(const struct rdp_state *state, int32_t *x0, int32_t *x1) {
+  *x0 = state->scissor.xh >> 2;
+  *x1 = (state->scissor.xl + 3) >> 2;
+
+  if (*x1 > *x0 + RDP_MAX_SPAN_WIDTH)
+    *x1 = *x0 + RDP_MAX_SPAN_WIDTH;
+}
+
+// Walks the edges of a triangle four subscanlines at a time, building
+// up coverage and emitting a span for each scanline it touches.
+void rdp_draw_triangle(const struct rdp_state *state,
+  uint8_t *ram, const struct rdp_triangle *triangle) {
+  uint8_t cvg[RDP_MAX_SPAN_WIDTH];
+  int32_t ytop = triangle->yh & ~0x3;
+  int32_t ystart, yend, clip_x0, clip_x1, y;
+  struct rdp_span span;
+  unsigned i;
+
+  if (state->band_index == 0)
+    state->counters->primitives++;
+
+  memset(&span, 0, sizeof(span));
+  span.cvg = cvg;
+  span.tile = triangle->tile;
+  span.shade = triangle->shade;
+  span.texture = triangle->texture;
+  span.zbuffer = triangle->zbuffer;
+  span.persp = triangle->texture && state->other_modes.persp_tex_en;
+
+  if (triangle->zbuffer) {
+    int64_t dz = (int64_t) abs(triangle->dadx[RDP_ATTR_Z]) +
+      abs(triangle->dady[RDP_ATTR_Z]);
+
+    span.dz = rdp_dz_compress(dz >> 13 > 0xFFFF ? 0xFFFF : dz >> 13);
+  }
+
+  for (i = 0; i < RDP_NUM_ATTRS; i++)
+    span.step[i] = triangle->dadx[i];
+
+  ystart = triangle->yh > (int32_t) state->scissor.yh
+    ? triangle->yh : (int32_t) state->scissor.yh;
+  yend = triangle->yl < (int32_t) state->scissor.yl
+    ? triangle->yl : (int32_t) state->scissor.yl;
+
+  rdp_scissor_x(state, &clip_x0, &clip_x1);
+
+  for (y = ystart >> 2; y << 2 < yend; y++) {
+    int32_t left[4], right[4];
+    int32_t x0 = INT32_MAX, x1 = INT32_MIN;
+    int32_t xmajor;
+    bool valid[4];
+    unsigned sub;
+
+    if (!rdp_state_owns_row(state, y))
+      continue;
+
+    // Find where the span edges lie on each subscanline.
+    for (sub = 0; sub < 4; sub++) {
+      int32_t sy = (y << 2) + sub;
+      int32_t major, minor;
+
+      valid[sub] = false;
+
+      if (sy < ystart || sy >= yend)
+        continue;
+
+      major = triangle->xh + (int32_t) ((int64_t)
+        triangle->dxhdy * (sy - ytop) >> 2);
+
+      minor = sy < triangle->ym
+        ? triangle->xm + (int32_t) ((int64_t)
+          triangle->dxmdy * (sy - ytop) >> 2)
+        : triangle->xl + (int32_t) ((int64_t)
+          triangle->dxldy * (sy - triangle->ym) >> 2);
+
+      left[sub] = triangle->left_major ? major : minor;
+      right[sub] = triangle->left_major ? minor : major;
+
+      if (left[sub] >= right[sub])
+        continue;
+
+      valid[sub] = true;
+
+      if (left[sub] >> 16 < x0)
+        x0 = left[sub] >> 16;
+
+      if ((right[sub] + 0xFFFF) >> 16 > x1)
+        x1 = (right[sub] + 0xFFFF) >> 16;
+    }
+
+    if (x0 < clip_x0)
+      x0 = clip_x0;
+
+    if (x1 > clip_x1)
+      x1 = clip_x1;
+
+    if (x0 >= x1)
+      continue;
+
+    // Each subscanline samples two points per pixel.
+    memset(cvg, 0, x1 - x0);
+
+    for (sub = 0; sub < 4; sub++) {
+      int32_t x;
+
+      if (!valid[sub])
+        continue;
+
+      for (x = x0; x < x1; x++) {
+        int32_t sample = (int32_t) ((uint32_t) x << 16);
+
+        cvg[x - x0] +=
+          (sample + 0x4000 >= left[sub] && sample + 0x4000 < right[sub]) +
+          (sample + 0xC000 >= left[sub] && sample + 0xC000 < right[sub]);
+      }
+    }
+
+    // Attributes are stepped down the major edge, then across.
+    xmajor = triangle->xh + (int32_t) ((int64_t)
+      triangle->dxhdy * ((y << 2) - ytop) >> 2);
+
+    for (i = 0; i < RDP_NUM_ATTRS; i++) {
+      int64_t value = triangle->attr[i] +
+        (int64_t) triangle->dade[i] * (y - (ytop >> 2)) +
+        ((int64_t) triangle->dadx[i] * ((int64_t) x0 * 0x10000 - xmajor) >> 16);
+
+      span.attr[i] = (int32_t) value;
+    }
+
+    span.y = y;
+    span.x0 = x0;
+    span.x1 = x1;
+
+    rdp_dispatch_span(state, ram, &span);
+  }
+}
+
+// Draws a screen-aligned rectangle. Fill and copy mode rectangles
+// include their lower-right edge; the others do not.
+void rdp_draw_rectangle(const struct rdp_state *state,
+  uint8_t *ram, const struct rdp_rectangle *rectangle) {
+  enum rdp_cycle_type cycle_type = state->other_modes.cycle_type;
+  bool inclusive = cycle_type == RDP_CYCLE_TYPE_FILL ||
+    cycle_type == RDP_CYCLE_TYPE_COPY;
+  int32_t x0 = rectangle->xh >> 2, y0 = rectangle->yh >> 2;
+  int32_t x1, y1, clip_x0, clip_x1, clip_y0, clip_y1, y;
+  int32_t xstep_s, xstep_t, ystep_s, ystep_t;
+  unsigned xshift;
+  struct rdp_span span;
+
+  if (state->band_index == 0)
+    state->counters->primitives++;
+
+  if (inclusive) {
+    x1 = (rectangle->xl >> 2) + 1;
+    y1 = (rectangle->yl >> 2) + 1;
+  }
+
+  else {
+    x1 = (rectangle->xl + 3) >> 2;
+    y1 = (rectangle->yl + 3) >> 2;
+  }
+
+  // Copy mode moves four texels per step of DsDx.
+  xshift = cycle_type == RDP_CYCLE_TYPE_COPY ? 9 : 11;
+
+  if (rectangle->flip) {
+    xstep_s = 0;
+    xstep_t = (int32_t) ((uint32_t) rectangle->dtdy << xshift);
+    ystep_s = (int32_t) ((uint32_t) rectangle->dsdx << 11);
+    ystep_t = 0;
+  }
+
+  else {
+    xstep_s = (int32_t) ((uint32_t) rectangle->dsdx << xshift);
+    xstep_t = 0;
+    ystep_s = 0;
+    ystep_t = (int32_t) ((uint32_t) rectangle->dtdy << 11);
+  }
+
+  rdp_scissor_x(state, &clip_x0, &clip_x1);
+  clip_y0 = state->scissor.yh >> 2;
+  clip_y1 = (state->scissor.yl + 3) >> 2;
+
+  memset(&span, 0, sizeof(span));
+  span.tile = rectangle->tile;
+  span.texture = rectangle->texture;
+  span.step[RDP_ATTR_S] = xstep_s;
+  span.step[RDP_ATTR_T] = xstep_t;
+  span.x0 = x0 > clip_x0 ? x0 : clip_x0;
+  span.x1 = x1 < clip_x1 ? x1 : clip_x1;
+
+  if ((int32_t) span.x0 >= (int32_t) span.x1)
+    return;
+
+  for (y = y0 > clip_y0 ? y0 : clip_y0; y < y1 && y < clip_y1; y++) {
+    int32_t dx = span.x0 - x0, dy = y - y0;
+
+    if (!rdp_state_owns_row(state, y))
+      continue;
+
+    span.attr[RDP_ATTR_S] = (int32_t) ((uint32_t) rectangle->s << 16) +
+      xstep_s * dx + ystep_s * dy;
+    span.attr[RDP_ATTR_T] = (int32_t) ((uint32_t) rectangle->t << 16) +
+      xstep_t * dx + ystep_t * dy;
+
+    span.y = y;
+    rdp_dispatch_span(state, ram, &span);
+  }
+}
+
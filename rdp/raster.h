@@ -0,0 +1,60 @@
+//
+// rdp/raster.h: RDP triangle and rectangle rasterization.
+//
+// CEN64: Cycle-Accurate Nintendo 64 Simulator.
+// Copyright (C) 2014, Tyler J. Stachecki.
+//
+// This file is subject to the terms and conditions defined in
+// 'LICENSE', which is part of this source code package.
+//
+
+#ifndef __rdp_raster_h__
+#define __rdp_raster_h__
+#include "common.h"
+#include "rdp/span.h"
+#include "rdp/state.h"
+
+// Spans never run wider than the largest scissor box.
+#define RDP_MAX_SPAN_WIDTH 1024
+
+struct rdp_triangle {
+  bool left_major;
+  unsigned tile;
+
+  // Edge endpoints are s11.2; edge positions and slopes are s15.16.
+  int32_t yh, ym, yl;
+  int32_t xh, xm, xl;
+  int32_t dxhdy, dxmdy, dxldy;
+
+  bool shade;
+  bool texture;
+  bool zbuffer;
+
+  // Attributes at (XH, YH), and their slopes along X, the major
+  // edge and Y.
+  int32_t attr[RDP_NUM_ATTRS];
+  int32_t dadx[RDP_NUM_ATTRS];
+  int32_t dade[RDP_NUM_ATTRS];
+  int32_t dady[RDP_NUM_ATTRS];
+};
+
+struct rdp_rectangle {
+  unsigned xh, yh;
+  unsigned xl, yl;
+  unsigned tile;
+
+  // Texture coordinates are s10.5, steps are s5.10.
+  int32_t s, t;
+  int32_t dsdx, dtdy;
+
+  bool flip;
+  bool texture;
+};
+
+void rdp_draw_triangle(const struct rdp_state *state,
+  uint8_t *ram, const struct rdp_triangle *triangle);
+void rdp_draw_rectangle(const struct rdp_state *state,
+  uint8_t *ram, const struct rdp_rectangle *rectangle);
+
+#endif
+
@@ -0,0 +1,278 @@
+//
+// rdp/replay/replay.c: Offline RDP command list replay.
+//
+// CEN64: Cycle-Accurate Nintendo 64 Simulator.
+// Copyright (C) 2014, Tyler J. Stachecki.
+//
+// This file is subject to the terms and conditions defined in
+// 'LICENSE', which is part of this source code package.
+//
+
+#include "common.h"
+#include "bus/controller.h"
+#include "os/timer.h"
+#include "rdp/capture.h"
+#include "rdp/commands.h"
+#include "rdp/cpu.h"
+#include "rdp/framebuffer.h"
+#include "rdp/workers.h"
+#include "ri/controller.h"
+#include <stdio.h>
+
+struct replay_stats {
+  unsigned long long lists;
+  unsigned long long commands;
+  struct rdp_counters rdp;
+};
+
+static uint8_t *load_capture(const char *path, size_t *size);
+static uint32_t read32(const uint8_t *data);
+static int replay_capture(struct rdp *rdp, const uint8_t *data,
+  size_t size, struct replay_stats *stats);
+static uint64_t replay_hash(const uint8_t *ram);
+static void print_usage(const char *invokation_string);
+
+// Reads a whole capture into memory, so that disk I/O isn't timed.
+uint8_t *load_capture(const char *path, size_t *size) {
+  uint8_t *data;
+  long length;
+  FILE *f;
+
+  if ((f = fopen(path, "rb")) == NULL)
+    return NULL;
+
+  if (fseek(f, 0, SEEK_END) || (length = ftell(f)) < 0 ||
+    fseek(f, 0, SEEK_SET)) {
+    fclose(f);
+    return NULL;
+  }
+
+  if ((data = (uint8_t *) malloc(length + 1)) == NULL ||
+    fread(data, 1, length, f) != (size_t) length) {
+    free(data);
+    fclose(f);
+    return NULL;
+  }
+
+  fclose(f);
+  *size = length;
+  return data;
+}
+
+uint32_t read32(const uint8_t *data) {
+  return (uint32_t) data[0] << 24 | (uint32_t) data[1] << 16 |
+    (uint32_t) data[2] << 8 | data[3];
+}
+
+// Runs every record in a capture through the RDP backend.
+int replay_capture(struct rdp *rdp, const uint8_t *data,
+  size_t size, struct replay_stats *stats) {
+  uint8_t *ram = rdp->bus->ri->ram;
+  size_t offset = 12;
+
+  while (offset + 8 <= size) {
+    uint32_t tag = read32(data + offset);
+    uint32_t arg = read32(data + offset + 4);
+    offset += 8;
+
+    if (tag == RDP_CAPTURE_TAG_PAGE) {
+      if (size - offset < RDP_CAPTURE_PAGE_SIZE ||
+        arg > RDP_RAM_MASK + 1 - RDP_CAPTURE_PAGE_SIZE)
+        return 1;
+
+      // Anything still queued has to land before the page changes.
+      if (rdp->workers)
+        rdp_workers_flush(rdp->workers);
+
+      memcpy(ram + arg, data + offset, RDP_CAPTURE_PAGE_SIZE);
+      offset += RDP_CAPTURE_PAGE_SIZE;
+    }
+
+    else if (tag == RDP_CAPTURE_TAG_LIST) {
+      const uint8_t *words = data + offset;
+      uint32_t i;
+
+      if ((size - offset) / sizeof(uint64_t) < arg)
+        return 1;
+
+      for (i = 0; i < arg; i++) {
+        uint64_t word;
+
+        memcpy(&word, words + i * sizeof(word), sizeof(word));
+        rdp->cmd_buffer[rdp->cmd_length++] = ntohll(word);
+
+        if (rdp->cmd_length < rdp_command_length(rdp->cmd_buffer[0]))
+          continue;
+
+        if (rdp->workers)
+          rdp_workers_submit(rdp->workers, rdp->cmd_buffer, rdp->cmd_length);
+        else
+          rdp_execute_command(&rdp->state, ram, rdp->cmd_buffer);
+
+        if ((rdp->cmd_buffer[0] >> 56 & 0x3F) == RDP_CMD_SYNC_FULL &&
+          rdp->workers)
+          rdp_workers_flush(rdp->workers);
+
+        rdp->cmd_length = 0;
+        stats->commands++;
+      }
+
+      offset += arg * sizeof(uint64_t);
+      stats->lists++;
+    }
+
+    else
+      return 1;
+  }
+
+  if (rdp->workers)
+    rdp_workers_flush(rdp->workers);
+
+  return offset != size;
+}
+
+// Hashes RDRAM so that runs can be compared with one another.
+uint64_t replay_hash(const uint8_t *ram) {
+  uint64_t hash = 0xCBF29CE484222325ULL;
+  size_t i;
+
+  for (i = 0; i <= RDP_RAM_MASK; i++)
+    hash = (hash ^ ram[i]) * 0x100000001B3ULL;
+
+  return hash;
+}
+
+void print_usage(const char *invokation_string) {
+  printf("%s [Options] <Capture Path>\n\n"
+
+    "Options:\n"
+      "  -loops <count>             : Replay the capture this many times.\n"
+      "  -threads <count>           : Rasterize on this many threads.\n"
+
+    ,invokation_string
+  );
+}
+
+// Replays a capture made with -rdpcapture and reports throughput.
+int main(int argc, const char *argv[]) {
+  struct bus_controller bus;
+  struct ri_controller ri;
+  struct replay_stats stats;
+  unsigned i, loops = 1, threads = 1;
+  cen64_time start, end;
+  unsigned long long ns, lookups;
+  struct rdp *rdp;
+  uint8_t *data;
+  size_t size;
+  double secs;
+  int status;
+
+  for (i = 1; i < (unsigned) argc - 1; i++) {
+    if (!strcmp(argv[i], "-loops") && i + 1 < (unsigned) argc - 1)
+      loops = atoi(argv[++i]);
+
+    else if (!strcmp(argv[i], "-threads") && i + 1 < (unsigned) argc - 1)
+      threads = atoi(argv[++i]);
+
+    else
+      break;
+  }
+
+  if (argc < 2 || i != (unsigned) argc - 1 || loops == 0 || threads == 0) {
+    print_usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  if ((data = load_capture(argv[i], &size)) == NULL) {
+    printf("Failed to load the capture: %s\n", argv[i]);
+    return EXIT_FAILURE;
+  }
+
+  if (size < 12 || memcmp(data, RDP_CAPTURE_MAGIC, 8) ||
+    read32(data + 8) != RDP_CAPTURE_VERSION) {
+    printf("Not a version %u RDP capture: %s\n", RDP_CAPTURE_VERSION, argv[i]);
+    free(data);
+    return EXIT_FAILURE;
+  }
+
+  memset(&bus, 0, sizeof(bus));
+  memset(&ri, 0, sizeof(ri));
+  memset(&stats, 0, sizeof(stats));
+  bus.ri = &ri;
+
+  ri.ram = (uint8_t *) malloc(RDP_RAM_MASK + 1);
+  rdp = (struct rdp *) malloc(sizeof(*rdp));
+
+  if (ri.ram == NULL || rdp == NULL) {
+    printf("Failed to allocate memory for the replay.\n");
+    free(ri.ram);
+    free(rdp);
+    free(data);
+    return EXIT_FAILURE;
+  }
+
+  get_time(&start);
+
+  // Each loop starts over from the state the capture started with.
+  for (status = 0, i = 0; i < loops && !status; i++) {
+    memset(ri.ram, 0, RDP_RAM_MASK + 1);
+    memset(rdp, 0, sizeof(*rdp));
+    rdp_init(rdp, &bus);
+
+    if (threads > 1 && rdp_workers_start(rdp, threads))
+      printf("Failed to start the RDP workers; using one thread.\n");
+
+    status = replay_capture(rdp, data, size, &stats);
+
+    rdp_workers_stop(rdp);
+    rdp_counters_add(&stats.rdp, &rdp->counters);
+    rdp_destroy(rdp);
+  }
+
+  get_time(&end);
+  ns = compute_time_difference(&end, &start);
+  secs = ns > 0 ? (double) ns / NS_PER_SEC : 1e-9;
+  lookups = stats.rdp.texcache_hits + stats.rdp.texcache_misses;
+
+  if (status)
+    printf("The capture is truncated or corrupt: %s\n", argv[argc - 1]);
+
+  printf("{\n"
+    "  \"loops\": %u,\n"
+    "  \"lists\": %llu,\n"
+    "  \"commands\": %llu,\n"
+    "  \"wall_time\": %.6f,\n"
+    "  \"lists_per_second\": %.3f,\n"
+    "  \"commands_per_second\": %.3f,\n"
+    "  \"primitives\": %llu,\n"
+    "  \"pixels_1cycle\": %llu,\n"
+    "  \"pixels_2cycle\": %llu,\n"
+    "  \"pixels_copy\": %llu,\n"
+    "  \"pixels_fill\": %llu,\n"
+    "  \"texels\": %llu,\n"
+    "  \"texcache_hit_rate\": %.6f,\n"
+    "  \"rdram_hash\": \"%016llx\"\n"
+    "}\n",
+
+    i,
+    stats.lists,
+    stats.commands,
+    secs,
+    stats.lists / secs,
+    stats.commands / secs,
+    (unsigned long long) stats.rdp.primitives,
+    (unsigned long long) stats.rdp.pixels[RDP_CYCLE_TYPE_1CYCLE],
+    (unsigned long long) stats.rdp.pixels[RDP_CYCLE_TYPE_2CYCLE],
+    (unsigned long long) stats.rdp.pixels[RDP_CYCLE_TYPE_COPY],
+    (unsigned long long) stats.rdp.pixels[RDP_CYCLE_TYPE_FILL],
+    (unsigned long long) stats.rdp.texels,
+    lookups > 0 ? (double) stats.rdp.texcache_hits / lookups : 0.0,
+    (unsigned long long) replay_hash(ri.ram)
+  );
+
+  free(ri.ram);
+  free(rdp);
+  free(data);
+  return status ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
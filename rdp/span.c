@@ -0,0 +1,461 @@
+//
+// rdp/span.c: RDP span rendering.
+//
+// CEN64: Cycle-Accurate Nintendo 64 Simulator.
+// Copyright (C) 2014, Tyler J. Stachecki.
+//
+// This file is subject to the terms and conditions defined in
+// 'LICENSE', which is part of this source code package.
+//
+
+#include "common.h"
+#include "rdp/blender.h"
+#include "rdp/combiner.h"
+#include "rdp/framebuffer.h"
+#include "rdp/raster.h"
+#include "rdp/span.h"
+#include "rdp/state.h"
+#include "rdp/texture.h"
+
+// A group of pixels on their way through the pipeline.
+struct rdp_span_lanes {
+  struct rdp_combiner_inputs combine;
+  struct rdp_blender_inputs blend;
+  struct rdp_color_lanes pixel;
+
+  uint32_t seed[RDP_LANES];
+  uint32_t z[RDP_LANES];
+  unsigned dz[RDP_LANES];
+  unsigned cvg[RDP_LANES];
+  bool overflow[RDP_LANES];
+  bool live[RDP_LANES];
+  unsigned count;
+};
+
+static int32_t rdp_span_color(int32_t value);
+static void rdp_span_texcoord(const struct rdp_span *span,
+  const int32_t *attr, int32_t *s, int32_t *t);
+static bool rdp_z_test(const struct rdp_state *state,
+  uint32_t z, unsigned dz, uint32_t mem_z, unsigned mem_dz);
+static void rdp_span_store_color(struct rdp_color_lanes *lanes,
+  unsigned i, const struct rdp_color *color);
+static bool rdp_span_gather(const struct rdp_state *state, uint8_t *ram,
+  const struct rdp_span *span, struct rdp_span_lanes *lanes,
+  unsigned x, int32_t *attr, uint32_t *seed);
+static bool rdp_span_resolve(const struct rdp_state *state, uint8_t *ram,
+  const struct rdp_span *span, struct rdp_span_lanes *lanes, unsigned x);
+static bool rdp_copy_row(const struct rdp_state *state, uint8_t *ram,
+  const struct rdp_span *span);
+static void rdp_span_write(const struct rdp_state *state, uint8_t *ram,
+  const struct rdp_span *span, struct rdp_span_lanes *lanes, unsigned x);
+
+// Reduces an s15.16 shade component to an 8-bit color channel.
+int32_t rdp_span_color(int32_t value) {
+  value >>= 16;
+
+  if (value < 0)
+    return 0;
+
+  return value > 0xFF ? 0xFF : value;
+}
+
+// Copies a copy mode span of 16-bit texels to a 16-bit image a row at
+// a time. Returns false if the span has to be copied texel by texel.
+bool rdp_copy_row(const struct rdp_state *state, uint8_t *ram,
+  const struct rdp_span *span) {
+  const struct rdp_image *image = &state->color_image;
+  int32_t s = span->attr[RDP_ATTR_S] >> 16;
+  int32_t t = span->attr[RDP_ATTR_T] >> 16;
+  unsigned count = span->x1 - span->x0, x;
+  uint8_t row[RDP_MAX_SPAN_WIDTH * 2];
+  uint32_t address;
+
+  address = image->address + (span->y * image->width + span->x0) * 2;
+
+  if ((image->address & 0x1) || count > RDP_MAX_SPAN_WIDTH ||
+    (address & RDP_RAM_MASK) + count * 2 > RDP_RAM_MASK + 1)
+    return false;
+
+  address &= RDP_RAM_MASK;
+
+  if (!state->other_modes.alpha_compare_en) {
+    return rdp_texture_copy_row(state, span->tile,
+      s, t, count, ram + address);
+  }
+
+  if (!rdp_texture_copy_row(state, span->tile, s, t, count, row))
+    return false;
+
+  // Only texels with their coverage bit set get written.
+  for (x = 0; x < count; x++) {
+    if (row[x * 2 + 1] & 0x1)
+      memcpy(ram + address + x * 2, row + x * 2, 2);
+  }
+
+  return true;
+}
+
+// Moves a color into one lane of a group.
+void rdp_span_store_color(struct rdp_color_lanes *lanes,
+  unsigned i, const struct rdp_color *color) {
+  lanes->c[0][i] = color->r;
+  lanes->c[1][i] = color->g;
+  lanes->c[2][i] = color->b;
+  lanes->c[3][i] = color->a;
+}
+
+// Produces the s10.5 texture coordinates for a pixel, dividing
+// through by W when perspective correction is enabled.
+void rdp_span_texcoord(const struct rdp_span *span,
+  const int32_t *attr, int32_t *s, int32_t *t) {
+  int64_t ss, tt, w;
+
+  if (!span->persp) {
+    *s = attr[RDP_ATTR_S] >> 16;
+    *t = attr[RDP_ATTR_T] >> 16;
+    return;
+  }
+
+  if ((w = attr[RDP_ATTR_W]) <= 0)
+    w = 1;
+
+  ss = ((int64_t) attr[RDP_ATTR_S] << 15) / w;
+  tt = ((int64_t) attr[RDP_ATTR_T] << 15) / w;
+
+  *s = ss < -0x8000 ? -0x8000 : (ss > 0x7FFF ? 0x7FFF : ss);
+  *t = tt < -0x8000 ? -0x8000 : (tt > 0x7FFF ? 0x7FFF : tt);
+}
+
+// Compares a pixel's depth against what's in the depth image.
+bool rdp_z_test(const struct rdp_state *state,
+  uint32_t z, unsigned dz, uint32_t mem_z, unsigned mem_dz) {
+  if (state->other_modes.z_mode == RDP_Z_MODE_DECAL) {
+    uint32_t dzmax = 1U << (dz > mem_dz ? dz : mem_dz);
+    uint32_t diff = z > mem_z ? z - mem_z : mem_z - z;
+
+    return diff <= dzmax;
+  }
+
+  return mem_z == RDP_Z_MAX || z <= mem_z;
+}
+
+// Gathers a group of pixels: coverage, depth testing, shading and
+// texturing. Returns false if no pixel in the group survived.
+bool rdp_span_gather(const struct rdp_state *state, uint8_t *ram,
+  const struct rdp_span *span, struct rdp_span_lanes *lanes,
+  unsigned x, int32_t *attr, uint32_t *seed) {
+  const struct rdp_other_modes *modes = &state->other_modes;
+  bool two_cycle = modes->cycle_type == RDP_CYCLE_TYPE_2CYCLE;
+  struct rdp_combiner_inputs *inputs = &lanes->combine;
+  bool any_live = false;
+  unsigned i, j;
+
+  for (i = 0; i < RDP_LANES; i++)
+    lanes->live[i] = false;
+
+  for (i = 0; i < lanes->count; i++, x++) {
+    unsigned cvg = span->cvg ? span->cvg[x - span->x0] : 8;
+    unsigned dz, mem_dz;
+    uint32_t z;
+
+    *seed = *seed * 1103515245U + 12345U;
+    lanes->seed[i] = *seed;
+
+    // Without antialiasing, a pixel is either in or out.
+    if (!modes->antialias_en)
+      cvg = cvg >= 4 ? 8 : 0;
+
+    if (cvg == 0)
+      goto next;
+
+    // Depth is resolved first so that hidden pixels can bail early.
+    if (span->zbuffer && !modes->z_source_sel) {
+      int32_t value = attr[RDP_ATTR_Z] >> 13;
+
+      z = value < 0 ? 0 : (value > RDP_Z_MAX ? RDP_Z_MAX : value);
+      dz = span->dz;
+    }
+
+    else {
+      z = (uint32_t) state->prim_z << 3;
+      dz = rdp_dz_compress(state->prim_dz);
+    }
+
+    if (modes->z_compare_en) {
+      uint32_t mem_z = rdp_z_read(state, ram, x, span->y, &mem_dz);
+
+      if (!rdp_z_test(state, z, dz, mem_z, mem_dz))
+        goto next;
+    }
+
+    lanes->live[i] = any_live = true;
+    lanes->cvg[i] = cvg;
+    lanes->z[i] = z;
+    lanes->dz[i] = dz;
+
+    inputs->noise[i] = (*seed >> 16 & 0x7) << 6 | 0x20;
+
+    if (span->shade) {
+      inputs->shade.c[0][i] = rdp_span_color(attr[RDP_ATTR_R]);
+      inputs->shade.c[1][i] = rdp_span_color(attr[RDP_ATTR_G]);
+      inputs->shade.c[2][i] = rdp_span_color(attr[RDP_ATTR_B]);
+      inputs->shade.c[3][i] = rdp_span_color(attr[RDP_ATTR_A]);
+    }
+
+    if (span->texture) {
+      struct rdp_color texel;
+      int32_t s, t;
+
+      rdp_span_texcoord(span, attr, &s, &t);
+      rdp_texture_sample(state, span->tile, s, t, &texel);
+      rdp_span_store_color(&inputs->texel0, i, &texel);
+
+      if (two_cycle)
+        rdp_texture_sample(state, span->tile + 1, s, t, &texel);
+
+      rdp_span_store_color(&inputs->texel1, i, &texel);
+    }
+
+next:
+    for (j = 0; j < RDP_NUM_ATTRS; j++)
+      attr[j] += span->step[j];
+  }
+
+  return any_live;
+}
+
+// Applies the alpha compare and coverage modes to the combined pixels,
+// then reads what's underneath the survivors out of the color image.
+bool rdp_span_resolve(const struct rdp_state *state, uint8_t *ram,
+  const struct rdp_span *span, struct rdp_span_lanes *lanes, unsigned x) {
+  const struct rdp_other_modes *modes = &state->other_modes;
+  struct rdp_blender_inputs *blend = &lanes->blend;
+  bool any_live = false;
+  unsigned i;
+
+  for (i = 0; i < lanes->count; i++, x++) {
+    struct rdp_color memory;
+    unsigned cvg, mem_cvg;
+    int32_t alpha;
+
+    if (!lanes->live[i])
+      continue;
+
+    cvg = lanes->cvg[i];
+    alpha = blend->pixel.c[3][i];
+
+    if (modes->alpha_compare_en) {
+      int32_t threshold = modes->dither_alpha_en
+        ? (int32_t) (lanes->seed[i] >> 8 & 0xFF) : state->blend_color.a;
+
+      if (alpha < threshold) {
+        lanes->live[i] = false;
+        continue;
+      }
+    }
+
+    if (modes->cvg_times_alpha)
+      cvg = (cvg * alpha + 0x80) >> 8;
+
+    if (modes->alpha_cvg_select)
+      blend->pixel.c[3][i] = cvg >= 8 ? 0xFF : cvg << 5;
+
+    if (cvg == 0) {
+      lanes->live[i] = false;
+      continue;
+    }
+
+    if (modes->image_read_en)
+      rdp_fb_read(state, ram, x, span->y, &memory, &mem_cvg);
+
+    else {
+      memset(&memory, 0, sizeof(memory));
+      mem_cvg = 7;
+    }
+
+    // Coverage overflows when the pixel lands on an already-covered one;
+    // that's where antialiased edges get blended against memory.
+    lanes->overflow[i] = ((cvg + mem_cvg) & 0x8) != 0;
+    blend->enable[i] = modes->force_blend ||
+      (modes->antialias_en && lanes->overflow[i]) ? -1 : 0;
+
+    rdp_span_store_color(&blend->memory, i, &memory);
+    blend->shade_alpha[i] = lanes->combine.shade.c[3][i];
+    blend->memory_cvg[i] = mem_cvg;
+    lanes->cvg[i] = cvg;
+    any_live = true;
+  }
+
+  return any_live;
+}
+
+// Writes the blended pixels and their depths back to memory.
+void rdp_span_write(const struct rdp_state *state, uint8_t *ram,
+  const struct rdp_span *span, struct rdp_span_lanes *lanes, unsigned x) {
+  const struct rdp_other_modes *modes = &state->other_modes;
+  const struct rdp_blender_inputs *blend = &lanes->blend;
+  unsigned i;
+
+  for (i = 0; i < lanes->count; i++, x++) {
+    unsigned cvg, mem_cvg, final_cvg;
+    struct rdp_color pixel;
+    bool blend_en;
+
+    if (!lanes->live[i])
+      continue;
+
+    cvg = lanes->cvg[i];
+    mem_cvg = blend->memory_cvg[i];
+    blend_en = blend->enable[i] != 0;
+
+    switch (modes->cvg_dest) {
+      case RDP_CVG_DEST_CLAMP:
+        final_cvg = blend_en ? cvg + mem_cvg : cvg - 1;
+        final_cvg = (final_cvg & 0x8) ? 7 : final_cvg & 0x7;
+        break;
+
+      case RDP_CVG_DEST_WRAP:
+        final_cvg = (cvg + mem_cvg) & 0x7;
+        break;
+
+      case RDP_CVG_DEST_FULL:
+        final_cvg = 7;
+        break;
+
+      default:
+        final_cvg = mem_cvg;
+        break;
+    }
+
+    pixel.r = lanes->pixel.c[0][i];
+    pixel.g = lanes->pixel.c[1][i];
+    pixel.b = lanes->pixel.c[2][i];
+    pixel.a = lanes->pixel.c[3][i];
+
+    rdp_fb_write(state, ram, x, span->y, &pixel, final_cvg,
+      !modes->color_on_cvg || lanes->overflow[i]);
+
+    if (modes->z_update_en)
+      rdp_z_write(state, ram, x, span->y, lanes->z[i], lanes->dz[i]);
+  }
+}
+
+// Renders a span in one- or two-cycle mode. Pixels are gathered in
+// groups of RDP_LANES so that the combiner and blender can run on all
+// of them at once; pixels within a span never overlap in memory, so
+// reading a whole group before writing any of it is safe.
+void rdp_render_span(const struct rdp_state *state,
+  uint8_t *ram, const struct rdp_span *span) {
+  bool two_cycle = state->other_modes.cycle_type == RDP_CYCLE_TYPE_2CYCLE;
+  uint32_t seed = span->y * 0x9E3779B1U ^ span->x0;
+  struct rdp_span_lanes lanes;
+  struct rdp_combiner combiner;
+  struct rdp_blender blender;
+  int32_t attr[RDP_NUM_ATTRS];
+  unsigned x;
+
+  memcpy(attr, span->attr, sizeof(attr));
+  memset(&lanes, 0, sizeof(lanes));
+
+  rdp_combiner_setup(&combiner, state, &lanes.combine);
+  rdp_blender_setup(&blender, state, &lanes.blend);
+
+  for (x = span->x0; x < span->x1; x += lanes.count) {
+    lanes.count = span->x1 - x < RDP_LANES ? span->x1 - x : RDP_LANES;
+
+    if (!rdp_span_gather(state, ram, span, &lanes, x, attr, &seed))
+      continue;
+
+    // One-cycle mode runs on the second cycle's combiner settings.
+    if (two_cycle) {
+      memset(&lanes.combine.combined, 0, sizeof(lanes.combine.combined));
+      rdp_combine(&combiner, 0, &lanes.combine.combined);
+    }
+
+    rdp_combine(&combiner, 1, &lanes.blend.pixel);
+
+    if (!rdp_span_resolve(state, ram, span, &lanes, x))
+      continue;
+
+    if (two_cycle)
+      rdp_blend(&blender, 0, &lanes.blend, blender.always, &lanes.blend.pixel);
+
+    rdp_blend(&blender, two_cycle, &lanes.blend,
+      lanes.blend.enable, &lanes.pixel);
+
+    rdp_span_write(state, ram, span, &lanes, x);
+  }
+}
+
+// Renders a span in fill mode. The fill color repeats every four bytes
+// along a row, so it's stored sixteen bytes at a time where possible.
+void rdp_fill_span(const struct rdp_state *state,
+  uint8_t *ram, const struct rdp_span *span) {
+  const struct rdp_image *image = &state->color_image;
+  unsigned x, bytes, phase, i;
+  uint8_t pattern[16];
+  uint32_t address;
+
+  bytes = (span->x1 - span->x0) << image->size >> 1;
+  phase = span->x0 << image->size >> 1;
+  address = image->address +
+    ((span->y * image->width) << image->size >> 1) + phase;
+
+  // Narrow or misaligned images (and rows that wrap around RDRAM) are
+  // filled a pixel at a time.
+  if (image->size == RDP_SIZE_4BPP ||
+    (image->address & ((1 << image->size >> 1) - 1)) ||
+    (address & RDP_RAM_MASK) + bytes > RDP_RAM_MASK + 1) {
+    for (x = span->x0; x < span->x1; x++)
+      rdp_fb_fill(state, ram, x, span->y);
+
+    return;
+  }
+
+  for (i = 0; i < sizeof(pattern); i++)
+    pattern[i] = state->fill_color >> ((~(phase + i) & 0x3) << 3);
+
+  for (i = 0; i + sizeof(pattern) <= bytes; i += sizeof(pattern))
+    memcpy(ram + (address & RDP_RAM_MASK) + i, pattern, sizeof(pattern));
+
+  memcpy(ram + (address & RDP_RAM_MASK) + i, pattern, bytes - i);
+}
+
+// Renders a span in copy mode: texels go straight to memory.
+void rdp_copy_span(const struct rdp_state *state,
+  uint8_t *ram, const struct rdp_span *span) {
+  const struct rdp_image *image = &state->color_image;
+  int32_t s = span->attr[RDP_ATTR_S];
+  int32_t t = span->attr[RDP_ATTR_T];
+  unsigned x;
+
+  // Unscaled rows of 16-bit texels can be copied straight over.
+  if (span->step[RDP_ATTR_S] == 1 << 21 && span->step[RDP_ATTR_T] == 0 &&
+    image->size == RDP_SIZE_16BPP && rdp_copy_row(state, ram, span))
+    return;
+
+  for (x = span->x0; x < span->x1; x++) {
+    uint32_t texel = rdp_texture_fetch_raw(state, span->tile, s >> 16, t >> 16);
+    uint32_t offset = span->y * image->width + x;
+
+    switch (image->size) {
+      case RDP_SIZE_16BPP:
+        if (!state->other_modes.alpha_compare_en || (texel & 0x1))
+          rdp_ram_write16(ram, image->address + offset * 2, texel);
+
+        break;
+
+      case RDP_SIZE_32BPP:
+        rdp_ram_write32(ram, image->address + offset * 4, texel);
+        break;
+
+      default:
+        ram[(image->address + offset) & RDP_RAM_MASK] = texel;
+        break;
+    }
+
+    s += span->step[RDP_ATTR_S];
+    t += span->step[RDP_ATTR_T];
+  }
+}
+
@@ -0,0 +1,55 @@
+//
+// rdp/span.h: RDP span rendering.
+//
+// CEN64: Cycle-Accurate Nintendo 64 Simulator.
+// Copyright (C) 2014, Tyler J. Stachecki.
+//
+// This file is subject to the terms and conditions defined in
+// 'LICENSE', which is part of this source code package.
+//
+
+#ifndef __rdp_span_h__
+#define __rdp_span_h__
+#include "common.h"
+#include "rdp/state.h"
+
+enum rdp_attribute {
+  RDP_ATTR_R,
+  RDP_ATTR_G,
+  RDP_ATTR_B,
+  RDP_ATTR_A,
+  RDP_ATTR_S,
+  RDP_ATTR_T,
+  RDP_ATTR_W,
+  RDP_ATTR_Z,
+  RDP_NUM_ATTRS
+};
+
+// A horizontal run of pixels on one scanline. Attributes are s15.16
+// values at the first pixel, along with their per-pixel steps.
+struct rdp_span {
+  int32_t attr[RDP_NUM_ATTRS];
+  int32_t step[RDP_NUM_ATTRS];
+
+  // Per-pixel coverage (0-8), indexed from x0; NULL if fully covered.
+  const uint8_t *cvg;
+
+  unsigned y, x0, x1;
+  unsigned tile;
+  unsigned dz;
+
+  bool shade;
+  bool texture;
+  bool zbuffer;
+  bool persp;
+};
+
+void rdp_render_span(const struct rdp_state *state,
+  uint8_t *ram, const struct rdp_span *span);
+void rdp_fill_span(const struct rdp_state *state,
+  uint8_t *ram, const struct rdp_span *span);
+void rdp_copy_span(const struct rdp_state *state,
+  uint8_t *ram, const struct rdp_span *span);
+
+#endif
+
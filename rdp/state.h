@@ -0,0 +1,223 @@
+//
+// rdp/state.h: RDP rendering state.
+//
+// CEN64: Cycle-Accurate Nintendo 64 Simulator.
+// Copyright (C) 2014, Tyler J. Stachecki.
+//
+// This file is subject to the terms and conditions defined in
+// 'LICENSE', which is part of this source code package.
+//
+
+#ifndef __rdp_state_h__
+#define __rdp_state_h__
+#include "common.h"
+
+#define RDP_TMEM_SIZE 0x1000
+
+struct rdp_texcache;
+
+// Scanlines are dealt out to renderers in bands of this many rows.
+#define RDP_BAND_ROWS 8
+
+enum rdp_cycle_type {
+  RDP_CYCLE_TYPE_1CYCLE,
+  RDP_CYCLE_TYPE_2CYCLE,
+  RDP_CYCLE_TYPE_COPY,
+  RDP_CYCLE_TYPE_FILL
+};
+
+// Work done by a renderer, kept for the DP counters and for stats.
+// Renderers drawing bands other than the first skip anything that
+// every renderer repeats (primitive setup and TMEM loads).
+struct rdp_counters {
+  uint64_t primitives;
+  uint64_t pixels[4]; // By cycle type.
+  uint64_t texels;
+  uint64_t tmem_words;
+  uint64_t texcache_hits;
+  uint64_t texcache_misses;
+
+  // Host time spent running commands (only tracked for band 0).
+  uint64_t host_ns;
+};
+
+enum rdp_format {
+  RDP_FORMAT_RGBA,
+  RDP_FORMAT_YUV,
+  RDP_FORMAT_CI,
+  RDP_FORMAT_IA,
+  RDP_FORMAT_I
+};
+
+enum rdp_size {
+  RDP_SIZE_4BPP,
+  RDP_SIZE_8BPP,
+  RDP_SIZE_16BPP,
+  RDP_SIZE_32BPP
+};
+
+enum rdp_z_mode {
+  RDP_Z_MODE_OPAQUE,
+  RDP_Z_MODE_INTERPENETRATING,
+  RDP_Z_MODE_TRANSPARENT,
+  RDP_Z_MODE_DECAL
+};
+
+enum rdp_cvg_dest {
+  RDP_CVG_DEST_CLAMP,
+  RDP_CVG_DEST_WRAP,
+  RDP_CVG_DEST_FULL,
+  RDP_CVG_DEST_SAVE
+};
+
+// Colors are carried as signed values so that the combiner's
+// intermediate results can go out of range before being clamped.
+struct rdp_color {
+  int32_t r, g, b, a;
+};
+
+// The combiner and blender work on this many pixels at a time.
+#define RDP_LANES 8
+
+// One color per pixel of a group, stored a channel (r, g, b, a) at a
+// time so that each channel fills a vector of 16-bit lanes.
+struct rdp_color_lanes {
+  cen64_align(int16_t c[4][RDP_LANES], 16);
+};
+
+struct rdp_other_modes {
+  enum rdp_cycle_type cycle_type;
+  bool persp_tex_en;
+  bool tex_lod_en;
+  bool en_tlut;
+  bool tlut_type;
+  bool sample_type;
+  bool key_en;
+
+  // Blender selectors, one set per cycle.
+  unsigned blend_m1a[2];
+  unsigned blend_m1b[2];
+  unsigned blend_m2a[2];
+  unsigned blend_m2b[2];
+
+  bool force_blend;
+  bool alpha_cvg_select;
+  bool cvg_times_alpha;
+  enum rdp_z_mode z_mode;
+  enum rdp_cvg_dest cvg_dest;
+  bool color_on_cvg;
+  bool image_read_en;
+  bool z_update_en;
+  bool z_compare_en;
+  bool antialias_en;
+  bool z_source_sel;
+  bool dither_alpha_en;
+  bool alpha_compare_en;
+};
+
+// Combiner selectors, one set per cycle.
+struct rdp_combine {
+  unsigned rgb_sub_a[2];
+  unsigned rgb_sub_b[2];
+  unsigned rgb_mul[2];
+  unsigned rgb_add[2];
+
+  unsigned alpha_sub_a[2];
+  unsigned alpha_sub_b[2];
+  unsigned alpha_mul[2];
+  unsigned alpha_add[2];
+};
+
+struct rdp_tile {
+  enum rdp_format format;
+  enum rdp_size size;
+  unsigned line;
+  unsigned tmem;
+  unsigned palette;
+
+  bool clamp_s, mirror_s;
+  unsigned mask_s, shift_s;
+  bool clamp_t, mirror_t;
+  unsigned mask_t, shift_t;
+
+  // Tile bounds, in 10.2 fixed point.
+  unsigned sl, tl, sh, th;
+};
+
+struct rdp_image {
+  uint32_t address;
+  enum rdp_format format;
+  enum rdp_size size;
+  unsigned width;
+};
+
+// Scissor bounds, in 10.2 fixed point.
+struct rdp_scissor {
+  unsigned xh, yh;
+  unsigned xl, yl;
+};
+
+struct rdp_state {
+  struct rdp_other_modes other_modes;
+  struct rdp_combine combine;
+  struct rdp_tile tiles[8];
+
+  struct rdp_image color_image;
+  struct rdp_image texture_image;
+  uint32_t z_image;
+
+  struct rdp_scissor scissor;
+
+  uint32_t fill_color;
+  struct rdp_color fog_color;
+  struct rdp_color blend_color;
+  struct rdp_color prim_color;
+  struct rdp_color env_color;
+  unsigned prim_lod_frac;
+
+  uint16_t prim_z;
+  uint16_t prim_dz;
+
+  int32_t key_center[3];
+  int32_t key_scale[3];
+  int32_t convert[6];
+
+  cen64_align(uint8_t tmem[RDP_TMEM_SIZE], 16);
+
+  // Decoded texels; each renderer has a cache of its own (or none).
+  struct rdp_texcache *texcache;
+
+  // A renderer only draws the bands where (row / RDP_BAND_ROWS) %
+  // band_count == band_index; there's just one band when unthreaded.
+  unsigned band_index;
+  unsigned band_count;
+
+  // Where this renderer's work gets tallied.
+  struct rdp_counters *counters;
+};
+
+static inline void rdp_counters_add(struct rdp_counters *dest,
+  const struct rdp_counters *src) {
+  unsigned i;
+
+  dest->primitives += src->primitives;
+
+  for (i = 0; i < 4; i++)
+    dest->pixels[i] += src->pixels[i];
+
+  dest->texels += src->texels;
+  dest->tmem_words += src->tmem_words;
+  dest->texcache_hits += src->texcache_hits;
+  dest->texcache_misses += src->texcache_misses;
+  dest->host_ns += src->host_ns;
+}
+
+// Returns true if the renderer owning this state draws the scanline.
+static inline bool rdp_state_owns_row(const struct rdp_state *state,
+  unsigned y) {
+  return state->band_count <= 1 ||
+    (y / RDP_BAND_ROWS) % state->band_count == state->band_index;
+}
+
+#endif
+
@@ -0,0 +1,204 @@
+//
+// rdp/texcache.c: RDP decoded texture cache.
+//
+// CEN64: Cycle-Accurate Nintendo 64 Simulator.
+// Copyright (C) 2014, Tyler J. Stachecki.
+//
+// This file is subject to the terms and conditions defined in
+// 'LICENSE', which is part of this source code package.
+//
+
+#include "common.h"
+#include "rdp/state.h"
+#include "rdp/texcache.h"
+#include "rdp/texture.h"
+
+static uint64_t rdp_texcache_hash(const struct rdp_state *state,
+  const struct rdp_texcache_key *key);
+static uint64_t rdp_texcache_hash_range(uint64_t hash, const uint8_t *tmem,
+  unsigned start, unsigned length, unsigned mask);
+static bool rdp_texcache_key_equal(const struct rdp_texcache_key *a,
+  const struct rdp_texcache_key *b);
+static bool rdp_texcache_make_key(const struct rdp_state *state,
+  const struct rdp_tile *tile, struct rdp_texcache_key *key);
+
+// Allocates an empty cache.
+struct rdp_texcache *rdp_texcache_create(void) {
+  return (struct rdp_texcache *) calloc(1, sizeof(struct rdp_texcache));
+}
+
+// Releases a cache.
+void rdp_texcache_destroy(struct rdp_texcache *cache) {
+  free(cache);
+}
+
+// Hashes the parts of TMEM that a tile's texels are decoded from:
+// its rows (and their upper halves, for 32-bit texels) and palette.
+uint64_t rdp_texcache_hash(const struct rdp_state *state,
+  const struct rdp_texcache_key *key) {
+  unsigned row_bytes, length, start = key->tmem * 8;
+  uint64_t hash = 0xCBF29CE484222325ULL;
+
+  row_bytes = ((key->width << key->size) + 1) >> 1;
+  length = (key->height - 1) * key->line * 8 + row_bytes;
+
+  if (key->size == RDP_SIZE_32BPP) {
+    hash = rdp_texcache_hash_range(hash, state->tmem,
+      start, length, RDP_TMEM_SIZE / 2 - 1);
+    hash = rdp_texcache_hash_range(hash, state->tmem + RDP_TMEM_SIZE / 2,
+      start, length, RDP_TMEM_SIZE / 2 - 1);
+  }
+
+  else
+    hash = rdp_texcache_hash_range(hash, state->tmem,
+      start, length, RDP_TMEM_SIZE - 1);
+
+  if (key->en_tlut && key->size == RDP_SIZE_4BPP)
+    hash = rdp_texcache_hash_range(hash, state->tmem,
+      0x800 + (key->palette << 7), 16 * 8, RDP_TMEM_SIZE - 1);
+
+  else if (key->en_tlut && key->size == RDP_SIZE_8BPP)
+    hash = rdp_texcache_hash_range(hash, state->tmem,
+      0x800, 256 * 8, RDP_TMEM_SIZE - 1);
+
+  return hash;
+}
+
+// Folds a range of TMEM into a hash a word at a time. Ranges start on
+// a word boundary and wrap around at mask, just like texel fetches.
+uint64_t rdp_texcache_hash_range(uint64_t hash, const uint8_t *tmem,
+  unsigned start, unsigned length, unsigned mask) {
+  unsigned i, words = (length + 7) >> 3;
+
+  if (words > (mask + 1) >> 3)
+    words = (mask + 1) >> 3;
+
+  for (i = 0; i < words; i++) {
+    uint64_t word;
+
+    memcpy(&word, tmem + ((start + i * 8) & mask), sizeof(word));
+    hash = (hash ^ word) * 0x100000001B3ULL;
+    hash ^= hash >> 29;
+  }
+
+  return hash;
+}
+
+bool rdp_texcache_key_equal(const struct rdp_texcache_key *a,
+  const struct rdp_texcache_key *b) {
+  return a->tmem == b->tmem && a->line == b->line &&
+    a->format == b->format && a->size == b->size &&
+    a->palette == b->palette && a->en_tlut == b->en_tlut &&
+    a->tlut_type == b->tlut_type &&
+    a->width == b->width && a->height == b->height;
+}
+
+// Describes how a tile decodes. Returns false if its texel indices
+// can't be bounded tightly enough to be worth caching.
+bool rdp_texcache_make_key(const struct rdp_state *state,
+  const struct rdp_tile *tile, struct rdp_texcache_key *key) {
+  int32_t max_s = (int32_t) (tile->sh >> 2) - (int32_t) (tile->sl >> 2);
+  int32_t max_t = (int32_t) (tile->th >> 2) - (int32_t) (tile->tl >> 2);
+
+  // Masked indices wrap within the mask; unmasked ones are clamped.
+  if (tile->mask_s)
+    key->width = 1U << (tile->mask_s > 10 ? 10 : tile->mask_s);
+  else if (max_s >= 0)
+    key->width = max_s + 1;
+  else
+    return false;
+
+  if (tile->mask_t)
+    key->height = 1U << (tile->mask_t > 10 ? 10 : tile->mask_t);
+  else if (max_t >= 0)
+    key->height = max_t + 1;
+  else
+    return false;
+
+  if (key->width * key->height > RDP_TEXCACHE_TEXELS)
+    return false;
+
+  key->tmem = tile->tmem;
+  key->line = tile->line;
+  key->format = tile->format;
+  key->size = tile->size;
+
+  // The palette settings only matter to texels that index into one.
+  key->en_tlut = state->other_modes.en_tlut &&
+    tile->size <= RDP_SIZE_8BPP;
+  key->tlut_type = key->en_tlut && state->other_modes.tlut_type;
+  key->palette = key->en_tlut && tile->size == RDP_SIZE_4BPP
+    ? tile->palette : 0;
+
+  return true;
+}
+
+// Finds (or decodes) the texels for a tile ahead of a draw.
+void rdp_texcache_bind(struct rdp_state *state, unsigned tile) {
+  struct rdp_texcache *cache = state->texcache;
+  const struct rdp_tile *desc = state->tiles + (tile & 0x7);
+  struct rdp_texcache_entry *entry;
+  struct rdp_texcache_key key;
+  bool hashed = false;
+  uint64_t hash = 0;
+  unsigned i, s, t;
+
+  if (cache == NULL)
+    return;
+
+  cache->bound[tile & 0x7] = NULL;
+
+  if (!rdp_texcache_make_key(state, desc, &key))
+    return;
+
+  // TMEM gets reloaded all the time, often with what was already there,
+  // so entries from older generations are checked against their hash.
+  for (i = 0; i < RDP_TEXCACHE_ENTRIES; i++) {
+    entry = cache->entries + i;
+
+    if (!entry->valid || !rdp_texcache_key_equal(&entry->key, &key))
+      continue;
+
+    if (entry->generation != cache->generation) {
+      if (!hashed) {
+        hash = rdp_texcache_hash(state, &key);
+        hashed = true;
+      }
+
+      if (entry->hash != hash)
+        continue;
+
+      entry->generation = cache->generation;
+    }
+
+    cache->bound[tile & 0x7] = entry;
+    state->counters->texcache_hits++;
+    return;
+  }
+
+  state->counters->texcache_misses++;
+
+  if (!hashed)
+    hash = rdp_texcache_hash(state, &key);
+
+  entry = cache->entries + cache->next_victim;
+  cache->next_victim = (cache->next_victim + 1) % RDP_TEXCACHE_ENTRIES;
+
+  for (t = 0; t < key.height; t++) {
+    for (s = 0; s < key.width; s++) {
+      struct rdp_color texel;
+
+      rdp_texel_fetch(state, desc, s, t, &texel);
+      entry->texels[t * key.width + s] = (uint32_t) texel.r << 24 |
+        texel.g << 16 | texel.b << 8 | texel.a;
+    }
+  }
+
+  entry->key = key;
+  entry->hash = hash;
+  entry->generation = cache->generation;
+  entry->valid = true;
+
+  cache->bound[tile & 0x7] = entry;
+}
+
@@ -0,0 +1,70 @@
+//
+// rdp/texcache.h: RDP decoded texture cache.
+//
+// CEN64: Cycle-Accurate Nintendo 64 Simulator.
+// Copyright (C) 2014, Tyler J. Stachecki.
+//
+// This file is subject to the terms and conditions defined in
+// 'LICENSE', which is part of this source code package.
+//
+
+#ifndef __rdp_texcache_h__
+#define __rdp_texcache_h__
+#include "common.h"
+
+#define RDP_TEXCACHE_ENTRIES 16
+#define RDP_TEXCACHE_TEXELS 0x2000
+
+struct rdp_state;
+
+// Everything that decides how a tile's texels decode.
+struct rdp_texcache_key {
+  unsigned tmem, line;
+  unsigned format, size;
+  unsigned palette;
+  bool en_tlut, tlut_type;
+
+  // Extent of the texel indices the tile can wrap or clamp to.
+  unsigned width, height;
+};
+
+// A tile's texels, decoded to RGBA8888 (red in the high byte).
+struct rdp_texcache_entry {
+  struct rdp_texcache_key key;
+  uint64_t hash;
+  unsigned generation;
+  bool valid;
+
+  uint32_t texels[RDP_TEXCACHE_TEXELS];
+};
+
+struct rdp_texcache {
+  struct rdp_texcache_entry entries[RDP_TEXCACHE_ENTRIES];
+  const struct rdp_texcache_entry *bound[8];
+  unsigned next_victim;
+
+  // Bumped whenever TMEM is written; entries from an older generation
+  // have to have their TMEM contents hashed again before they're used.
+  unsigned generation;
+};
+
+cen64_cold struct rdp_texcache *rdp_texcache_create(void);
+cen64_cold void rdp_texcache_destroy(struct rdp_texcache *cache);
+
+// Finds (or decodes) the texels for a tile ahead of a draw.
+void rdp_texcache_bind(struct rdp_state *state, unsigned tile);
+
+// Notes that TMEM has been written by one of the load commands.
+static inline void rdp_texcache_invalidate(struct rdp_texcache *cache) {
+  if (cache != NULL)
+    cache->generation++;
+}
+
+// Returns the texels bound to a tile, or NULL if it isn't cached.
+static inline const struct rdp_texcache_entry *rdp_texcache_lookup(
+  const struct rdp_texcache *cache, unsigned tile) {
+  return cache != NULL ? cache->bound[tile & 0x7] : NULL;
+}
+
+#endif
+
@@ -0,0 +1,524 @@
+//
+// rdp/texture.c: RDP texture memory loads and sampling.
+//
+// CEN64: Cycle-Accurate Nintendo 64 Simulator.
+// Copyright (C) 2014, Tyler J. Stachecki.
+//
+// This file is subject to the terms and conditions defined in
+// 'LICENSE', which is part of this source code package.
+//
+
+#include "common.h"
+#include "rdp/framebuffer.h"
+#include "rdp/state.h"
+#include "rdp/texcache.h"
+#include "rdp/texture.h"
+
+static void rdp_decode_ia16(uint16_t word, struct rdp_color *texel);
+static void rdp_decode_rgba16(uint16_t word, struct rdp_color *texel);
+static void rdp_texel_lookup(const struct rdp_state *state,
+  const struct rdp_tile *tile, const struct rdp_texcache_entry *entry,
+  unsigned s, unsigned t, struct rdp_color *texel);
+static int32_t rdp_tile_adjust(int32_t coord, unsigned shift, unsigned base);
+static unsigned rdp_tile_wrap(int32_t texel, bool clamp, int32_t max,
+  unsigned mask, bool mirror);
+static uint16_t rdp_tlut_read(const struct rdp_state *state, unsigned index);
+
+static void rdp_decode_ia16(uint16_t word, struct rdp_color *texel) {
+  texel->r = texel->g = texel->b = word >> 8;
+  texel->a = word & 0xFF;
+}
+
+static void rdp_decode_rgba16(uint16_t word, struct rdp_color *texel) {
+  texel->r = (word >> 8 & 0xF8) | (word >> 13 & 0x7);
+  texel->g = (word >> 3 & 0xF8) | (word >> 8 & 0x7);
+  texel->b = (word << 2 & 0xF8) | (word >> 3 & 0x7);
+  texel->a = (word & 0x1) ? 0xFF : 0x00;
+}
+
+// Looks up a palette entry. Entries live in the upper half of TMEM and
+// are stored four times over, so only the first copy needs reading.
+uint16_t rdp_tlut_read(const struct rdp_state *state, unsigned index) {
+  unsigned address = (0x800 + (index << 3)) & (RDP_TMEM_SIZE - 1);
+
+  return state->tmem[address] << 8 | state->tmem[address + 1];
+}
+
+// Reads a texel out of TMEM and expands it to 8 bits per channel.
+// Odd rows have their 32-bit words swapped around by the loaders.
+void rdp_texel_fetch(const struct rdp_state *state,
+  const struct rdp_tile *tile, unsigned s, unsigned t,
+  struct rdp_color *texel) {
+  const struct rdp_other_modes *other_modes = &state->other_modes;
+  const uint8_t *tmem = state->tmem;
+  unsigned base = tile->tmem * 8 + t * tile->line * 8;
+  unsigned swap = (t & 0x1) << 2;
+  unsigned address;
+
+  switch (tile->size) {
+    case RDP_SIZE_4BPP: {
+      unsigned nibble;
+
+      address = ((base + (s >> 1)) ^ swap) & (RDP_TMEM_SIZE - 1);
+      nibble = (s & 0x1) ? tmem[address] & 0xF : tmem[address] >> 4;
+
+      if (other_modes->en_tlut) {
+        uint16_t entry = rdp_tlut_read(state, tile->palette << 4 | nibble);
+
+        if (other_modes->tlut_type)
+          rdp_decode_ia16(entry, texel);
+        else
+          rdp_decode_rgba16(entry, texel);
+      }
+
+      else if (tile->format == RDP_FORMAT_IA) {
+        unsigned intensity = nibble >> 1;
+
+        texel->r = texel->g = texel->b =
+          intensity << 5 | intensity << 2 | intensity >> 1;
+        texel->a = (nibble & 0x1) ? 0xFF : 0x00;
+      }
+
+      else
+        texel->r = texel->g = texel->b = texel->a = nibble * 0x11;
+
+      break;
+    }
+
+    case RDP_SIZE_8BPP: {
+      uint8_t byte;
+
+      address = ((base + s) ^ swap) & (RDP_TMEM_SIZE - 1);
+      byte = tmem[address];
+
+      if (other_modes->en_tlut) {
+        uint16_t entry = rdp_tlut_read(state, byte);
+
+        if (other_modes->tlut_type)
+          rdp_decode_ia16(entry, texel);
+        else
+          rdp_decode_rgba16(entry, texel);
+      }
+
+      else if (tile->format == RDP_FORMAT_IA) {
+        texel->r = texel->g = texel->b = (byte >> 4) * 0x11;
+        texel->a = (byte & 0xF) * 0x11;
+      }
+
+      else
+        texel->r = texel->g = texel->b = texel->a = byte;
+
+      break;
+    }
+
+    case RDP_SIZE_16BPP: {
+      uint16_t word;
+
+      address = ((base + s * 2) ^ swap) & (RDP_TMEM_SIZE - 1);
+      word = tmem[address] << 8 | tmem[address + 1];
+
+      if (tile->format == RDP_FORMAT_IA)
+        rdp_decode_ia16(word, texel);
+      else
+        rdp_decode_rgba16(word, texel);
+
+      break;
+    }
+
+    // 32-bit texels are split: red/green below, blue/alpha above.
+    case RDP_SIZE_32BPP:
+      address = ((base + s * 2) ^ swap) & (RDP_TMEM_SIZE / 2 - 1);
+
+      texel->r = tmem[address];
+      texel->g = tmem[address + 1];
+      texel->b = tmem[address + RDP_TMEM_SIZE / 2];
+      texel->a = tmem[address + RDP_TMEM_SIZE / 2 + 1];
+      break;
+  }
+}
+
+// Reads a texel from the tile's cached texels, if it has any, or else
+// decodes it straight out of TMEM.
+void rdp_texel_lookup(const struct rdp_state *state,
+  const struct rdp_tile *tile, const struct rdp_texcache_entry *entry,
+  unsigned s, unsigned t, struct rdp_color *texel) {
+  uint32_t value;
+
+  if (entry == NULL) {
+    rdp_texel_fetch(state, tile, s, t, texel);
+    return;
+  }
+
+  value = entry->texels[t * entry->key.width + s];
+  texel->r = value >> 24;
+  texel->g = value >> 16 & 0xFF;
+  texel->b = value >> 8 & 0xFF;
+  texel->a = value & 0xFF;
+}
+
+// Applies a tile's shift and offset to a s10.5 coordinate.
+int32_t rdp_tile_adjust(int32_t coord, unsigned shift, unsigned base) {
+  if (shift < 11)
+    coord >>= shift;
+  else
+    coord = (int32_t) ((uint32_t) coord << (16 - shift));
+
+  return coord - (int32_t) (base << 3);
+}
+
+// Resolves a texel index along one axis: it's clamped to the tile's
+// bounds first, and then wrapped or mirrored within the tile's mask.
+unsigned rdp_tile_wrap(int32_t texel, bool clamp, int32_t max,
+  unsigned mask, bool mirror) {
+  if (clamp) {
+    if (texel < 0)
+      texel = 0;
+    else if (texel > max)
+      texel = max;
+  }
+
+  if (mask) {
+    if (mask > 10)
+      mask = 10;
+
+    if (mirror && (texel >> mask & 0x1))
+      texel = ~texel;
+
+    texel &= (1 << mask) - 1;
+  }
+
+  return texel & 0x3FF;
+}
+
+// Samples a tile, with three-point filtering if it's been enabled.
+void rdp_texture_sample(const struct rdp_state *state, unsigned tile,
+  int32_t s, int32_t t, struct rdp_color *texel) {
+  const struct rdp_tile *desc = state->tiles + (tile & 0x7);
+  const struct rdp_texcache_entry *entry;
+  bool clamp_s = desc->clamp_s || !desc->mask_s;
+  bool clamp_t = desc->clamp_t || !desc->mask_t;
+  int32_t max_s = (int32_t) (desc->sh >> 2) - (int32_t) (desc->sl >> 2);
+  int32_t max_t = (int32_t) (desc->th >> 2) - (int32_t) (desc->tl >> 2);
+  struct rdp_color t0, t1, t2;
+  int32_t si, ti, sf, tf;
+  unsigned s0, s1, t0i, t1i;
+
+  s = rdp_tile_adjust(s, desc->shift_s, desc->sl);
+  t = rdp_tile_adjust(t, desc->shift_t, desc->tl);
+  si = s >> 5;
+  ti = t >> 5;
+  sf = s & 0x1F;
+  tf = t & 0x1F;
+
+  // Texels pinned to the edge of the tile have nothing to blend with.
+  if (clamp_s && (si < 0 || si >= max_s))
+    sf = 0;
+
+  if (clamp_t && (ti < 0 || ti >= max_t))
+    tf = 0;
+
+  entry = rdp_texcache_lookup(state->texcache, tile);
+  s0 = rdp_tile_wrap(si, clamp_s, max_s, desc->mask_s, desc->mirror_s);
+  t0i = rdp_tile_wrap(ti, clamp_t, max_t, desc->mask_t, desc->mirror_t);
+
+  if (!state->other_modes.sample_type || (sf | tf) == 0) {
+    rdp_texel_lookup(state, desc, entry, s0, t0i, texel);
+    return;
+  }
+
+  s1 = rdp_tile_wrap(si + 1, clamp_s, max_s, desc->mask_s, desc->mirror_s);
+  t1i = rdp_tile_wrap(ti + 1, clamp_t, max_t, desc->mask_t, desc->mirror_t);
+
+  // The RDP only ever blends the three texels nearest the sample.
+  if (sf + tf >= 0x20) {
+    int32_t inv_sf = 0x20 - sf, inv_tf = 0x20 - tf;
+
+    rdp_texel_lookup(state, desc, entry, s1, t1i, &t0);
+    rdp_texel_lookup(state, desc, entry, s0, t1i, &t1);
+    rdp_texel_lookup(state, desc, entry, s1, t0i, &t2);
+
+    texel->r = t0.r + (((t1.r - t0.r) * inv_sf + (t2.r - t0.r) * inv_tf + 0x10) >> 5);
+    texel->g = t0.g + (((t1.g - t0.g) * inv_sf + (t2.g - t0.g) * inv_tf + 0x10) >> 5);
+    texel->b = t0.b + (((t1.b - t0.b) * inv_sf + (t2.b - t0.b) * inv_tf + 0x10) >> 5);
+    texel->a = t0.a + (((t1.a - t0.a) * inv_sf + (t2.a - t0.a) * inv_tf + 0x10) >> 5);
+  }
+
+  else {
+    rdp_texel_lookup(state, desc, entry, s0, t0i, &t0);
+    rdp_texel_lookup(state, desc, entry, s1, t0i, &t1);
+    rdp_texel_lookup(state, desc, entry, s0, t1i, &t2);
+
+    texel->r = t0.r + (((t1.r - t0.r) * sf + (t2.r - t0.r) * tf + 0x10) >> 5);
+    texel->g = t0.g + (((t1.g - t0.g) * sf + (t2.g - t0.g) * tf + 0x10) >> 5);
+    texel->b = t0.b + (((t1.b - t0.b) * sf + (t2.b - t0.b) * tf + 0x10) >> 5);
+    texel->a = t0.a + (((t1.a - t0.a) * sf + (t2.a - t0.a) * tf + 0x10) >> 5);
+  }
+}
+
+// Fetches a texel exactly as it sits in TMEM (or the palette), for
+// copy mode. Narrow texels are widened by replication.
+uint32_t rdp_texture_fetch_raw(const struct rdp_state *state,
+  unsigned tile, int32_t s, int32_t t) {
+  const struct rdp_tile *desc = state->tiles + (tile & 0x7);
+  bool clamp_s = desc->clamp_s || !desc->mask_s;
+  bool clamp_t = desc->clamp_t || !desc->mask_t;
+  int32_t max_s = (int32_t) (desc->sh >> 2) - (int32_t) (desc->sl >> 2);
+  int32_t max_t = (int32_t) (desc->th >> 2) - (int32_t) (desc->tl >> 2);
+  const uint8_t *tmem = state->tmem;
+  unsigned si, ti, base, swap, address;
+
+  s = rdp_tile_adjust(s, desc->shift_s, desc->sl);
+  t = rdp_tile_adjust(t, desc->shift_t, desc->tl);
+  si = rdp_tile_wrap(s >> 5, clamp_s, max_s, desc->mask_s, desc->mirror_s);
+  ti = rdp_tile_wrap(t >> 5, clamp_t, max_t, desc->mask_t, desc->mirror_t);
+
+  base = desc->tmem * 8 + ti * desc->line * 8;
+  swap = (ti & 0x1) << 2;
+
+  switch (desc->size) {
+    case RDP_SIZE_4BPP: {
+      unsigned nibble;
+
+      address = ((base + (si >> 1)) ^ swap) & (RDP_TMEM_SIZE - 1);
+      nibble = (si & 0x1) ? tmem[address] & 0xF : tmem[address] >> 4;
+
+      return state->other_modes.en_tlut
+        ? rdp_tlut_read(state, desc->palette << 4 | nibble)
+        : nibble * 0x1111;
+    }
+
+    case RDP_SIZE_8BPP:
+      address = ((base + si) ^ swap) & (RDP_TMEM_SIZE - 1);
+
+      return state->other_modes.en_tlut
+        ? rdp_tlut_read(state, tmem[address])
+        : tmem[address] * 0x0101;
+
+    case RDP_SIZE_16BPP:
+      address = ((base + si * 2) ^ swap) & (RDP_TMEM_SIZE - 1);
+      return tmem[address] << 8 | tmem[address + 1];
+
+    default:
+      address = ((base + si * 2) ^ swap) & (RDP_TMEM_SIZE / 2 - 1);
+
+      return (uint32_t) tmem[address] << 24 | tmem[address + 1] << 16 |
+        tmem[address + RDP_TMEM_SIZE / 2] << 8 |
+        tmem[address + RDP_TMEM_SIZE / 2 + 1];
+  }
+}
+
+// Copies a row of texels, exactly as rdp_texture_fetch_raw would return
+// them, out as big-endian 16-bit words. This is only done when the
+// texels run along one row of 8- or 16-bit texels without clamping or
+// wrapping; returns false (and copies nothing) otherwise.
+bool rdp_texture_copy_row(const struct rdp_state *state, unsigned tile,
+  int32_t s, int32_t t, unsigned count, uint8_t *out) {
+  const struct rdp_tile *desc = state->tiles + (tile & 0x7);
+  bool clamp_t = desc->clamp_t || !desc->mask_t;
+  int32_t max_s = (int32_t) (desc->sh >> 2) - (int32_t) (desc->sl >> 2);
+  int32_t max_t = (int32_t) (desc->th >> 2) - (int32_t) (desc->tl >> 2);
+  const uint8_t *tmem = state->tmem;
+  unsigned base, swap, ti, i;
+  int32_t first, last;
+
+  if (desc->shift_s || count == 0 ||
+    (desc->size != RDP_SIZE_8BPP && desc->size != RDP_SIZE_16BPP))
+    return false;
+
+  first = rdp_tile_adjust(s, 0, desc->sl) >> 5;
+  last = first + (int32_t) count - 1;
+
+  if (first < 0 || last > 0x3FF)
+    return false;
+
+  if ((desc->clamp_s || !desc->mask_s) && last > max_s)
+    return false;
+
+  if (desc->mask_s && last >> (desc->mask_s > 10 ? 10 : desc->mask_s))
+    return false;
+
+  t = rdp_tile_adjust(t, desc->shift_t, desc->tl);
+  ti = rdp_tile_wrap(t >> 5, clamp_t, max_t, desc->mask_t, desc->mirror_t);
+
+  base = desc->tmem * 8 + ti * desc->line * 8 + (first << desc->size >> 1);
+  swap = (ti & 0x1) << 2;
+
+  if (desc->size == RDP_SIZE_16BPP) {
+    // Even rows are laid out in TMEM just as they are in memory.
+    if (!swap && (base & (RDP_TMEM_SIZE - 1)) + count * 2 <= RDP_TMEM_SIZE) {
+      memcpy(out, tmem + (base & (RDP_TMEM_SIZE - 1)), count * 2);
+      return true;
+    }
+
+    for (i = 0; i < count; i++) {
+      unsigned address = ((base + i * 2) ^ swap) & (RDP_TMEM_SIZE - 1);
+
+      out[i * 2] = tmem[address];
+      out[i * 2 + 1] = tmem[address + 1];
+    }
+  }
+
+  else {
+    for (i = 0; i < count; i++) {
+      unsigned address = ((base + i) ^ swap) & (RDP_TMEM_SIZE - 1);
+      uint16_t texel = state->other_modes.en_tlut
+        ? rdp_tlut_read(state, tmem[address])
+        : tmem[address] * 0x0101;
+
+      out[i * 2] = texel >> 8;
+      out[i * 2 + 1] = texel;
+    }
+  }
+
+  return true;
+}
+
+// Copies a run of texels into TMEM as 64-bit words. The line counter
+// advances by dxt per word; words on odd lines are stored swapped.
+void rdp_load_block(struct rdp_state *state, const uint8_t *ram,
+  unsigned tile, unsigned sl, unsigned tl, unsigned sh, unsigned dxt) {
+  const struct rdp_image *image = &state->texture_image;
+  struct rdp_tile *desc = state->tiles + (tile & 0x7);
+  uint32_t source, bytes, words, line_counter, i, j;
+
+  desc->sl = sl;
+  desc->tl = tl;
+  desc->sh = sh;
+  desc->th = dxt;
+
+  rdp_texcache_invalidate(state->texcache);
+
+  if (sh < sl)
+    return;
+
+  source = image->address + (((tl * image->width + sl) << image->size) >> 1);
+  bytes = (((sh - sl + 1) << image->size) + 1) >> 1;
+  words = (bytes + 7) >> 3;
+  line_counter = 0;
+
+  if (state->band_index == 0)
+    state->counters->tmem_words += words;
+
+  for (i = 0; i < words; i++, line_counter += dxt) {
+    unsigned swap = (line_counter >> 11 & 0x1) << 2;
+    uint32_t src = source + i * 8;
+
+    if (desc->size == RDP_SIZE_32BPP) {
+      for (j = 0; j < 2; j++) {
+        unsigned dest = ((desc->tmem * 8 + i * 4 + j * 2) ^ swap) &
+          (RDP_TMEM_SIZE / 2 - 1);
+
+        state->tmem[dest] = ram[(src + j * 4) & RDP_RAM_MASK];
+        state->tmem[dest + 1] = ram[(src + j * 4 + 1) & RDP_RAM_MASK];
+        state->tmem[dest + RDP_TMEM_SIZE / 2] =
+          ram[(src + j * 4 + 2) & RDP_RAM_MASK];
+        state->tmem[dest + RDP_TMEM_SIZE / 2 + 1] =
+          ram[(src + j * 4 + 3) & RDP_RAM_MASK];
+      }
+    }
+
+    else {
+      for (j = 0; j < 8; j++) {
+        unsigned dest = ((desc->tmem * 8 + i * 8 + j) ^ swap) &
+          (RDP_TMEM_SIZE - 1);
+
+        state->tmem[dest] = ram[(src + j) & RDP_RAM_MASK];
+      }
+    }
+  }
+}
+
+// Copies a rectangle of texels into TMEM, a line of the tile per row.
+void rdp_load_tile(struct rdp_state *state, const uint8_t *ram,
+  unsigned tile, unsigned sl, unsigned tl, unsigned sh, unsigned th) {
+  const struct rdp_image *image = &state->texture_image;
+  struct rdp_tile *desc = state->tiles + (tile & 0x7);
+  unsigned s0 = sl >> 2, t0 = tl >> 2;
+  unsigned s1 = sh >> 2, t1 = th >> 2;
+  unsigned s, t;
+
+  desc->sl = sl;
+  desc->tl = tl;
+  desc->sh = sh;
+  desc->th = th;
+
+  rdp_texcache_invalidate(state->texcache);
+
+  // Nibble-sized images can't be loaded this way.
+  if (image->size == RDP_SIZE_4BPP)
+    return;
+
+  if (state->band_index == 0 && s0 <= s1 && t0 <= t1) {
+    state->counters->tmem_words += (uint64_t) (t1 - t0 + 1) *
+      ((((s1 - s0 + 1) << image->size >> 1) + 7) >> 3);
+  }
+
+  for (t = t0; t <= t1; t++) {
+    unsigned row = t - t0;
+    unsigned base = desc->tmem * 8 + row * desc->line * 8;
+    unsigned swap = (row & 0x1) << 2;
+    uint32_t src = image->address + ((t * image->width + s0) <<
+      image->size >> 1);
+
+    for (s = 0; s <= s1 - s0 && s0 <= s1; s++) {
+      unsigned dest;
+
+      switch (image->size) {
+        case RDP_SIZE_8BPP:
+          dest = ((base + s) ^ swap) & (RDP_TMEM_SIZE - 1);
+          state->tmem[dest] = ram[(src + s) & RDP_RAM_MASK];
+          break;
+
+        case RDP_SIZE_16BPP:
+          dest = ((base + s * 2) ^ swap) & (RDP_TMEM_SIZE - 1);
+          state->tmem[dest] = ram[(src + s * 2) & RDP_RAM_MASK];
+          state->tmem[dest + 1] = ram[(src + s * 2 + 1) & RDP_RAM_MASK];
+          break;
+
+        default:
+          dest = ((base + s * 2) ^ swap) & (RDP_TMEM_SIZE / 2 - 1);
+          state->tmem[dest] = ram[(src + s * 4) & RDP_RAM_MASK];
+          state->tmem[dest + 1] = ram[(src + s * 4 + 1) & RDP_RAM_MASK];
+          state->tmem[dest + RDP_TMEM_SIZE / 2] =
+            ram[(src + s * 4 + 2) & RDP_RAM_MASK];
+          state->tmem[dest + RDP_TMEM_SIZE / 2 + 1] =
+            ram[(src + s * 4 + 3) & RDP_RAM_MASK];
+          break;
+      }
+    }
+  }
+}
+
+// Copies palette entries into TMEM, each one repeated four times.
+void rdp_load_tlut(struct rdp_state *state, const uint8_t *ram,
+  unsigned tile, unsigned sl, unsigned tl, unsigned sh, unsigned th) {
+  const struct rdp_image *image = &state->texture_image;
+  struct rdp_tile *desc = state->tiles + (tile & 0x7);
+  unsigned s0 = sl >> 2, s1 = sh >> 2;
+  uint32_t src;
+  unsigned i, j;
+
+  desc->sl = sl;
+  desc->tl = tl;
+  desc->sh = sh;
+  desc->th = th;
+
+  rdp_texcache_invalidate(state->texcache);
+  src = image->address + ((tl >> 2) * image->width + s0) * 2;
+
+  // Each entry takes up a whole word of TMEM.
+  if (state->band_index == 0 && s0 <= s1)
+    state->counters->tmem_words += s1 - s0 + 1;
+
+  for (i = 0; s0 + i <= s1; i++) {
+    uint16_t entry = rdp_ram_read16(ram, src + i * 2);
+
+    for (j = 0; j < 4; j++) {
+      unsigned dest = (desc->tmem * 8 + i * 8 + j * 2) & (RDP_TMEM_SIZE - 1);
+
+      state->tmem[dest] = entry >> 8;
+      state->tmem[dest + 1] = entry;
+    }
+  }
+}
+
@@ -0,0 +1,37 @@
+//
+// rdp/texture.h: RDP texture memory loads and sampling.
+//
+// CEN64: Cycle-Accurate Nintendo 64 Simulator.
+// Copyright (C) 2014, Tyler J. Stachecki.
+//
+// This file is subject to the terms and conditions defined in
+// 'LICENSE', which is part of this source code package.
+//
+
+#ifndef __rdp_texture_h__
+#define __rdp_texture_h__
+#include "common.h"
+#include "rdp/state.h"
+
+void rdp_load_block(struct rdp_state *state, const uint8_t *ram,
+  unsigned tile, unsigned sl, unsigned tl, unsigned sh, unsigned dxt);
+void rdp_load_tile(struct rdp_state *state, const uint8_t *ram,
+  unsigned tile, unsigned sl, unsigned tl, unsigned sh, unsigned th);
+void rdp_load_tlut(struct rdp_state *state, const uint8_t *ram,
+  unsigned tile, unsigned sl, unsigned tl, unsigned sh, unsigned th);
+
+// Decodes the texel at (s, t) within a tile, bypassing the cache.
+void rdp_texel_fetch(const struct rdp_state *state,
+  const struct rdp_tile *tile, unsigned s, unsigned t,
+  struct rdp_color *texel);
+
+// Coordinates are s10.5 texels, before the tile's shift and offset.
+void rdp_texture_sample(const struct rdp_state *state, unsigned tile,
+  int32_t s, int32_t t, struct rdp_color *texel);
+uint32_t rdp_texture_fetch_raw(const struct rdp_state *state,
+  unsigned tile, int32_t s, int32_t t);
+bool rdp_texture_copy_row(const struct rdp_state *state, unsigned tile,
+  int32_t s, int32_t t, unsigned count, uint8_t *out);
+
+#endif
+
@@ -0,0 +1,300 @@
+//
+// rdp/thread.c: Asynchronous RDP support.
+//
+// CEN64: Cycle-Accurate Nintendo 64 Simulator.
+// Copyright (C) 2014, Tyler J. Stachecki.
+//
+// This file is subject to the terms and conditions defined in
+// 'LICENSE', which is part of this source code package.
+//
+
+#include "common.h"
+#include "bus/controller.h"
+#include "os/thread.h"
+#include "os/timer.h"
+#include "rdp/commands.h"
+#include "rdp/cpu.h"
+#include "rdp/thread.h"
+#include "rdp/workers.h"
+#include "ri/controller.h"
+
+// The RDP thread spins this many times on an empty ring before it
+// goes to sleep until more commands are published.
+#define RDP_THREAD_IDLE_COUNT 4096
+
+// Ring space is handed back after at most this many words.
+#define RDP_THREAD_BATCH_WORDS (RDP_THREAD_RING_WORDS / 4)
+
+static void rdp_thread_idle(struct rdp_thread *thread,
+  uint64_t tail, unsigned *spins);
+static void *rdp_thread_main(void *opaque);
+static void rdp_thread_run(struct rdp *rdp, uint64_t tail, uint64_t head);
+static void rdp_thread_track_image(struct rdp_thread *thread,
+  uint32_t address);
+static void rdp_thread_wait(struct rdp_thread *thread, uint64_t target);
+
+// Called by the RDP thread when the ring is empty.
+void rdp_thread_idle(struct rdp_thread *thread,
+  uint64_t tail, unsigned *spins) {
+  if (*spins < RDP_THREAD_IDLE_COUNT) {
+    cen64_cpu_relax();
+    (*spins)++;
+    return;
+  }
+
+  cen64_sleeper_wait(&thread->sleeper, &thread->head, tail, &thread->exit);
+  *spins = 0;
+}
+
+// Renders commands as they're published.
+void *rdp_thread_main(void *opaque) {
+  struct rdp *rdp = (struct rdp *) opaque;
+  struct rdp_thread *thread = &rdp->thread;
+  uint64_t tail = thread->consumed;
+  cen64_time start_time, end_time;
+  unsigned spins = 0;
+
+  while (1) {
+    uint64_t head = cen64_atomic_load_u64(&thread->head);
+
+    // Out of work: make sure it's all been drawn before saying so.
+    if (head == tail) {
+      if (thread->done != tail) {
+        if (rdp->workers) {
+          get_time(&start_time);
+          rdp_workers_flush(rdp->workers);
+          get_time(&end_time);
+
+          rdp->counters.host_ns +=
+            compute_time_difference(&end_time, &start_time);
+        }
+
+        cen64_atomic_store_u64(&thread->done, tail);
+      }
+
+      if (cen64_atomic_load_u32(&thread->exit))
+        break;
+
+      rdp_thread_idle(thread, tail, &spins);
+      continue;
+    }
+
+    if (head - tail > RDP_THREAD_BATCH_WORDS)
+      head = tail + RDP_THREAD_BATCH_WORDS;
+
+    get_time(&start_time);
+    rdp_thread_run(rdp, tail, head);
+    get_time(&end_time);
+
+    rdp->counters.host_ns += compute_time_difference(&end_time, &start_time);
+    tail = head;
+
+    cen64_atomic_store_u64(&thread->consumed, tail);
+
+    // Batches handed to the workers aren't drawn until they're flushed.
+    if (rdp->workers == NULL)
+      cen64_atomic_store_u64(&thread->done, tail);
+
+    spins = 0;
+  }
+
+  cen64_atomic_store_u32(&thread->finished, 1);
+  return NULL;
+}
+
+// Moves everything pushed so far over to the RDP thread.
+void rdp_thread_publish(struct rdp_thread *thread) {
+  if (thread->head == thread->pending)
+    return;
+
+  cen64_atomic_store_u64(&thread->head, thread->pending);
+  cen64_sleeper_notify(&thread->sleeper);
+}
+
+// Queues up a command for the RDP thread. It isn't seen by the RDP
+// thread until it's published.
+void rdp_thread_push(struct rdp_thread *thread,
+  const uint64_t *cmd, unsigned length) {
+  uint64_t pending = thread->pending;
+  unsigned i, spins = 0;
+
+  if (pending + length - thread->consumed_seen > RDP_THREAD_RING_WORDS) {
+    rdp_thread_publish(thread);
+
+    do {
+      cen64_thread_backoff(&spins);
+      thread->consumed_seen = cen64_atomic_load_u64(&thread->consumed);
+    } while (pending + length - thread->consumed_seen > RDP_THREAD_RING_WORDS);
+  }
+
+  for (i = 0; i < length; i++)
+    thread->ring[(pending + i) & (RDP_THREAD_RING_WORDS - 1)] = cmd[i];
+
+  if ((cmd[0] >> 56 & 0x3F) == RDP_CMD_SET_COLOR_IMAGE)
+    rdp_thread_track_image(thread, cmd[0] & 0xFFFFFF);
+
+  thread->pending = pending + length;
+  thread->images[thread->image].position = thread->pending;
+}
+
+// Renders the commands in [tail, head) from the ring.
+void rdp_thread_run(struct rdp *rdp, uint64_t tail, uint64_t head) {
+  struct rdp_thread *thread = &rdp->thread;
+
+  for (; tail < head; tail++) {
+    thread->cmd_buffer[thread->cmd_length++] =
+      thread->ring[tail & (RDP_THREAD_RING_WORDS - 1)];
+
+    if (thread->cmd_length < rdp_command_length(thread->cmd_buffer[0]))
+      continue;
+
+    if (rdp->workers) {
+      rdp_workers_submit(rdp->workers,
+        thread->cmd_buffer, thread->cmd_length);
+    }
+
+    else {
+      rdp_execute_command(&rdp->state,
+        rdp->bus->ri->ram, thread->cmd_buffer);
+    }
+
+    thread->cmd_length = 0;
+  }
+}
+
+// Waits for the VI to be able to scan out an image, if need be. Images
+// are assumed to be no larger than the part that's being scanned out.
+void rdp_thread_scanout(struct rdp_thread *thread,
+  uint32_t address, uint32_t length) {
+  uint64_t target = thread->evicted;
+  unsigned i;
+
+  for (i = 0; i < RDP_THREAD_IMAGES; i++) {
+    uint32_t image = thread->images[i].address;
+
+    if (thread->images[i].position > target &&
+      image < address + length && address < image + length)
+      target = thread->images[i].position;
+  }
+
+  rdp_thread_wait(thread, target);
+}
+
+// Spawns the RDP thread. Nothing else may be rendering when it's called.
+int rdp_thread_start(struct rdp *rdp) {
+  struct rdp_thread *thread = &rdp->thread;
+  unsigned i;
+
+  thread->ring = (uint64_t *) malloc(
+    RDP_THREAD_RING_WORDS * sizeof(*thread->ring));
+
+  if (thread->ring == NULL)
+    return 1;
+
+  thread->pending = 0;
+  thread->consumed_seen = 0;
+  thread->done_seen = 0;
+  thread->evicted = 0;
+  thread->head = 0;
+  thread->consumed = 0;
+  thread->done = 0;
+  thread->exit = 0;
+  thread->finished = 0;
+  thread->cmd_length = 0;
+
+  for (i = 0; i < RDP_THREAD_IMAGES; i++) {
+    thread->images[i].address = rdp->state.color_image.address;
+    thread->images[i].position = 0;
+  }
+
+  thread->image = 0;
+  thread->next_image = 1;
+
+  if (cen64_sleeper_create(&thread->sleeper)) {
+    free(thread->ring);
+    return 1;
+  }
+
+  if (cen64_thread_create(&thread->thread, rdp_thread_main, rdp)) {
+    debug("rdp_thread_start: Failed to spawn the RDP thread.\n");
+    cen64_sleeper_destroy(&thread->sleeper);
+    free(thread->ring);
+    return 1;
+  }
+
+  thread->enabled = true;
+  return 0;
+}
+
+// Lets everything queued up drain, then waits for the thread to exit.
+void rdp_thread_stop(struct rdp *rdp) {
+  struct rdp_thread *thread = &rdp->thread;
+
+  if (!thread->enabled)
+    return;
+
+  rdp_thread_sync(thread);
+
+  cen64_atomic_store_u32(&thread->exit, 1);
+  cen64_sleeper_wake(&thread->sleeper);
+  cen64_thread_join(&thread->thread);
+
+  cen64_sleeper_destroy(&thread->sleeper);
+  free(thread->ring);
+
+  thread->enabled = false;
+}
+
+// Checks whether anything pushed so far is yet to be drawn, without
+// waiting. It's published first, so that polling always sees it finish.
+bool rdp_thread_busy(struct rdp_thread *thread) {
+  if (thread->pending <= thread->done_seen)
+    return false;
+
+  rdp_thread_publish(thread);
+  thread->done_seen = cen64_atomic_load_u64(&thread->done);
+  return thread->done_seen < thread->pending;
+}
+
+// Waits for the RDP thread to draw everything pushed so far.
+void rdp_thread_sync(struct rdp_thread *thread) {
+  rdp_thread_wait(thread, thread->pending);
+}
+
+// Notes which image the following commands draw to. If an image with
+// queued up commands falls out of the table, scanouts of any image
+// wait on it from then on, to be safe.
+void rdp_thread_track_image(struct rdp_thread *thread, uint32_t address) {
+  unsigned i;
+
+  for (i = 0; i < RDP_THREAD_IMAGES; i++) {
+    if (thread->images[i].address == address) {
+      thread->image = i;
+      return;
+    }
+  }
+
+  i = thread->next_image;
+  thread->next_image = (i + 1) % RDP_THREAD_IMAGES;
+
+  if (thread->images[i].position > thread->evicted)
+    thread->evicted = thread->images[i].position;
+
+  thread->images[i].address = address;
+  thread->images[i].position = thread->pending;
+  thread->image = i;
+}
+
+// Waits for the RDP thread to finish drawing up to a position.
+void rdp_thread_wait(struct rdp_thread *thread, uint64_t target) {
+  unsigned spins = 0;
+
+  if (target <= thread->done_seen)
+    return;
+
+  rdp_thread_publish(thread);
+
+  while ((thread->done_seen = cen64_atomic_load_u64(&thread->done)) < target)
+    cen64_thread_backoff(&spins);
+}
+
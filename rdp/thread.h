@@ -0,0 +1,78 @@
+//
+// rdp/thread.h: Asynchronous RDP support.
+//
+// CEN64: Cycle-Accurate Nintendo 64 Simulator.
+// Copyright (C) 2014, Tyler J. Stachecki.
+//
+// This file is subject to the terms and conditions defined in
+// 'LICENSE', which is part of this source code package.
+//
+
+#ifndef __rdp_thread_h__
+#define __rdp_thread_h__
+#include "common.h"
+#include "os/thread.h"
+#include "rdp/commands.h"
+
+#define RDP_THREAD_RING_WORDS 0x10000
+#define RDP_THREAD_IMAGES 4
+
+struct rdp;
+
+// When enabled, commands are rendered on their own host thread. Command
+// lists are still read (and DPC_CURRENT advanced) as soon as DPC_END is
+// written, but the commands themselves go into a single-producer/single-
+// consumer ring that the RDP thread drains in the background.
+//
+// The thread processing lists only waits for the RDP thread to catch
+// up when the results must be complete: at a full sync (before the
+// interrupt is raised), and when the VI scans out an image that still
+// has drawing queued up against it. DPC_STATUS just reports the RDP as
+// busy until everything pushed so far has been drawn.
+struct rdp_thread {
+  cen64_thread thread;
+  struct cen64_sleeper sleeper;
+  uint64_t *ring;
+  bool enabled;
+
+  // Used only by the thread processing command lists.
+  uint64_t pending;
+  uint64_t consumed_seen;
+  uint64_t done_seen;
+
+  struct {
+    uint32_t address;
+    uint64_t position;
+  } images[RDP_THREAD_IMAGES];
+
+  uint64_t evicted;
+  unsigned image;
+  unsigned next_image;
+
+  // Used only by the RDP thread.
+  uint64_t cmd_buffer[RDP_MAX_COMMAND_WORDS];
+  unsigned cmd_length;
+
+  // Written by the thread processing command lists.
+  cen64_align(volatile uint64_t head, CACHE_LINE_SIZE);
+  volatile uint32_t exit;
+
+  // Written by the RDP thread.
+  cen64_align(volatile uint64_t consumed, CACHE_LINE_SIZE);
+  volatile uint64_t done;
+  volatile uint32_t finished;
+};
+
+cen64_cold int rdp_thread_start(struct rdp *rdp);
+cen64_cold void rdp_thread_stop(struct rdp *rdp);
+
+void rdp_thread_push(struct rdp_thread *thread,
+  const uint64_t *cmd, unsigned length);
+void rdp_thread_publish(struct rdp_thread *thread);
+void rdp_thread_scanout(struct rdp_thread *thread,
+  uint32_t address, uint32_t length);
+bool rdp_thread_busy(struct rdp_thread *thread);
+void rdp_thread_sync(struct rdp_thread *thread);
+
+#endif
+
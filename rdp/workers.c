@@ -0,0 +1,309 @@
+//
+// rdp/workers.c: Multithreaded RDP rasterization.
+//
+// CEN64: Cycle-Accurate Nintendo 64 Simulator.
+// Copyright (C) 2014, Tyler J. Stachecki.
+//
+// This file is subject to the terms and conditions defined in
+// 'LICENSE', which is part of this source code package.
+//
+
+#include "common.h"
+#include "bus/controller.h"
+#include "os/thread.h"
+#include "rdp/commands.h"
+#include "rdp/cpu.h"
+#include "rdp/state.h"
+#include "rdp/texcache.h"
+#include "rdp/workers.h"
+#include "ri/controller.h"
+
+static bool rdp_workers_load_overlaps(const struct rdp_workers *pool,
+  const uint64_t *cmd);
+static void rdp_worker_replay(struct rdp_worker *worker,
+  const uint64_t *batch, unsigned words);
+static void *rdp_worker_thread(void *opaque);
+
+// Returns true if a texture load reads from anywhere in the color or
+// depth image that the batch could have drawn to.
+bool rdp_workers_load_overlaps(const struct rdp_workers *pool,
+  const uint64_t *cmd) {
+  const struct rdp_image *texture = &pool->texture_image;
+  const struct rdp_image *color = &pool->color_image;
+  unsigned sl = cmd[0] >> 44 & 0xFFF, tl = cmd[0] >> 32 & 0xFFF;
+  unsigned sh = cmd[0] >> 12 & 0xFFF, th = cmd[0] & 0xFFF;
+  uint32_t start, end, color_end, z_end;
+
+  switch (cmd[0] >> 56 & 0x3F) {
+    // Block loads run on from (sl, tl) for sh - sl + 1 texels, and
+    // fetch whole 64-bit words.
+    case RDP_CMD_LOAD_BLOCK:
+      if (sh < sl)
+        return false;
+
+      start = texture->address + ((tl * texture->width + sl) <<
+        texture->size >> 1);
+      end = start + (((((sh - sl + 1) << texture->size) + 1) / 2 + 7) &
+        ~0x7U);
+      break;
+
+    // Palettes are always read as 16-bit entries from the first row.
+    case RDP_CMD_LOAD_TLUT:
+      start = texture->address + ((tl >> 2) * texture->width + (sl >> 2)) * 2;
+      end = texture->address + ((tl >> 2) * texture->width + (sh >> 2) + 1) * 2;
+      break;
+
+    // Tile loads read from whole rows, tl through th.
+    default:
+      start = texture->address + (((tl >> 2) * texture->width) <<
+        texture->size >> 1);
+      end = texture->address + ((((th >> 2) + 1) * texture->width) <<
+        texture->size >> 1);
+      break;
+  }
+
+  color_end = color->address + ((pool->scissor_max * color->width) <<
+    color->size >> 1);
+  z_end = pool->z_image + pool->scissor_max * color->width * 2;
+
+  return (start < color_end && color->address < end) ||
+    (start < z_end && pool->z_image < end);
+}
+
+// Runs every command in the batch against the worker's state.
+void rdp_worker_replay(struct rdp_worker *worker,
+  const uint64_t *batch, unsigned words) {
+  uint8_t *ram = worker->pool->ram;
+  unsigned i;
+
+  for (i = 0; i < words; i += rdp_command_length(batch[i]))
+    rdp_execute_command(&worker->state, ram, batch + i);
+}
+
+// Waits for batches to be handed out and renders this worker's bands.
+void *rdp_worker_thread(void *opaque) {
+  struct rdp_worker *worker = (struct rdp_worker *) opaque;
+  struct rdp_workers *pool = worker->pool;
+  unsigned generation = 0;
+
+  cen64_mutex_lock(&pool->lock);
+
+  while (1) {
+    while (pool->generation == generation && !pool->exit)
+      cen64_cv_wait(&pool->start_cv, &pool->lock);
+
+    if (pool->exit)
+      break;
+
+    generation = pool->generation;
+    cen64_mutex_unlock(&pool->lock);
+
+    rdp_worker_replay(worker, pool->batch, pool->batch_words);
+
+    cen64_mutex_lock(&pool->lock);
+
+    if (--pool->pending == 0)
+      cen64_cv_signal(&pool->done_cv);
+  }
+
+  cen64_mutex_unlock(&pool->lock);
+  return NULL;
+}
+
+// Adds in the work done by the workers rendering on other threads.
+// Nothing may be queued up, or in flight, when it's called.
+void rdp_workers_add_counters(const struct rdp_workers *pool,
+  struct rdp_counters *counters) {
+  unsigned i;
+
+  for (i = 1; i < pool->count; i++)
+    rdp_counters_add(counters, &pool->workers[i].counters);
+}
+
+// Hands the pending batch to the workers and waits for all of them to
+// finish with it. The calling thread renders the first set of bands.
+void rdp_workers_flush(struct rdp_workers *pool) {
+  if (pool->batch_words == 0)
+    return;
+
+  cen64_mutex_lock(&pool->lock);
+  pool->pending = pool->count - 1;
+  pool->generation++;
+  cen64_cv_broadcast(&pool->start_cv);
+  cen64_mutex_unlock(&pool->lock);
+
+  rdp_worker_replay(pool->workers, pool->batch, pool->batch_words);
+
+  cen64_mutex_lock(&pool->lock);
+
+  while (pool->pending > 0)
+    cen64_cv_wait(&pool->done_cv, &pool->lock);
+
+  cen64_mutex_unlock(&pool->lock);
+  pool->batch_words = 0;
+  pool->scissor_max = pool->scissor_bottom;
+}
+
+// Queues up a complete command. The batch is flushed first whenever
+// the command could observe pixels drawn earlier in the same batch:
+// when the color or depth image moves, or when a texture is loaded
+// from anywhere within either of them.
+void rdp_workers_submit(struct rdp_workers *pool,
+  const uint64_t *cmd, unsigned length) {
+  uint32_t address = cmd[0] & 0xFFFFFF;
+
+  switch (cmd[0] >> 56 & 0x3F) {
+    case RDP_CMD_SET_COLOR_IMAGE:
+      if (address != pool->color_image.address)
+        rdp_workers_flush(pool);
+
+      pool->color_image.size = (enum rdp_size) (cmd[0] >> 51 & 0x3);
+      pool->color_image.width = (cmd[0] >> 32 & 0x3FF) + 1;
+      pool->color_image.address = address;
+      break;
+
+    case RDP_CMD_SET_Z_IMAGE:
+      if (address != pool->z_image)
+        rdp_workers_flush(pool);
+
+      pool->z_image = address;
+      break;
+
+    case RDP_CMD_SET_TEXTURE_IMAGE:
+      pool->texture_image.size = (enum rdp_size) (cmd[0] >> 51 & 0x3);
+      pool->texture_image.width = (cmd[0] >> 32 & 0x3FF) + 1;
+      pool->texture_image.address = address;
+      break;
+
+    case RDP_CMD_SET_SCISSOR:
+      pool->scissor_bottom = ((cmd[0] & 0xFFF) + 3) >> 2;
+
+      if (pool->scissor_bottom > pool->scissor_max)
+        pool->scissor_max = pool->scissor_bottom;
+
+      break;
+
+    case RDP_CMD_LOAD_TLUT:
+    case RDP_CMD_LOAD_BLOCK:
+    case RDP_CMD_LOAD_TILE:
+      if (rdp_workers_load_overlaps(pool, cmd))
+        rdp_workers_flush(pool);
+
+      break;
+  }
+
+  if (pool->batch_words + length > RDP_BATCH_WORDS)
+    rdp_workers_flush(pool);
+
+  memcpy(pool->batch + pool->batch_words, cmd, length * sizeof(*cmd));
+  pool->batch_words += length;
+}
+
+// Splits rasterization across count renderers (including the thread
+// that processes command lists).
+int rdp_workers_start(struct rdp *rdp, unsigned count) {
+  struct rdp_workers *pool;
+  unsigned i;
+
+  if (count > RDP_MAX_WORKERS)
+    count = RDP_MAX_WORKERS;
+
+  if (count < 2)
+    return 0;
+
+  if ((pool = (struct rdp_workers *) calloc(1, sizeof(*pool))) == NULL)
+    return 1;
+
+  pool->workers = (struct rdp_worker *) calloc(count, sizeof(*pool->workers));
+  pool->batch = (uint64_t *) malloc(RDP_BATCH_WORDS * sizeof(*pool->batch));
+
+  if (pool->workers == NULL || pool->batch == NULL) {
+    free(pool->workers);
+    free(pool->batch);
+    free(pool);
+    return 1;
+  }
+
+  pool->count = count;
+  pool->ram = rdp->bus->ri->ram;
+  pool->color_image = rdp->state.color_image;
+  pool->texture_image = rdp->state.texture_image;
+  pool->z_image = rdp->state.z_image;
+  pool->scissor_bottom = (rdp->state.scissor.yl + 3) >> 2;
+  pool->scissor_max = pool->scissor_bottom;
+
+  cen64_mutex_create(&pool->lock);
+  cen64_cv_create(&pool->start_cv);
+  cen64_cv_create(&pool->done_cv);
+
+  for (i = 0; i < count; i++) {
+    struct rdp_worker *worker = pool->workers + i;
+
+    worker->state = rdp->state;
+    worker->state.band_index = i;
+    worker->state.band_count = count;
+    worker->pool = pool;
+
+    // Worker 0 runs on this thread and keeps using the RDP's cache.
+    if (i > 0) {
+      worker->state.texcache = rdp_texcache_create();
+      worker->state.counters = &worker->counters;
+    }
+  }
+
+  for (i = 1; i < count; i++) {
+    if (cen64_thread_create(&pool->workers[i].thread,
+      rdp_worker_thread, pool->workers + i)) {
+      debug("rdp_workers_start: Failed to create a worker thread.\n");
+      pool->count = i;
+
+      for (; i < count; i++)
+        rdp_texcache_destroy(pool->workers[i].state.texcache);
+
+      rdp->workers = pool;
+      rdp_workers_stop(rdp);
+      return 1;
+    }
+  }
+
+  rdp->workers = pool;
+  return 0;
+}
+
+// Drains any pending work and goes back to rendering on one thread.
+void rdp_workers_stop(struct rdp *rdp) {
+  struct rdp_workers *pool = rdp->workers;
+  unsigned i;
+
+  if (pool == NULL)
+    return;
+
+  rdp_workers_flush(pool);
+
+  cen64_mutex_lock(&pool->lock);
+  pool->exit = true;
+  cen64_cv_broadcast(&pool->start_cv);
+  cen64_mutex_unlock(&pool->lock);
+
+  for (i = 1; i < pool->count; i++) {
+    cen64_thread_join(&pool->workers[i].thread);
+    rdp_texcache_destroy(pool->workers[i].state.texcache);
+  }
+
+  rdp_workers_add_counters(pool, &rdp->counters);
+
+  rdp->state = pool->workers[0].state;
+  rdp->state.band_index = 0;
+  rdp->state.band_count = 1;
+
+  cen64_cv_destroy(&pool->done_cv);
+  cen64_cv_destroy(&pool->start_cv);
+  cen64_mutex_destroy(&pool->lock);
+
+  free(pool->workers);
+  free(pool->batch);
+  free(pool);
+
+  rdp->workers = NULL;
+}
+
@@ -0,0 +1,73 @@
+//
+// rdp/workers.h: Multithreaded RDP rasterization.
+//
+// CEN64: Cycle-Accurate Nintendo 64 Simulator.
+// Copyright (C) 2014, Tyler J. Stachecki.
+//
+// This file is subject to the terms and conditions defined in
+// 'LICENSE', which is part of this source code package.
+//
+
+#ifndef __rdp_workers_h__
+#define __rdp_workers_h__
+#include "common.h"
+#include "os/thread.h"
+#include "rdp/state.h"
+
+#define RDP_MAX_WORKERS 16
+
+// Commands held back before a batch is forced out (in 64-bit words).
+#define RDP_BATCH_WORDS 0x10000
+
+struct rdp;
+struct rdp_workers;
+
+// Each renderer keeps its own copy of the RDP state and replays every
+// command in a batch, but only draws the scanline bands it owns. Since
+// a pixel depends only on the state and what's in memory under it,
+// the output matches the single-threaded renderer exactly.
+struct rdp_worker {
+  struct rdp_state state;
+  struct rdp_workers *pool;
+  cen64_thread thread;
+
+  // Unused by the first worker, which tallies into the RDP's counters.
+  struct rdp_counters counters;
+};
+
+struct rdp_workers {
+  struct rdp_worker *workers;
+  unsigned count;
+  uint8_t *ram;
+
+  uint64_t *batch;
+  unsigned batch_words;
+
+  // Images the batch touches; changing them forces a join. Rows at
+  // and below the lowest scissor bottom set since the last join can't
+  // have been drawn yet.
+  struct rdp_image color_image;
+  struct rdp_image texture_image;
+  uint32_t z_image;
+  unsigned scissor_bottom;
+  unsigned scissor_max;
+
+  cen64_mutex lock;
+  cen64_cv start_cv;
+  cen64_cv done_cv;
+  unsigned generation;
+  unsigned pending;
+  bool exit;
+};
+
+cen64_cold int rdp_workers_start(struct rdp *rdp, unsigned count);
+cen64_cold void rdp_workers_stop(struct rdp *rdp);
+
+void rdp_workers_add_counters(const struct rdp_workers *pool,
+  struct rdp_counters *counters);
+void rdp_workers_flush(struct rdp_workers *pool);
+void rdp_workers_submit(struct rdp_workers *pool,
+  const uint64_t *cmd, unsigned length);
+
+#endif
+
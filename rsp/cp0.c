@@ -11,6 +11,7 @@
 #include "common.h"
 #include "bus/address.h"
 #include "bus/controller.h"
+#include "device/scheduler.h"
 #include "rdp/interface.h"
 #include "rsp/cp0.h"
 #include "rsp/cpu.h"
@@ -20,16 +21,48 @@
 
 static void rsp_status_write(struct rsp *rsp, uint32_t rt);
 
+// Returns true if an access to the register can touch state owned by
+// the VR4300 thread (i.e., MI interrupts, RDRAM by way of SP DMA, or
+// the RDP).
+static inline bool rsp_cp0_reg_is_shared(unsigned reg, bool write) {
+  switch (SP_REGISTER_OFFSET + reg) {
+    case RSP_CP0_REGISTER_DMA_CACHE:
+    case RSP_CP0_REGISTER_DMA_DRAM:
+    case RSP_CP0_REGISTER_DMA_READ_LENGTH:
+    case RSP_CP0_REGISTER_DMA_WRITE_LENGTH:
+      return true;
+
+    case RSP_CP0_REGISTER_DMA_FULL:
+    case RSP_CP0_REGISTER_DMA_BUSY:
+      return !write;
+
+    case RSP_CP0_REGISTER_SP_STATUS:
+      return write;
+
+    default:
+      return SP_REGISTER_OFFSET + reg >= RSP_CP0_REGISTER_CMD_START;
+  }
+}
+
 //
 // MFC0
 //
 void RSP_MFC0(struct rsp *rsp,
   uint32_t iw, uint32_t rs, uint32_t rt) {
   struct rsp_exdf_latch *exdf_latch = &rsp->pipeline.exdf_latch;
-  unsigned dest;
+  unsigned dest, src;
 
   dest = GET_RT(iw);
-  rt = rsp_read_cp0_reg(rsp, GET_RD(iw));
+  src = GET_RD(iw);
+
+  if (rsp_cp0_reg_is_shared(src, false)) {
+    rsp_lock_vr4300(rsp);
+    rt = rsp_read_cp0_reg(rsp, src);
+    rsp_unlock_vr4300(rsp);
+  }
+
+  else
+    rt = rsp_read_cp0_reg(rsp, src);
 
   exdf_latch->result.result = rt;
   exdf_latch->result.dest = dest;
@@ -43,7 +76,15 @@ void RSP_MTC0(struct rsp *rsp,
   unsigned dest;
 
   dest = GET_RD(iw);
-  rsp_write_cp0_reg(rsp, dest, rt);
+
+  if (rsp_cp0_reg_is_shared(dest, true)) {
+    rsp_lock_vr4300(rsp);
+    rsp_write_cp0_reg(rsp, dest, rt);
+    rsp_unlock_vr4300(rsp);
+  }
+
+  else
+    rsp_write_cp0_reg(rsp, dest, rt);
 }
 
 // Reads a value from the control coprocessor.
@@ -93,6 +134,9 @@ void rsp_status_write(struct rsp *rsp, uint32_t rt) {
   if (rt & SP_CLR_HALT) {
     rsp_pipeline_init(&rsp->pipeline);
     status &= ~SP_STATUS_HALT;
+
+    // The device loop doesn't cycle a halted RSP; wake it up.
+    scheduler_kick(rsp->bus->scheduler);
   }
 
   else if (rt & SP_SET_HALT)
@@ -203,7 +247,7 @@ void rsp_write_cp0_reg(struct rsp *rsp, unsigned dest, uint32_t rt) {
     case RSP_CP0_REGISTER_CMD_TMEM_BUSY:
       dest -= RSP_CP0_REGISTER_CMD_START;
 
-      write_dp_regs(rsp->bus->rdp, DP_REGS_BASE_ADDRESS + 4 * dest, rt, ~0);
+      rdp_write_reg(rsp->bus->rdp, dest, rt, ~0);
       break;
 
     default:
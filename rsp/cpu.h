@@ -14,6 +14,7 @@
 #include "os/dynarec.h"
 #include "rsp/cp2.h"
 #include "rsp/pipeline.h"
+#include "rsp/thread.h"
 
 enum rsp_register {
   RSP_REGISTER_R0, RSP_REGISTER_AT, RSP_REGISTER_V0,
@@ -64,6 +65,11 @@ struct rsp {
   // TODO: Only for IA32/x86_64 SSE2; sloppy?
   struct dynarec_slab vload_dynarec;
   struct dynarec_slab vstore_dynarec;
+
+  struct rsp_thread thread;
+
+  // Cycles spent running (i.e., not halted).
+  uint64_t active_cycles;
 };
 
 cen64_cold int rsp_init(struct rsp *rsp, struct bus_controller *bus);
@@ -72,5 +78,23 @@ cen64_cold void rsp_destroy(struct rsp *rsp);
 
 cen64_flatten cen64_hot void rsp_cycle(struct rsp *rsp);
 
+// Brings a threaded RSP up to the current cycle before the VR4300
+// accesses any state it shares with the RSP.
+static inline void rsp_sync(struct rsp *rsp) {
+  if (unlikely(rsp->thread.enabled))
+    rsp_thread_sync(rsp);
+}
+
+// Brackets accesses from the RSP to state owned by the VR4300 thread.
+static inline void rsp_lock_vr4300(struct rsp *rsp) {
+  if (unlikely(rsp->thread.in_thread))
+    rsp_thread_lock_vr4300(rsp);
+}
+
+static inline void rsp_unlock_vr4300(struct rsp *rsp) {
+  if (unlikely(rsp->thread.in_thread))
+    rsp_thread_unlock_vr4300(rsp);
+}
+
 #endif
 
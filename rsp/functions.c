@@ -261,8 +261,11 @@ void RSP_BREAK(struct rsp *rsp,
   uint32_t result = rsp->regs[RSP_CP0_REGISTER_SP_STATUS] |
     (SP_STATUS_HALT | SP_STATUS_BROKE);
 
-  if (rsp->regs[RSP_CP0_REGISTER_SP_STATUS] & SP_STATUS_INTR_BREAK)
+  if (rsp->regs[RSP_CP0_REGISTER_SP_STATUS] & SP_STATUS_INTR_BREAK) {
+    rsp_lock_vr4300(rsp);
     signal_rcp_interrupt(rsp->bus->vr4300, MI_INTR_SP);
+    rsp_unlock_vr4300(rsp);
+  }
 
   exdf_latch->result.dest = RSP_CP0_REGISTER_SP_STATUS;
   exdf_latch->result.result = result;
@@ -11,15 +11,58 @@
 #include "common.h"
 #include "bus/address.h"
 #include "bus/controller.h"
+#include "ri/controller.h"
 #include "rsp/cp0.h"
 #include "rsp/cpu.h"
 #include "rsp/interface.h"
 
-// DMA into the RSP's memory space.
+static void rsp_dma_predecode(struct rsp *rsp,
+  uint32_t mem_addr, unsigned length);
+static unsigned rsp_dma_span(uint32_t dram_addr,
+  uint32_t mem_addr, unsigned length);
+
+// Refreshes the opcode cache for whatever part of a block landed in
+// IMEM, byteswapping the whole block at once before decoding it.
+void rsp_dma_predecode(struct rsp *rsp,
+  uint32_t mem_addr, unsigned length) {
+  uint32_t iws[0x1000 / 4];
+  unsigned i, offset;
+
+  if (mem_addr + length <= 0x1000)
+    return;
+
+  if (mem_addr < 0x1000) {
+    length -= 0x1000 - mem_addr;
+    mem_addr = 0x1000;
+  }
+
+  offset = (mem_addr - 0x1000) >> 2;
+  rsp_byteswap_words(iws, rsp->mem + mem_addr, length / 4);
+
+  for (i = 0; i < length / 4; i++)
+    rsp->opcode_cache[offset + i] = *rsp_decode_instruction(iws[i]);
+}
+
+// Returns how much of a DMA row can be moved before either address
+// wraps around, so that each piece is a single contiguous block.
+unsigned rsp_dma_span(uint32_t dram_addr,
+  uint32_t mem_addr, unsigned length) {
+  if (length > 0x800000 - dram_addr)
+    length = 0x800000 - dram_addr;
+
+  if (length > 0x2000 - mem_addr)
+    length = 0x2000 - mem_addr;
+
+  return length;
+}
+
+// DMA into the RSP's memory space. RDRAM and SP memory are both kept
+// in big-endian byte order, so rows are copied straight across.
 void rsp_dma_read(struct rsp *rsp) {
   uint32_t length = (rsp->regs[RSP_CP0_REGISTER_DMA_READ_LENGTH] & 0xFFF) + 1;
   uint32_t skip = rsp->regs[RSP_CP0_REGISTER_DMA_READ_LENGTH] >> 20 & 0xFFF;
   unsigned count = rsp->regs[RSP_CP0_REGISTER_DMA_READ_LENGTH] >> 12 & 0xFF;
+  const uint8_t *ram = rsp->bus->ri->ram;
   unsigned j, i = 0;
 
   // Force alignment.
@@ -31,6 +74,12 @@ void rsp_dma_read(struct rsp *rsp) {
   if (((rsp->regs[RSP_CP0_REGISTER_DMA_CACHE] & 0xFFF) + length) > 0x1000)
     length = 0x1000 - (rsp->regs[RSP_CP0_REGISTER_DMA_CACHE] & 0xFFF);
 
+  // Without a skip, the rows are back-to-back on both sides.
+  if (skip == 0) {
+    length *= count + 1;
+    count = 0;
+  }
+
   do {
     uint32_t source = rsp->regs[RSP_CP0_REGISTER_DMA_DRAM] & 0x7FFFFC;
     uint32_t dest = rsp->regs[RSP_CP0_REGISTER_DMA_CACHE] & 0x1FFC;
@@ -39,18 +88,11 @@ void rsp_dma_read(struct rsp *rsp) {
     do {
       uint32_t source_addr = (source + j) & 0x7FFFFC;
       uint32_t dest_addr = (dest + j) & 0x1FFC;
-      uint32_t word;
-
-      bus_read_word(rsp, source_addr, &word);
-
-      // Update opcode cache.
-      if (dest_addr & 0x1000)
-        rsp->opcode_cache[(dest_addr - 0x1000) >> 2] =
-          *rsp_decode_instruction(word);
+      unsigned span = rsp_dma_span(source_addr, dest_addr, length - j);
 
-      word = byteswap_32(word);
-      memcpy(rsp->mem + dest_addr, &word, sizeof(word));
-      j += 4;
+      memcpy(rsp->mem + dest_addr, ram + source_addr, span);
+      rsp_dma_predecode(rsp, dest_addr, span);
+      j += span;
     } while (j < length);
 
     rsp->regs[RSP_CP0_REGISTER_DMA_DRAM] += length;
@@ -63,6 +105,7 @@ void rsp_dma_write(struct rsp *rsp) {
   uint32_t length = (rsp->regs[RSP_CP0_REGISTER_DMA_WRITE_LENGTH] & 0xFFF) + 1;
   uint32_t skip = rsp->regs[RSP_CP0_REGISTER_DMA_WRITE_LENGTH] >> 20 & 0xFFF;
   unsigned count = rsp->regs[RSP_CP0_REGISTER_DMA_WRITE_LENGTH] >> 12 & 0xFF;
+  uint8_t *ram = rsp->bus->ri->ram;
   unsigned j, i = 0;
 
   // Force alignment.
@@ -74,6 +117,12 @@ void rsp_dma_write(struct rsp *rsp) {
   if (((rsp->regs[RSP_CP0_REGISTER_DMA_CACHE] & 0xFFF) + length) > 0x1000)
     length = 0x1000 - (rsp->regs[RSP_CP0_REGISTER_DMA_CACHE] & 0xFFF);
 
+  // Without a skip, the rows are back-to-back on both sides.
+  if (skip == 0) {
+    length *= count + 1;
+    count = 0;
+  }
+
   do {
     uint32_t dest = rsp->regs[RSP_CP0_REGISTER_DMA_DRAM] & 0x7FFFFC;
     uint32_t source = rsp->regs[RSP_CP0_REGISTER_DMA_CACHE] & 0x1FFC;
@@ -82,13 +131,10 @@ void rsp_dma_write(struct rsp *rsp) {
     do {
       uint32_t source_addr = (source + j) & 0x1FFC;
       uint32_t dest_addr = (dest + j) & 0x7FFFFC;
-      uint32_t word;
-
-      memcpy(&word, rsp->mem + source_addr, sizeof(word));
-      word = byteswap_32(word);
+      unsigned span = rsp_dma_span(dest_addr, source_addr, length - j);
 
-      bus_write_word(rsp, dest_addr, word, ~0U);
-      j += 4;
+      memcpy(ram + dest_addr, rsp->mem + source_addr, span);
+      j += span;
     } while (j < length);
 
     rsp->regs[RSP_CP0_REGISTER_DMA_CACHE] += length;
@@ -101,6 +147,8 @@ int read_sp_mem(void *opaque, uint32_t address, uint32_t *word) {
   struct rsp *rsp = (struct rsp *) opaque;
   unsigned offset = address & 0x1FFC;
 
+  rsp_sync(rsp);
+
   memcpy(word, rsp->mem + offset, sizeof(*word));
   *word = byteswap_32(*word);
   return 0;
@@ -112,6 +160,8 @@ int read_sp_regs(void *opaque, uint32_t address, uint32_t *word) {
   uint32_t offset = address - SP_REGS_BASE_ADDRESS;
   enum sp_register reg = (offset >> 2);
 
+  rsp_sync(rsp);
+
   *word = rsp_read_cp0_reg(rsp, reg);
   debug_mmio_read(sp, sp_register_mnemonics[reg], *word);
   return 0;
@@ -123,6 +173,8 @@ int read_sp_regs2(void *opaque, uint32_t address, uint32_t *word) {
   uint32_t offset = address - SP_REGS2_BASE_ADDRESS;
   enum sp_register reg = (offset >> 2) + SP_PC_REG;
 
+  rsp_sync(rsp);
+
   if (reg == SP_PC_REG)
     *word = rsp->pipeline.dfwb_latch.common.pc;
 
@@ -139,6 +191,8 @@ int write_sp_mem(void *opaque, uint32_t address, uint32_t word, uint32_t dqm) {
   unsigned offset = address & 0x1FFC;
   uint32_t orig_word;
 
+  rsp_sync(rsp);
+
   memcpy(&orig_word, rsp->mem + offset, sizeof(orig_word));
   orig_word = byteswap_32(orig_word) & ~dqm;
   word = orig_word | word;
@@ -160,6 +214,8 @@ int write_sp_regs(void *opaque, uint32_t address, uint32_t word, uint32_t dqm) {
   enum sp_register reg = (offset >> 2);
 
   debug_mmio_write(sp, sp_register_mnemonics[reg], word, dqm);
+  rsp_sync(rsp);
+
   rsp_write_cp0_reg(rsp, reg, word);
   return 0;
 }
@@ -171,6 +227,7 @@ int write_sp_regs2(void *opaque, uint32_t address, uint32_t word, uint32_t dqm)
   enum sp_register reg = (offset >> 2) + SP_PC_REG;
 
   debug_mmio_write(sp, sp_register_mnemonics[reg], word, dqm);
+  rsp_sync(rsp);
 
   if (reg == SP_PC_REG)
     rsp->pipeline.ifrd_latch.pc = word & 0xFFC;
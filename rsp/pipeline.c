@@ -210,6 +210,8 @@ void rsp_cycle(struct rsp *rsp) {
   if (rsp->regs[RSP_CP0_REGISTER_SP_STATUS] & SP_STATUS_HALT)
     return;
 
+  rsp->active_cycles++;
+
   rsp_wb_stage(rsp);
   rsp_df_stage(rsp);
 
@@ -0,0 +1,188 @@
+//
+// rsp/thread.c: Threaded RSP support.
+//
+// CEN64: Cycle-Accurate Nintendo 64 Simulator.
+// Copyright (C) 2014, Tyler J. Stachecki.
+//
+// This file is subject to the terms and conditions defined in
+// 'LICENSE', which is part of this source code package.
+//
+
+#include "common.h"
+#include "bus/controller.h"
+#include "device/scheduler.h"
+#include "os/thread.h"
+#include "rsp/cp0.h"
+#include "rsp/cpu.h"
+#include "rsp/thread.h"
+
+enum rsp_thread_request {
+  RSP_THREAD_REQUEST_NONE,
+  RSP_THREAD_REQUEST_PENDING,
+  RSP_THREAD_REQUEST_GRANTED
+};
+
+static void rsp_thread_advance(void *opaque);
+static void *rsp_thread_main(void *opaque);
+static void rsp_thread_publish(struct rsp_thread *thread, uint64_t limit);
+static void rsp_thread_service(struct rsp_thread *thread);
+static void rsp_thread_wait(struct rsp_thread *thread, uint64_t target);
+
+// Scheduler callback: lets the RSP run up through the current cycle.
+void rsp_thread_advance(void *opaque) {
+  struct rsp *rsp = (struct rsp *) opaque;
+  struct scheduler *scheduler = rsp->bus->scheduler;
+  struct rsp_thread *thread = &rsp->thread;
+
+  // Don't let the VR4300 get more than two periods ahead.
+  rsp_thread_wait(thread, thread->published);
+  rsp_thread_publish(thread, scheduler_vr4300_to_rcp(scheduler->now + 1));
+
+  scheduler_schedule(scheduler, SCHEDULER_EVENT_RSP,
+    scheduler->now + thread->period);
+}
+
+// Parks the VR4300 thread while the RSP touches its state.
+void rsp_thread_lock_vr4300(struct rsp *rsp) {
+  struct rsp_thread *thread = &rsp->thread;
+  unsigned spins = 0;
+
+  cen64_atomic_store_u32(&thread->request, RSP_THREAD_REQUEST_PENDING);
+
+  while (cen64_atomic_load_u32(&thread->request) != RSP_THREAD_REQUEST_GRANTED)
+    cen64_thread_backoff(&spins);
+}
+
+// Cycles the RSP as the VR4300 thread allows it to.
+void *rsp_thread_main(void *opaque) {
+  struct rsp *rsp = (struct rsp *) opaque;
+  struct rsp_thread *thread = &rsp->thread;
+  uint64_t done = thread->done;
+  unsigned spins = 0;
+
+  while (!cen64_atomic_load_u32(&thread->exit)) {
+    uint64_t limit = cen64_atomic_load_u64(&thread->limit);
+
+    if (done == limit) {
+      cen64_thread_backoff(&spins);
+      continue;
+    }
+
+    spins = 0;
+    thread->in_thread = true;
+
+    while (done < limit) {
+      if (rsp->regs[RSP_CP0_REGISTER_SP_STATUS] & SP_STATUS_HALT) {
+        done = limit;
+        break;
+      }
+
+      rsp_cycle(rsp);
+      done++;
+    }
+
+    thread->in_thread = false;
+    cen64_atomic_store_u64(&thread->done, done);
+  }
+
+  cen64_atomic_store_u32(&thread->finished, 1);
+  return NULL;
+}
+
+// Allows the RSP thread to run up to (but not including) an RCP cycle.
+void rsp_thread_publish(struct rsp_thread *thread, uint64_t limit) {
+  thread->published = limit;
+  cen64_atomic_store_u64(&thread->limit, limit);
+}
+
+// Lets the RSP touch VR4300 state, if it has asked to.
+void rsp_thread_service(struct rsp_thread *thread) {
+  unsigned spins = 0;
+
+  if (cen64_atomic_load_u32(&thread->request) != RSP_THREAD_REQUEST_PENDING)
+    return;
+
+  cen64_atomic_store_u32(&thread->request, RSP_THREAD_REQUEST_GRANTED);
+
+  while (cen64_atomic_load_u32(&thread->request) != RSP_THREAD_REQUEST_NONE)
+    cen64_thread_backoff(&spins);
+}
+
+// Spawns the RSP thread. The RSP must be at the same cycle as the VR4300.
+int rsp_thread_start(struct rsp *rsp, unsigned window) {
+  struct scheduler *scheduler = rsp->bus->scheduler;
+  struct rsp_thread *thread = &rsp->thread;
+  uint64_t now = scheduler_vr4300_to_rcp(scheduler->now);
+
+  thread->period = window > 2 ? window / 2 : 1;
+  thread->published = now;
+  thread->limit = now;
+  thread->done = now;
+  thread->exit = 0;
+  thread->finished = 0;
+  thread->request = RSP_THREAD_REQUEST_NONE;
+  thread->in_thread = false;
+
+  if (cen64_thread_create(&thread->thread, rsp_thread_main, rsp)) {
+    debug("rsp_thread_start: Failed to spawn the RSP thread.\n");
+    return 1;
+  }
+
+  thread->enabled = true;
+
+  scheduler_register(scheduler, SCHEDULER_EVENT_RSP, rsp_thread_advance, rsp);
+  scheduler_schedule(scheduler, SCHEDULER_EVENT_RSP,
+    scheduler->now + thread->period);
+
+  return 0;
+}
+
+// Tells the RSP thread to exit, and waits for it to do so.
+void rsp_thread_stop(struct rsp *rsp) {
+  struct rsp_thread *thread = &rsp->thread;
+  unsigned spins = 0;
+
+  if (!thread->enabled)
+    return;
+
+  cen64_atomic_store_u32(&thread->exit, 1);
+
+  while (!cen64_atomic_load_u32(&thread->finished)) {
+    rsp_thread_service(thread);
+    cen64_thread_backoff(&spins);
+  }
+
+  cen64_thread_join(&thread->thread);
+
+  scheduler_cancel(rsp->bus->scheduler, SCHEDULER_EVENT_RSP);
+  thread->enabled = false;
+}
+
+// Brings the RSP up to the VR4300's current cycle and parks it there.
+void rsp_thread_sync(struct rsp *rsp) {
+  struct rsp_thread *thread = &rsp->thread;
+  uint64_t now = scheduler_vr4300_to_rcp(rsp->bus->scheduler->now);
+
+  if (thread->published != now)
+    rsp_thread_publish(thread, now);
+
+  rsp_thread_wait(thread, now);
+}
+
+// Releases the VR4300 thread after the RSP has touched its state.
+void rsp_thread_unlock_vr4300(struct rsp *rsp) {
+  cen64_atomic_store_u32(&rsp->thread.request, RSP_THREAD_REQUEST_NONE);
+}
+
+// Waits for the RSP thread to complete a number of cycles.
+void rsp_thread_wait(struct rsp_thread *thread, uint64_t target) {
+  unsigned spins = 0;
+
+  while (cen64_atomic_load_u64(&thread->done) < target) {
+    rsp_thread_service(thread);
+    cen64_thread_backoff(&spins);
+  }
+
+  rsp_thread_service(thread);
+}
+
@@ -0,0 +1,56 @@
+//
+// rsp/thread.h: Threaded RSP support.
+//
+// CEN64: Cycle-Accurate Nintendo 64 Simulator.
+// Copyright (C) 2014, Tyler J. Stachecki.
+//
+// This file is subject to the terms and conditions defined in
+// 'LICENSE', which is part of this source code package.
+//
+
+#ifndef __rsp_thread_h__
+#define __rsp_thread_h__
+#include "common.h"
+#include "os/thread.h"
+
+struct rsp;
+
+// When enabled, the RSP is cycled on its own host thread. The VR4300
+// thread hands out a limit (in RCP cycles) that the RSP thread may
+// run up to, and the RSP is never allowed to get ahead of the VR4300.
+// The VR4300 is allowed to get up to `window' cycles ahead of the RSP.
+//
+// Whenever the VR4300 touches RSP state (or the MI), it first lets the
+// RSP catch up to the current cycle, so those accesses see the same
+// state they would have without the thread. When the RSP touches state
+// owned by the VR4300 thread, it asks the VR4300 thread to park at its
+// next sync point; those effects land up to `window' cycles late.
+struct rsp_thread {
+  cen64_thread thread;
+  uint64_t published;
+  unsigned period;
+
+  bool enabled;
+  bool in_thread;
+
+  // Written by the VR4300 thread.
+  cen64_align(volatile uint64_t limit, CACHE_LINE_SIZE);
+  volatile uint32_t exit;
+
+  // Written by the RSP thread.
+  cen64_align(volatile uint64_t done, CACHE_LINE_SIZE);
+  volatile uint32_t finished;
+
+  // Written by both threads.
+  cen64_align(volatile uint32_t request, CACHE_LINE_SIZE);
+};
+
+cen64_cold int rsp_thread_start(struct rsp *rsp, unsigned window);
+cen64_cold void rsp_thread_stop(struct rsp *rsp);
+
+void rsp_thread_lock_vr4300(struct rsp *rsp);
+void rsp_thread_unlock_vr4300(struct rsp *rsp);
+void rsp_thread_sync(struct rsp *rsp);
+
+#endif
+
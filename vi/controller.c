@@ -12,12 +12,26 @@
 #include "bus/address.h"
 #include "bus/controller.h"
 #include "device/device.h"
+#include "device/pacer.h"
+#include "device/scheduler.h"
 #include "os/main.h"
+#include "rdp/cpu.h"
 #include "ri/controller.h"
 #include "vi/controller.h"
+#include "vi/dump.h"
+#include "vi/hash.h"
+#include "vr4300/cpu.h"
+#include "vr4300/idle.h"
 #include "vr4300/interface.h"
 
-#define VI_COUNTER_START (62500000.0 / 60.0) + 1;
+#define VI_COUNTER_START ((uint64_t) ((62500000.0 / 60.0) + 1))
+
+static uint32_t vi_get_current(const struct vi_controller *vi,
+  uint64_t rcp_cycle);
+#ifdef VR4300_BUSY_WAIT_DETECTION
+static void vi_limit_idle(struct vi_controller *vi, uint64_t rcp_cycle);
+#endif
+static void vi_schedule_refresh(struct vi_controller *vi);
 
 #ifdef DEBUG_MMIO_REGISTER_ACCESS
 const char *vi_register_mnemonics[NUM_VI_REGISTERS] = {
@@ -27,31 +41,67 @@ const char *vi_register_mnemonics[NUM_VI_REGISTERS] = {
 };
 #endif
 
+// Returns the value of VI_CURRENT as of the given RCP cycle.
+uint32_t vi_get_current(const struct vi_controller *vi, uint64_t rcp_cycle) {
+  uint32_t counter, current;
+
+  // TODO: Possibly a giant hack.
+  if (vi->regs[VI_V_SYNC_REG] == 0)
+    return 0;
+
+  counter = vi->next_refresh - rcp_cycle;
+  current = (((62500000.0f / 60.0f) + 1) - (counter)) /
+    (((62500000.0f / 60.0f) + 1) / vi->regs[VI_V_SYNC_REG]);
+
+  return current & ~0x1;
+}
+
+#ifdef VR4300_BUSY_WAIT_DETECTION
+// VI_CURRENT ticks along on its own, so don't let the VR4300 skip
+// ahead past the point at which it would read something different.
+void vi_limit_idle(struct vi_controller *vi, uint64_t rcp_cycle) {
+  uint32_t current = vi_get_current(vi, rcp_cycle);
+  uint64_t lo = rcp_cycle, hi = vi->next_refresh;
+
+  if (vi_get_current(vi, hi) == current)
+    return;
+
+  while (hi - lo > 1) {
+    uint64_t mid = lo + (hi - lo) / 2;
+
+    if (vi_get_current(vi, mid) == current)
+      lo = mid;
+
+    else
+      hi = mid;
+  }
+
+  vr4300_idle_limit(&vi->bus->vr4300->idle, scheduler_rcp_to_vr4300(lo));
+}
+#endif
+
 // Reads a word from the VI MMIO register space.
 int read_vi_regs(void *opaque, uint32_t address, uint32_t *word) {
   struct vi_controller *vi = (struct vi_controller *) opaque;
   unsigned offset = address - VI_REGS_BASE_ADDRESS;
   enum vi_register reg = (offset >> 2);
+  uint64_t now = scheduler_vr4300_to_rcp(vi->bus->scheduler->now);
 
-  // TODO: Possibly a giant hack.
-  if (vi->regs[VI_V_SYNC_REG] > 0) {
-    vi->regs[VI_CURRENT_REG] =
-      (((62500000.0f / 60.0f) + 1) - (vi->counter)) /
-      (((62500000.0f / 60.0f) + 1) / vi->regs[VI_V_SYNC_REG]);
-
-    vi->regs[VI_CURRENT_REG] &= ~0x1;
-  }
+  vi->regs[VI_CURRENT_REG] = vi_get_current(vi, now);
 
-  else
-    vi->regs[VI_CURRENT_REG] = 0;
+#ifdef VR4300_BUSY_WAIT_DETECTION
+  if (reg == VI_CURRENT_REG)
+    vi_limit_idle(vi, now);
+#endif
 
   *word = vi->regs[reg];
   debug_mmio_read(vi, vi_register_mnemonics[reg], *word);
   return 0;
 }
 
-// Advances the controller by one clock cycle.
-void vi_cycle(struct vi_controller *vi) {
+// Scheduler callback: the VI has reached the end of a field.
+void vi_refresh(void *opaque) {
+  struct vi_controller *vi = (struct vi_controller *) opaque;
   struct render_area *ra = &vi->render_area;
   int hskip, vres, hres;
   float hcoeff, vcoeff;
@@ -60,9 +110,6 @@ void vi_cycle(struct vi_controller *vi) {
   const uint8_t *buffer;
   uint32_t offset;
 
-  if (likely(vi->counter-- != 0))
-    return;
-
   offset = vi->regs[VI_ORIGIN_REG] & 0xFFFFFF;
   buffer = vi->bus->ri->ram + offset;
 
@@ -84,6 +131,16 @@ void vi_cycle(struct vi_controller *vi) {
   if (hres <= 0 || vres <= 0)
     type = 0;
 
+  // Don't show an image the RDP thread (or, without one, the band
+  // workers) could still be drawing to.
+  if (type >= 2 && vi->bus->rdp->thread.enabled) {
+    rdp_thread_scanout(&vi->bus->rdp->thread, offset,
+      (vi->regs[VI_WIDTH_REG] * vres) << (type - 1));
+  }
+
+  else if (type >= 2 && vi->bus->rdp->workers != NULL)
+    rdp_workers_flush(vi->bus->rdp->workers);
+
   // Interact with the user interface?
   if (likely(vi->gl_window.window)) {
     if (os_exit_requested(&vi->gl_window))
@@ -95,20 +152,48 @@ void vi_cycle(struct vi_controller *vi) {
   else if (device_exit_requested)
     device_exit(vi->bus);
 
+  if (vi->dump != NULL) {
+    vi_dump_frame(vi->dump, buffer, offset < DEVICE_RAMSIZE ?
+      DEVICE_RAMSIZE - offset : 0, hres, vres, hskip, type,
+      vi->regs[VI_V_SYNC_REG]);
+  }
+
+  if (vi->hash_log != NULL) {
+    vi_hash_log_frame(vi, buffer, offset < DEVICE_RAMSIZE ?
+      DEVICE_RAMSIZE - offset : 0, hres, vres, hskip, type);
+  }
+
+  if (vi->pacer != NULL)
+    pacer_refresh(vi->pacer, vi->next_refresh);
+
   // Raise an interrupt to indicate refresh.
   signal_rcp_interrupt(vi->bus->vr4300, MI_INTR_VI);
-  vi->counter = VI_COUNTER_START;
+
+  if (unlikely(++vi->frame_count == vi->frame_limit))
+    device_exit(vi->bus);
+
+  vi->next_refresh += 1 + VI_COUNTER_START;
+  vi_schedule_refresh(vi);
 }
 
 // Initializes the VI.
 int vi_init(struct vi_controller *vi,
   struct bus_controller *bus) {
-  vi->counter = VI_COUNTER_START;
+  vi->next_refresh = VI_COUNTER_START;
   vi->bus = bus;
 
+  scheduler_register(bus->scheduler, SCHEDULER_EVENT_VI, vi_refresh, vi);
+  vi_schedule_refresh(vi);
+
   return 0;
 }
 
+// Queues the next refresh with the device scheduler.
+void vi_schedule_refresh(struct vi_controller *vi) {
+  scheduler_schedule(vi->bus->scheduler, SCHEDULER_EVENT_VI,
+    scheduler_rcp_to_vr4300(vi->next_refresh));
+}
+
 // Writes a word to the VI MMIO register space.
 int write_vi_regs(void *opaque, uint32_t address, uint32_t word, uint32_t dqm) {
   struct vi_controller *vi = (struct vi_controller *) opaque;
@@ -12,6 +12,9 @@
 #define __vi_controller_h__
 #include "common.h"
 #include "os/gl_window.h"
+#include "vi/dump.h"
+
+struct pacer;
 
 struct bus_controller *bus;
 
@@ -48,8 +51,22 @@ struct vi_controller {
   struct bus_controller *bus;
   uint32_t regs[NUM_VI_REGISTERS];
 
-  uint32_t counter;
+  // RCP cycle on which the current field ends.
+  uint64_t next_refresh;
+
+  // Number of VI interrupts raised, and when to stop (if nonzero).
+  uint64_t frame_count;
+  uint64_t frame_limit;
   struct render_area render_area;
+
+  // If set, every frame also gets written out here.
+  struct vi_dump *dump;
+
+  // If set, the hash of every frame gets logged here.
+  FILE *hash_log;
+
+  // If set, keeps the device from running faster than it should.
+  struct pacer *pacer;
 };
 
 cen64_cold void gl_window_init(struct gl_window *window);
@@ -58,7 +75,7 @@ void gl_window_render_frame(struct gl_window *gl_window, const uint8_t *buffer,
 
 cen64_cold int vi_init(struct vi_controller *vi, struct bus_controller *bus);
 
-cen64_flatten cen64_hot void vi_cycle(struct vi_controller *vi);
+cen64_flatten void vi_refresh(void *opaque);
 
 cen64_cold int read_vi_regs(void *opaque, uint32_t address, uint32_t *word);
 cen64_cold int write_vi_regs(void *opaque, uint32_t address, uint32_t word, uint32_t dqm);
@@ -0,0 +1,356 @@
+//
+// vi/dump.c: Video interface frame dumps.
+//
+// CEN64: Cycle-Accurate Nintendo 64 Simulator.
+// Copyright (C) 2014, Tyler J. Stachecki.
+//
+// This file is subject to the terms and conditions defined in
+// 'LICENSE', which is part of this source code package.
+//
+
+#include "common.h"
+#include "os/gl_window.h"
+#include "os/thread.h"
+#include "vi/controller.h"
+#include "vi/dump.h"
+#include "vi/vi.h"
+#include <ctype.h>
+
+#ifdef _WIN32
+#include <io.h>
+#define dup _dup
+#define fdopen _fdopen
+#else
+#include <unistd.h>
+#endif
+
+static void vi_dump_convert(uint32_t *dest, const uint8_t *src,
+  unsigned count, unsigned type);
+static bool vi_dump_has_suffix(const char *target, const char *suffix);
+static void *vi_dump_main(void *opaque);
+static FILE *vi_dump_open(const char *target, enum vi_dump_format *format);
+static void vi_dump_write(struct vi_dump *dump, const uint32_t *slot,
+  bool first);
+
+// Converts a row of the frame to xRGB8888.
+void vi_dump_convert(uint32_t *dest, const uint8_t *src,
+  unsigned count, unsigned type) {
+  unsigned i = 0;
+
+#ifdef VI_VECT_KERNELS
+  i = count & ~0x7;
+
+  if (type == 2)
+    vi_vect_rgba5551_to_xrgb8888(dest, src, i);
+  else
+    vi_vect_rgba8888_to_xrgb8888(dest, src, i);
+#endif
+
+  for (; i < count; i++) {
+    unsigned r, g, b;
+
+    if (type == 2) {
+      unsigned pixel = src[i * 2] << 8 | src[i * 2 + 1];
+
+      r = pixel >> 11 & 0x1F;
+      g = pixel >> 6 & 0x1F;
+      b = pixel >> 1 & 0x1F;
+
+      r = r << 3 | r >> 2;
+      g = g << 3 | g >> 2;
+      b = b << 3 | b >> 2;
+    }
+
+    else {
+      r = src[i * 4];
+      g = src[i * 4 + 1];
+      b = src[i * 4 + 2];
+    }
+
+    dest[i] = r << 16 | g << 8 | b;
+  }
+}
+
+// Converts a frame into the next slot of the ring and hands it over.
+void vi_dump_frame(struct vi_dump *dump, const uint8_t *buffer,
+  size_t length, unsigned hres, unsigned vres, unsigned hskip, unsigned type,
+  uint32_t v_sync) {
+  unsigned bpp = type == 2 ? 2 : 4;
+  size_t stride = (size_t) (hres + hskip) * bpp;
+  unsigned x, y, last_sy;
+  uint32_t *slot;
+  bool blank;
+
+  blank = type < 2 || hres == 0 || vres == 0 || hres + hskip < hres ||
+    (size_t) hres * vres * 4 > MAX_FRAME_DATA_SIZE ||
+    stride * vres > length;
+
+  // Nothing gets written out until there's something to see.
+  if (dump->width == 0) {
+    if (blank)
+      return;
+
+    dump->width = hres;
+    dump->height = vres;
+    dump->slot_size = (size_t) hres * vres;
+
+    // PAL modes have 625 lines a frame; NTSC and MPAL have 525.
+    dump->rate = (v_sync & 0x3FF) > 575 ? 50 : 60;
+  }
+
+  cen64_mutex_lock(&dump->lock);
+
+  if (dump->head - dump->tail == VI_DUMP_SLOTS) {
+    dump->stalls++;
+
+    while (dump->head - dump->tail == VI_DUMP_SLOTS)
+      cen64_cv_wait(&dump->space_cv, &dump->lock);
+  }
+
+  cen64_mutex_unlock(&dump->lock);
+  slot = dump->slots + (dump->head % VI_DUMP_SLOTS) * dump->slot_size;
+
+  if (blank)
+    memset(slot, 0, dump->slot_size * sizeof(*slot));
+
+  else {
+    if (hres != dump->width && dump->xmap_hres != hres) {
+      for (x = 0; x < dump->width; x++)
+        dump->xmap[x] = x * hres / dump->width;
+
+      dump->xmap_hres = hres;
+    }
+
+    for (last_sy = ~0U, y = 0; y < dump->height; y++) {
+      unsigned sy = y * vres / dump->height;
+      uint32_t *dest = slot + y * dump->width;
+
+      if (sy == last_sy)
+        memcpy(dest, dest - dump->width, dump->width * sizeof(*dest));
+
+      else if (hres == dump->width)
+        vi_dump_convert(dest, buffer + sy * stride, hres, type);
+
+      else {
+        vi_dump_convert(dump->row, buffer + sy * stride, hres, type);
+
+        for (x = 0; x < dump->width; x++)
+          dest[x] = dump->row[dump->xmap[x]];
+      }
+
+      last_sy = sy;
+    }
+  }
+
+  cen64_mutex_lock(&dump->lock);
+  dump->head++;
+  cen64_cv_signal(&dump->ready_cv);
+  cen64_mutex_unlock(&dump->lock);
+}
+
+// Checks if the target ends with the (lowercase) suffix.
+bool vi_dump_has_suffix(const char *target, const char *suffix) {
+  size_t length = strlen(target), suffix_length = strlen(suffix);
+  size_t i;
+
+  if (length < suffix_length)
+    return false;
+
+  for (i = 0; i < suffix_length; i++) {
+    if (tolower((unsigned char) target[length - suffix_length + i]) !=
+      suffix[i])
+      return false;
+  }
+
+  return true;
+}
+
+// Writes out frames as they're handed over.
+void *vi_dump_main(void *opaque) {
+  struct vi_dump *dump = (struct vi_dump *) opaque;
+
+  while (1) {
+    const uint32_t *slot;
+    uint64_t tail;
+
+    cen64_mutex_lock(&dump->lock);
+
+    while (dump->head == dump->tail && !dump->exit)
+      cen64_cv_wait(&dump->ready_cv, &dump->lock);
+
+    if (dump->head == dump->tail) {
+      cen64_mutex_unlock(&dump->lock);
+      break;
+    }
+
+    tail = dump->tail;
+    cen64_mutex_unlock(&dump->lock);
+
+    // Keep draining the ring if the output went away.
+    slot = dump->slots + (tail % VI_DUMP_SLOTS) * dump->slot_size;
+
+    if (!dump->failed)
+      vi_dump_write(dump, slot, tail == 0);
+
+    cen64_mutex_lock(&dump->lock);
+    dump->tail++;
+    cen64_cv_signal(&dump->space_cv);
+    cen64_mutex_unlock(&dump->lock);
+  }
+
+  return NULL;
+}
+
+// Opens the target, which is either a path or a file descriptor. Raw
+// dumps go to paths ending with .rgba or .raw; everything else is Y4M.
+FILE *vi_dump_open(const char *target, enum vi_dump_format *format) {
+  const char *c;
+  int fd;
+
+  for (c = target; isdigit((unsigned char) *c); c++);
+
+  if (*target != '\0' && *c == '\0') {
+    *format = VI_DUMP_Y4M;
+
+    // Work on a copy, so closing the dump leaves the descriptor be.
+    if ((fd = dup(atoi(target))) < 0)
+      return NULL;
+
+    return fdopen(fd, "wb");
+  }
+
+  *format = vi_dump_has_suffix(target, ".rgba") ||
+    vi_dump_has_suffix(target, ".raw") ? VI_DUMP_RGBA : VI_DUMP_Y4M;
+
+  return fopen(target, "wb");
+}
+
+// Packs a frame into the output format and writes it out.
+void vi_dump_write(struct vi_dump *dump, const uint32_t *slot, bool first) {
+  size_t i, count = dump->slot_size;
+  uint8_t *packed = dump->packed;
+  size_t size;
+
+  if (dump->format == VI_DUMP_RGBA) {
+    for (i = 0; i < count; i++) {
+      packed[i * 4 + 0] = slot[i] >> 16;
+      packed[i * 4 + 1] = slot[i] >> 8;
+      packed[i * 4 + 2] = slot[i];
+      packed[i * 4 + 3] = 0xFF;
+    }
+
+    size = count * 4;
+  }
+
+  // 4:4:4 planes, using the studio-swing BT.601 matrix.
+  else {
+    uint8_t *y = packed, *u = packed + count, *v = packed + count * 2;
+
+    if (first) {
+      fprintf(dump->file, "YUV4MPEG2 W%u H%u F%u:1 Ip A1:1 C444\n",
+        dump->width, dump->height, dump->rate);
+    }
+
+    for (i = 0; i < count; i++) {
+      int r = slot[i] >> 16 & 0xFF;
+      int g = slot[i] >> 8 & 0xFF;
+      int b = slot[i] & 0xFF;
+
+      y[i] = (66 * r + 129 * g + 25 * b + 4224) >> 8;
+      u[i] = (-38 * r - 74 * g + 112 * b + 32896) >> 8;
+      v[i] = (112 * r - 94 * g - 18 * b + 32896) >> 8;
+    }
+
+    fputs("FRAME\n", dump->file);
+    size = count * 3;
+  }
+
+  if (fwrite(packed, size, 1, dump->file) != 1) {
+    fprintf(stderr, "Failed to write a frame to the dump; stopping.\n");
+    dump->failed = true;
+  }
+}
+
+// Starts writing every VI frame out to a file (or descriptor).
+int vi_dump_start(struct vi_controller *vi, const char *target) {
+  size_t max_pixels = MAX_FRAME_DATA_SIZE / 4;
+  struct vi_dump *dump;
+
+  if ((dump = (struct vi_dump *) calloc(1, sizeof(*dump))) == NULL)
+    return 1;
+
+  dump->slots = (uint32_t *) malloc(
+    VI_DUMP_SLOTS * max_pixels * sizeof(*dump->slots));
+  dump->row = (uint32_t *) malloc(max_pixels * sizeof(*dump->row));
+  dump->xmap = (unsigned *) malloc(max_pixels * sizeof(*dump->xmap));
+  dump->packed = (uint8_t *) malloc(MAX_FRAME_DATA_SIZE);
+
+  if (dump->slots == NULL || dump->row == NULL ||
+    dump->xmap == NULL || dump->packed == NULL)
+    goto start_out_free;
+
+  if ((dump->file = vi_dump_open(target, &dump->format)) == NULL)
+    goto start_out_free;
+
+  if (cen64_mutex_create(&dump->lock))
+    goto start_out_close;
+
+  if (cen64_cv_create(&dump->ready_cv))
+    goto start_out_lock;
+
+  if (cen64_cv_create(&dump->space_cv))
+    goto start_out_ready_cv;
+
+  if (cen64_thread_create(&dump->thread, vi_dump_main, dump))
+    goto start_out_space_cv;
+
+  vi->dump = dump;
+  return 0;
+
+start_out_space_cv:
+  cen64_cv_destroy(&dump->space_cv);
+start_out_ready_cv:
+  cen64_cv_destroy(&dump->ready_cv);
+start_out_lock:
+  cen64_mutex_destroy(&dump->lock);
+start_out_close:
+  fclose(dump->file);
+start_out_free:
+  free(dump->packed);
+  free(dump->xmap);
+  free(dump->row);
+  free(dump->slots);
+  free(dump);
+  return 1;
+}
+
+// Writes out any frames still in the ring and closes the dump.
+void vi_dump_stop(struct vi_controller *vi) {
+  struct vi_dump *dump = vi->dump;
+
+  if (dump == NULL)
+    return;
+
+  cen64_mutex_lock(&dump->lock);
+  dump->exit = true;
+  cen64_cv_signal(&dump->ready_cv);
+  cen64_mutex_unlock(&dump->lock);
+  cen64_thread_join(&dump->thread);
+
+  if (dump->stalls > 0)
+    debug("vi_dump_stop: Waited on the writer %lu times.\n",
+      (unsigned long) dump->stalls);
+
+  cen64_cv_destroy(&dump->space_cv);
+  cen64_cv_destroy(&dump->ready_cv);
+  cen64_mutex_destroy(&dump->lock);
+  fclose(dump->file);
+
+  free(dump->packed);
+  free(dump->xmap);
+  free(dump->row);
+  free(dump->slots);
+  free(dump);
+  vi->dump = NULL;
+}
+
@@ -0,0 +1,74 @@
+//
+// vi/dump.h: Video interface frame dumps.
+//
+// CEN64: Cycle-Accurate Nintendo 64 Simulator.
+// Copyright (C) 2014, Tyler J. Stachecki.
+//
+// This file is subject to the terms and conditions defined in
+// 'LICENSE', which is part of this source code package.
+//
+
+#ifndef __vi_dump_h__
+#define __vi_dump_h__
+#include "common.h"
+#include "os/thread.h"
+#include <stdio.h>
+
+#define VI_DUMP_SLOTS 8
+
+enum vi_dump_format {
+  VI_DUMP_Y4M,
+  VI_DUMP_RGBA,
+};
+
+struct vi_controller;
+
+// Every VI refresh becomes one frame of the dump. The size of the dump
+// is set by the first frame that has an image; later frames of another
+// size are scaled to it (nearest neighbour), and fields without an
+// image come out black.
+//
+// Frames are converted on the thread running the device into a ring of
+// xRGB8888 slots, then packed into the output format and written out by
+// a thread of their own. The device only waits if the ring fills up.
+struct vi_dump {
+  FILE *file;
+  enum vi_dump_format format;
+  bool failed;
+
+  cen64_thread thread;
+  cen64_mutex lock;
+  cen64_cv ready_cv;
+  cen64_cv space_cv;
+
+  // Slot ring (allocated up front, big enough for the largest frame),
+  // and the size and rate of the dump once they're known.
+  uint32_t *slots;
+  unsigned width, height, rate;
+  size_t slot_size;
+
+  // Used only by the thread running the device.
+  uint32_t *row;
+  unsigned *xmap;
+  unsigned row_size;
+  unsigned xmap_hres;
+  uint64_t stalls;
+
+  // Used only by the writer thread.
+  uint8_t *packed;
+
+  // Protected by the lock.
+  uint64_t head;
+  uint64_t tail;
+  bool exit;
+};
+
+cen64_cold int vi_dump_start(struct vi_controller *vi, const char *target);
+cen64_cold void vi_dump_stop(struct vi_controller *vi);
+
+void vi_dump_frame(struct vi_dump *dump, const uint8_t *buffer,
+  size_t length, unsigned hres, unsigned vres, unsigned hskip, unsigned type,
+  uint32_t v_sync);
+
+#endif
+
@@ -0,0 +1,122 @@
+//
+// vi/hash.c: Video interface frame hashing.
+//
+// CEN64: Cycle-Accurate Nintendo 64 Simulator.
+// Copyright (C) 2014, Tyler J. Stachecki.
+//
+// This file is subject to the terms and conditions defined in
+// 'LICENSE', which is part of this source code package.
+//
+
+#include "common.h"
+#include "vi/controller.h"
+#include "vi/hash.h"
+
+#define VI_HASH_BASIS 0xCBF29CE484222325ULL
+#define VI_HASH_PRIME 0x100000001B3ULL
+
+static inline uint64_t vi_hash_fold(uint64_t hash, uint64_t word);
+static inline uint64_t vi_hash_load(const uint8_t *bytes);
+static void vi_hash_row(uint64_t *lanes, const uint8_t *row,
+  size_t length);
+
+// Folds a word into a hash.
+uint64_t vi_hash_fold(uint64_t hash, uint64_t word) {
+  hash = (hash ^ word) * VI_HASH_PRIME;
+  return hash ^ (hash >> 29);
+}
+
+// Loads a word as little-endian, so that hashes match across hosts.
+uint64_t vi_hash_load(const uint8_t *bytes) {
+  uint64_t word;
+
+  memcpy(&word, bytes, sizeof(word));
+
+#ifdef BIG_ENDIAN_HOST
+  word = __builtin_bswap64(word);
+#endif
+
+  return word;
+}
+
+// Folds a row into the lanes. Whole 32-byte blocks are spread across
+// all four lanes, so the multiplies don't have to wait on each other;
+// the rest (zero-padded out to a word) goes into the first lane.
+void vi_hash_row(uint64_t *lanes, const uint8_t *row, size_t length) {
+  uint8_t tail[8];
+  size_t i;
+
+  for (i = 0; i + 32 <= length; i += 32) {
+    lanes[0] = vi_hash_fold(lanes[0], vi_hash_load(row + i));
+    lanes[1] = vi_hash_fold(lanes[1], vi_hash_load(row + i + 8));
+    lanes[2] = vi_hash_fold(lanes[2], vi_hash_load(row + i + 16));
+    lanes[3] = vi_hash_fold(lanes[3], vi_hash_load(row + i + 24));
+  }
+
+  for (; i < length; i += 8) {
+    size_t count = length - i < 8 ? length - i : 8;
+
+    memset(tail, 0, sizeof(tail));
+    memcpy(tail, row + i, count);
+    lanes[0] = vi_hash_fold(lanes[0], vi_hash_load(tail));
+  }
+}
+
+// Hashes the part of the frame that's on screen.
+uint64_t vi_hash_frame(const uint8_t *buffer, size_t length,
+  unsigned hres, unsigned vres, unsigned hskip, unsigned type) {
+  unsigned bpp = type == 2 ? 2 : 4;
+  size_t stride = (size_t) (hres + hskip) * bpp;
+  uint64_t lanes[4], hash;
+  unsigned i, y;
+
+  if (type < 2 || hres == 0 || vres == 0 ||
+    hres + hskip < hres || stride * vres > length)
+    hres = vres = type = 0;
+
+  hash = vi_hash_fold(VI_HASH_BASIS, (uint64_t) type << 48 |
+    (uint64_t) vres << 24 | hres);
+
+  for (i = 0; i < 4; i++)
+    lanes[i] = vi_hash_fold(hash, i);
+
+  for (y = 0; y < vres; y++)
+    vi_hash_row(lanes, buffer + y * stride, (size_t) hres * bpp);
+
+  for (i = 0; i < 4; i++)
+    hash = vi_hash_fold(hash, lanes[i]);
+
+  // Make sure every bit of the lanes has a say in every bit of the hash.
+  hash ^= hash >> 33;
+  hash *= 0xFF51AFD7ED558CCDULL;
+  hash ^= hash >> 33;
+  hash *= 0xC4CEB9FE1A85EC53ULL;
+  return hash ^ (hash >> 33);
+}
+
+// Writes the hash of a frame out to the log.
+void vi_hash_log_frame(struct vi_controller *vi, const uint8_t *buffer,
+  size_t length, unsigned hres, unsigned vres, unsigned hskip, unsigned type) {
+  uint64_t hash = vi_hash_frame(buffer, length, hres, vres, hskip, type);
+
+  fprintf(vi->hash_log, "%lu %08x%08x\n", (unsigned long) vi->frame_count,
+    (uint32_t) (hash >> 32), (uint32_t) hash);
+}
+
+// Starts logging the hash of every VI frame.
+int vi_hash_log_start(struct vi_controller *vi, const char *path) {
+  if ((vi->hash_log = fopen(path, "w")) == NULL)
+    return 1;
+
+  return 0;
+}
+
+// Closes the hash log.
+void vi_hash_log_stop(struct vi_controller *vi) {
+  if (vi->hash_log == NULL)
+    return;
+
+  fclose(vi->hash_log);
+  vi->hash_log = NULL;
+}
+
@@ -0,0 +1,31 @@
+//
+// vi/hash.h: Video interface frame hashing.
+//
+// CEN64: Cycle-Accurate Nintendo 64 Simulator.
+// Copyright (C) 2014, Tyler J. Stachecki.
+//
+// This file is subject to the terms and conditions defined in
+// 'LICENSE', which is part of this source code package.
+//
+
+#ifndef __vi_hash_h__
+#define __vi_hash_h__
+#include "common.h"
+
+struct vi_controller;
+
+// A hash log has a line for each VI refresh: the frame index, then a
+// 64-bit hash (in hex) of what was on screen. The hash covers the size
+// and type of the frame, and the visible pixels of each row (but not
+// the hskip pixels that follow them). Fields without an image only
+// hash their size and type. Logs compare equal across hosts.
+cen64_cold int vi_hash_log_start(struct vi_controller *vi, const char *path);
+cen64_cold void vi_hash_log_stop(struct vi_controller *vi);
+
+uint64_t vi_hash_frame(const uint8_t *buffer, size_t length,
+  unsigned hres, unsigned vres, unsigned hskip, unsigned type);
+void vi_hash_log_frame(struct vi_controller *vi, const uint8_t *buffer,
+  size_t length, unsigned hres, unsigned vres, unsigned hskip, unsigned type);
+
+#endif
+
@@ -12,6 +12,9 @@
 #include "os/gl_window.h"
 #include "os/main.h"
 
+// Without OpenGL, frames are presented by the platform code alone.
+#ifdef CEN64_OPENGL
+
 // Initializes OpenGL to an default state.
 void gl_window_init(struct gl_window *window) {
   glDisable(GL_DEPTH_TEST);
@@ -98,4 +101,5 @@ void gl_window_resize_cb(int width, int height) {
 
   glClear(GL_COLOR_BUFFER_BIT);
 }
+#endif
 
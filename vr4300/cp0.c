@@ -9,6 +9,8 @@
 //
 
 #include "common.h"
+#include "bus/controller.h"
+#include "device/scheduler.h"
 #include "tlb/tlb.h"
 #include "vr4300/cp0.h"
 #include "vr4300/cpu.h"
@@ -52,6 +54,48 @@ static inline uint64_t mask_reg(unsigned reg, uint64_t data) {
   return vr4300_cp0_reg_masks[reg] & data;
 };
 
+static void vr4300_cp0_compare_event(void *opaque);
+static void vr4300_cp0_schedule_compare(struct vr4300 *vr4300, uint64_t from);
+static void vr4300_cp0_set_count(struct vr4300 *vr4300, uint64_t count);
+
+// Raises IP7 just ahead of the cycle on which Count matches Compare.
+void vr4300_cp0_compare_event(void *opaque) {
+  struct vr4300 *vr4300 = (struct vr4300 *) opaque;
+
+  vr4300->regs[VR4300_CP0_REGISTER_CAUSE] |= 0x8000;
+  vr4300_cp0_schedule_compare(vr4300, vr4300->bus->scheduler->now + 2);
+}
+
+// Returns the value of Count as seen by the current cycle.
+uint32_t vr4300_cp0_get_count(const struct vr4300 *vr4300) {
+  return (vr4300->bus->scheduler->now + vr4300->cp0.count_offset) >> 1;
+}
+
+// Arms the Compare event for the first matching cycle at or after
+// the given one. Count runs at half the pipeline clock, so each match
+// spans two cycles, and the next one is 2^33 cycles down the road.
+void vr4300_cp0_schedule_compare(struct vr4300 *vr4300, uint64_t from) {
+  struct scheduler *scheduler = vr4300->bus->scheduler;
+  uint64_t compare = (uint32_t) vr4300->regs[VR4300_CP0_REGISTER_COMPARE];
+  uint64_t delta = ((compare << 1) - (from + vr4300->cp0.count_offset))
+    & 0x1FFFFFFFFULL;
+
+  if (delta == 0x1FFFFFFFFULL)
+    delta = 0;
+
+  // Events are serviced at the end of a cycle, so use the one before.
+  if (from + delta == 0)
+    vr4300->regs[VR4300_CP0_REGISTER_CAUSE] |= 0x8000;
+
+  else
+    scheduler_schedule(scheduler, SCHEDULER_EVENT_COMPARE, from + delta - 1);
+}
+
+// Sets the (double-rate) value of Count for the current cycle.
+void vr4300_cp0_set_count(struct vr4300 *vr4300, uint64_t count) {
+  vr4300->cp0.count_offset = count - vr4300->bus->scheduler->now;
+}
+
 //
 // DMFC0
 //
@@ -61,10 +105,8 @@ int VR4300_DMFC0(struct vr4300 *vr4300,
   unsigned dest = GET_RT(iw);
   unsigned src = GET_RD(iw);
 
-  if (src == (VR4300_CP0_REGISTER_COUNT - 32)) {
-    exdc_latch->result = (uint32_t)
-      (vr4300->regs[VR4300_CP0_REGISTER_COUNT] >> 1);
-  }
+  if (src == (VR4300_CP0_REGISTER_COUNT - 32))
+    exdc_latch->result = vr4300_cp0_get_count(vr4300);
 
   else
     exdc_latch->result = mask_reg(src, vr4300->regs[32 + src]);
@@ -83,7 +125,18 @@ int VR4300_DMTC0(struct vr4300 *vr4300,
   if (dest == VR4300_CP0_REGISTER_COMPARE)
     vr4300->regs[VR4300_CP0_REGISTER_CAUSE] &= ~0x8000;
 
+  else if (dest == VR4300_CP0_REGISTER_COUNT)
+    vr4300_cp0_set_count(vr4300, rt);
+
+  vr4300_pipeline_flush_fetch(&vr4300->pipeline);
   vr4300->regs[dest] = rt;
+
+  if (dest == VR4300_CP0_REGISTER_COMPARE ||
+    dest == VR4300_CP0_REGISTER_COUNT) {
+    vr4300_cp0_schedule_compare(vr4300,
+      vr4300->bus->scheduler->now + 1);
+  }
+
   return 0;
 }
 
@@ -122,6 +175,7 @@ int VR4300_ERET(struct vr4300 *vr4300,
 
   pipeline->icrf_latch.segment = get_segment(icrf_latch->pc, status);
   pipeline->exdc_latch.segment = get_default_segment();
+  vr4300_pipeline_flush_fetch(pipeline);
   // vr4300->llbit = 0;
   return 1;
 }
@@ -135,10 +189,8 @@ int VR4300_MFC0(struct vr4300 *vr4300,
   unsigned dest = GET_RT(iw);
   unsigned src = GET_RD(iw);
 
-  if (src == (VR4300_CP0_REGISTER_COUNT - 32)) {
-    exdc_latch->result = (uint32_t)
-      (vr4300->regs[VR4300_CP0_REGISTER_COUNT] >> 1);
-  }
+  if (src == (VR4300_CP0_REGISTER_COUNT - 32))
+    exdc_latch->result = vr4300_cp0_get_count(vr4300);
 
   else
     exdc_latch->result = mask_reg(src, vr4300->regs[32 + src]);
@@ -159,12 +211,23 @@ int VR4300_MTC0(struct vr4300 *vr4300,
   if (dest == VR4300_CP0_REGISTER_COMPARE)
     vr4300->regs[VR4300_CP0_REGISTER_CAUSE] &= ~0x8000;
 
+  else if (dest == VR4300_CP0_REGISTER_COUNT)
+    vr4300_cp0_set_count(vr4300, (int32_t) rt);
+
   else if (dest == VR4300_CP0_REGISTER_STATUS) {
     icrf_latch->segment = get_segment(icrf_latch->common.pc, rt);
     exdc_latch->segment = get_default_segment();
   }
 
+  vr4300_pipeline_flush_fetch(&vr4300->pipeline);
   vr4300->regs[dest] = (int32_t) rt;
+
+  if (dest == VR4300_CP0_REGISTER_COMPARE ||
+    dest == VR4300_CP0_REGISTER_COUNT) {
+    vr4300_cp0_schedule_compare(vr4300,
+      vr4300->bus->scheduler->now + 1);
+  }
+
   return 0;
 }
 
@@ -203,6 +266,7 @@ int VR4300_TLBR(struct vr4300 *vr4300,
   vr4300->regs[VR4300_CP0_REGISTER_ENTRYLO0] = (pfn0 >> 6) | state0;
   vr4300->regs[VR4300_CP0_REGISTER_ENTRYLO1] = (pfn1 >> 6) | state1;
   vr4300->regs[VR4300_CP0_REGISTER_PAGEMASK] = page_mask;
+  vr4300_pipeline_flush_fetch(&vr4300->pipeline);
   return 0;
 }
 
@@ -224,6 +288,7 @@ int VR4300_TLBWI(struct vr4300 *vr4300,
   vr4300->cp0.pfn[index][1] = (entry_lo_1 << 6) & ~0xFFFU;
   vr4300->cp0.state[index][0] = entry_lo_0 & 0x3F;
   vr4300->cp0.state[index][1] = entry_lo_1 & 0x3F;
+  vr4300_pipeline_flush_fetch(&vr4300->pipeline);
   return 0;
 }
 
@@ -246,11 +311,22 @@ int VR4300_TLBWR(struct vr4300 *vr4300,
   vr4300->cp0.pfn[index][1] = (entry_lo_1 << 6) & ~0xFFFU;
   vr4300->cp0.state[index][0] = entry_lo_0 & 0x3F;
   vr4300->cp0.state[index][1] = entry_lo_1 & 0x3F;
+  vr4300_pipeline_flush_fetch(&vr4300->pipeline);
   return 0;
 }
 
 // Initializes the coprocessor.
 void vr4300_cp0_init(struct vr4300 *vr4300) {
+  struct scheduler *scheduler = vr4300->bus->scheduler;
+
   tlb_init(&vr4300->cp0.tlb);
+
+  // Count reads as 1 on the very first cycle.
+  vr4300_cp0_set_count(vr4300, 1);
+
+  scheduler_register(scheduler, SCHEDULER_EVENT_COMPARE,
+    vr4300_cp0_compare_event, vr4300);
+
+  vr4300_cp0_schedule_compare(vr4300, scheduler->now);
 }
 
@@ -21,6 +21,10 @@ struct vr4300_cp0 {
   uint32_t page_mask[32];
   uint32_t pfn[32][2];
   uint8_t state[32][2];
+
+  // Count isn't stepped every cycle; the (double-rate) value it holds
+  // on any given cycle is that cycle's timestamp plus this offset.
+  uint64_t count_offset;
 };
 
 // Registers list.
@@ -64,6 +68,7 @@ int VR4300_TLBWI(struct vr4300 *vr4300, uint32_t iw, uint64_t rs, uint64_t rt);
 int VR4300_TLBWR(struct vr4300 *vr4300, uint32_t iw, uint64_t rs, uint64_t rt);
 
 cen64_cold void vr4300_cp0_init(struct vr4300 *vr4300);
+uint32_t vr4300_cp0_get_count(const struct vr4300 *vr4300);
 
 #endif
 
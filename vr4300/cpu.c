@@ -13,6 +13,7 @@
 #include "vr4300/cp1.h"
 #include "vr4300/cpu.h"
 #include "vr4300/icache.h"
+#include "vr4300/idle.h"
 #include "vr4300/pipeline.h"
 
 #ifdef DEBUG_MMIO_REGISTER_ACCESS
@@ -38,6 +39,7 @@ int vr4300_init(struct vr4300 *vr4300, struct bus_controller *bus) {
 
   vr4300_dcache_init(&vr4300->dcache);
   vr4300_icache_init(&vr4300->icache);
+  vr4300_idle_init(&vr4300->idle);
 
   vr4300_pipeline_init(&vr4300->pipeline);
   vr4300->signals = VR4300_SIGNAL_COLDRESET;
@@ -15,6 +15,7 @@
 #include "vr4300/cp1.h"
 #include "vr4300/dcache.h"
 #include "vr4300/icache.h"
+#include "vr4300/idle.h"
 #include "vr4300/opcodes.h"
 #include "vr4300/pipeline.h"
 
@@ -71,8 +72,7 @@ enum vr4300_register {
   // Pipeline cycle type flag.
   //
   // Putting these here along with the other registers allows us to
-  // correctly (and cheaply) detect that a busy-wait loop instruction
-  // is retiring.
+  // cheaply change the cycle type from within the pipeline.
   PIPELINE_CYCLE_TYPE,
 
   NUM_VR4300_REGISTERS
@@ -102,6 +102,7 @@ struct vr4300 {
   struct vr4300_dcache dcache;
   struct vr4300_icache icache;
 
+  struct vr4300_idle idle;
 };
 
 struct vr4300_stats {
@@ -43,5 +43,18 @@ uint32_t vr4300_dcache_get_taglo(struct vr4300_dcache *dcache,
 void vr4300_dcache_set_taglo(struct vr4300_dcache *dcache,
   uint64_t vaddr, uint32_t tag);
 
+// Lines hold their doublewords in host order; the bus deals in words
+// by ascending address. The conversion is its own inverse.
+static inline void vr4300_dcache_swap_words(uint32_t data[4]) {
+#if WORD_ADDR_XOR
+  uint32_t temp;
+
+  temp = data[0]; data[0] = data[1]; data[1] = temp;
+  temp = data[2]; data[2] = data[3]; data[3] = temp;
+#else
+  (void) data;
+#endif
+}
+
 #endif
 
@@ -179,6 +179,7 @@ void vr4300_exception_epilogue(struct vr4300 *vr4300,
   // Reset the segment ptrs as we might change access level.
   pipeline->icrf_latch.segment = get_default_segment();
   pipeline->exdc_latch.segment = get_default_segment();
+  vr4300_pipeline_flush_fetch(pipeline);
 
   // Reset the exception history count, signal the presence
   // of a fault, and stall for the mandatory cycle count.
@@ -228,7 +229,6 @@ void VR4300_DCB(struct vr4300 *vr4300) {
   uint32_t paddr = request->paddr;
   struct vr4300_dcache_line *line;
   uint32_t data[4];
-  unsigned i;
 
   if (!exdc_latch->cached) {
     unsigned mask = request->access_type ==
@@ -285,10 +285,8 @@ void VR4300_DCB(struct vr4300 *vr4300) {
 
     bus_address = vr4300_dcache_get_tag(line, vaddr);
     memcpy(data, line->data, sizeof(data));
-
-    for (i = 0; i < 4; i++)
-      bus_write_word(vr4300, bus_address + i * 4,
-        data[i ^ (WORD_ADDR_XOR >> 2)], ~0);
+    vr4300_dcache_swap_words(data);
+    bus_write_block(vr4300, bus_address, data, 4);
   }
 
   // Raise interlock condition, get virtual address.
@@ -296,16 +294,15 @@ void VR4300_DCB(struct vr4300 *vr4300) {
   paddr &= ~0xF;
 
   // Fill the cache line.
-  for (i = 0; i < 4; i++)
-    bus_read_word(vr4300, paddr + i * 4,
-      data + (i ^ (WORD_ADDR_XOR >> 2)));
+  bus_read_block(vr4300, paddr, data, 4);
+  vr4300_dcache_swap_words(data);
 
   vr4300_dcache_fill(&vr4300->dcache, vaddr, paddr, data);
 }
 
 // DCM: Data cache miss interlock.
 void VR4300_DCM(struct vr4300 *vr4300) {
-  vr4300_common_interlocks(vr4300, 0, 6);
+  vr4300_common_interlocks(vr4300, 0, 5);
 }
 
 // DTLB: Data TLB exception.
@@ -358,19 +355,20 @@ void VR4300_ICB(struct vr4300 *vr4300) {
 
   else {
     uint32_t line[8];
-    unsigned i;
 
     paddr &= ~0x1C;
 
     // Fill the cache line.
-    for (i = 0; i < 8; i ++)
-      bus_read_word(vr4300, paddr + i * 4, line + i);
+    bus_read_block(vr4300, paddr, line, 8);
 
     memcpy(&rfex_latch->iw, line + (vaddr >> 2 & 0x7), sizeof(rfex_latch->iw));
     vr4300_icache_fill(&vr4300->icache, icrf_latch->common.pc, paddr, line);
+    vr4300_pipeline_flush_fetch(&vr4300->pipeline);
     delay = ICACHE_ACCESS_DELAY;
   }
 
+  rfex_latch->opcode = *vr4300_decode_instruction(rfex_latch->iw);
+
   vr4300_common_interlocks(vr4300, delay, 4);
 }
 
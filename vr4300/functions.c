@@ -194,58 +194,6 @@ int VR4300_ANDI_ORI_XORI(struct vr4300 *vr4300,
   return 0;
 }
 
-#ifdef VR4300_BUSY_WAIT_DETECTION
-//
-// BEQ
-// BEQL
-// BNE
-// BNEL
-//
-// If VR4300_BUSY_WAIT_DETECTOR is defined, this version of BEQ
-// is used. Otherwise, the version below is used. The reason we
-// have this BEQ is to detect libultra's busy wait loops:
-//
-// beq $0, $0, -4
-// nop
-//
-// When we detect such loops in cached memory, the pipeline
-// simulation mostly shuts down and goes into an accelerated mode
-// where fewer checks are made (to boost performance).
-//
-// XXX: Ensure we're in cached memory AND we're followed by a NOP.
-//      If we don't do both of these things, we could get ourselves
-//      into trouble.
-//
-int VR4300_BEQ_BEQL_BNE_BNEL_BWDETECT(struct vr4300 *vr4300,
-  uint32_t iw, uint64_t rs, uint64_t rt) {
-  struct vr4300_icrf_latch *icrf_latch = &vr4300->pipeline.icrf_latch;
-  struct vr4300_rfex_latch *rfex_latch = &vr4300->pipeline.rfex_latch;
-  struct vr4300_exdc_latch *exdc_latch = &vr4300->pipeline.exdc_latch;
-  uint32_t mask = vr4300_branch_lut[iw >> 30 & 0x1];
-  uint64_t offset = (uint64_t) ((int16_t) iw) << 2;
-
-  bool is_ne = iw >> 26 & 0x1;
-  bool cmp = rs == rt;
-
-  if (cmp == is_ne) {
-    rfex_latch->iw_mask = mask;
-    return 0;
-  }
-
-  icrf_latch->pc = rfex_latch->common.pc + (offset + 4);
-
-  if (icrf_latch->pc == rfex_latch->common.pc &&
-    GET_RS(iw) == 0 && GET_RT(iw) == 0) {
-    //debug("Enter busy wait @ %llu cycles\n", vr4300->cycles);
-
-    exdc_latch->dest = PIPELINE_CYCLE_TYPE;
-    exdc_latch->result = 5;
-  }
-
-  return 0;
-}
-
-#else
 //
 // BEQ
 // BEQL
@@ -270,7 +218,6 @@ int VR4300_BEQ_BEQL_BNE_BNEL(struct vr4300 *vr4300,
   icrf_latch->pc = rfex_latch->common.pc + (offset + 4);
   return 0;
 }
-#endif
 
 //
 // BGEZ
@@ -366,6 +313,7 @@ cen64_cold static int vr4300_cacheop_unimplemented(
 cen64_cold static int vr4300_cacheop_ic_invalidate(
   struct vr4300 *vr4300, uint64_t vaddr, uint32_t paddr) {
   vr4300_icache_invalidate(&vr4300->icache, vaddr);
+  vr4300_pipeline_flush_fetch(&vr4300->pipeline);
 
   return 0;
 }
@@ -374,6 +322,7 @@ cen64_cold static int vr4300_cacheop_ic_set_taglo(
   struct vr4300 *vr4300, uint64_t vaddr, uint32_t paddr) {
   vr4300_icache_set_taglo(&vr4300->icache, vaddr,
     vr4300->regs[VR4300_CP0_REGISTER_TAGLO]);
+  vr4300_pipeline_flush_fetch(&vr4300->pipeline);
 
   return 0;
 }
@@ -381,6 +330,7 @@ cen64_cold static int vr4300_cacheop_ic_set_taglo(
 cen64_cold static int vr4300_cacheop_ic_invalidate_hit(
   struct vr4300 *vr4300, uint64_t vaddr, uint32_t paddr) {
   vr4300_icache_invalidate_hit(&vr4300->icache, vaddr, paddr);
+  vr4300_pipeline_flush_fetch(&vr4300->pipeline);
 
   return 0;
 }
@@ -407,17 +357,14 @@ cen64_cold static int vr4300_cacheop_dc_wb_invalidate(
 
   uint32_t bus_address;
   uint32_t data[4];
-  unsigned i;
 
   if (!(line = vr4300_dcache_wb_invalidate(&vr4300->dcache, vaddr)))
     return 0;
 
   bus_address = vr4300_dcache_get_tag(line, vaddr);
   memcpy(data, line->data, sizeof(data));
-
-  for (i = 0; i < 4; i++)
-    bus_write_word(vr4300, bus_address + i * 4,
-      data[i ^ (WORD_ADDR_XOR >> 2)], ~0);
+  vr4300_dcache_swap_words(data);
+  bus_write_block(vr4300, bus_address, data, 4);
 
   return DCACHE_ACCESS_DELAY;
 }
@@ -428,17 +375,14 @@ cen64_cold static int vr4300_cacheop_dc_create_dirty_ex(
 
   uint32_t bus_address;
   uint32_t data[4];
-  unsigned i;
 
   int delay = 0;
 
   if ((line = vr4300_dcache_should_flush_line(&vr4300->dcache, vaddr))) {
     bus_address = vr4300_dcache_get_tag(line, vaddr);
     memcpy(data, line->data, sizeof(data));
-
-    for (i = 0; i < 4; i++)
-      bus_write_word(vr4300, bus_address + i * 4,
-        data[i ^ (WORD_ADDR_XOR >> 2)], ~0);
+    vr4300_dcache_swap_words(data);
+    bus_write_block(vr4300, bus_address, data, 4);
 
     delay = DCACHE_ACCESS_DELAY;
   }
@@ -463,7 +407,6 @@ cen64_cold static int vr4300_cacheop_dc_hit_wb_invalidate(
 
   uint32_t bus_address;
   uint32_t data[4];
-  unsigned i;
 
   if (!(line = vr4300_dcache_probe(&vr4300->dcache, vaddr, paddr)))
     return 0;
@@ -471,10 +414,8 @@ cen64_cold static int vr4300_cacheop_dc_hit_wb_invalidate(
   if (line->metadata & 0x2) {
     bus_address = vr4300_dcache_get_tag(line, vaddr);
     memcpy(data, line->data, sizeof(data));
-
-    for (i = 0; i < 4; i++)
-      bus_write_word(vr4300, bus_address + i * 4,
-        data[i ^ (WORD_ADDR_XOR >> 2)], ~0);
+    vr4300_dcache_swap_words(data);
+    bus_write_block(vr4300, bus_address, data, 4);
 
     line->metadata &= ~0x1;
     return DCACHE_ACCESS_DELAY;
@@ -490,7 +431,6 @@ cen64_cold static int vr4300_cacheop_dc_hit_wb(
 
   uint32_t bus_address;
   uint32_t data[4];
-  unsigned i;
 
   if (!(line = vr4300_dcache_probe(&vr4300->dcache, vaddr, paddr)))
     return 0;
@@ -498,10 +438,8 @@ cen64_cold static int vr4300_cacheop_dc_hit_wb(
   if (line->metadata & 0x2) {
     bus_address = vr4300_dcache_get_tag(line, vaddr);
     memcpy(data, line->data, sizeof(data));
-
-    for (i = 0; i < 4; i++)
-      bus_write_word(vr4300, bus_address + i * 4,
-        data[i ^ (WORD_ADDR_XOR >> 2)], ~0);
+    vr4300_dcache_swap_words(data);
+    bus_write_block(vr4300, bus_address, data, 4);
 
     // TODO: Technically, it's clean now...
     line->metadata &= ~0x2;
@@ -887,52 +825,6 @@ int VR4300_INVALID(struct vr4300 *vr4300,
   return 0;
 }
 
-#ifdef VR4300_BUSY_WAIT_DETECTION
-//
-// J
-//
-// If VR4300_BUSY_WAIT_DETECTOR is defined, this version of J
-// is used. Otherwise, the version below is used. The reason we
-// have this J is to detect libultra's busy wait loops:
-//
-// busy_wait:
-//   j busy_wait
-//   nop
-//
-// When we detect such loops in cached memory, the pipeline
-// simulation mostly shuts down and goes into an accelerated mode
-// where fewer checks are made (to boost performance).
-//
-// XXX: Ensure we're in cached memory AND we're followed by a NOP.
-//      If we don't do both of these things, we could get ourselves
-//      into trouble.
-//
-int VR4300_J_JAL_BWDETECT(struct vr4300 *vr4300,
-  uint32_t iw, uint64_t rs, uint64_t rt) {
-  struct vr4300_icrf_latch *icrf_latch = &vr4300->pipeline.icrf_latch;
-  struct vr4300_rfex_latch *rfex_latch = &vr4300->pipeline.rfex_latch;
-  struct vr4300_exdc_latch *exdc_latch = &vr4300->pipeline.exdc_latch;
-
-  bool is_jal = iw >> 26 & 0x1;
-  uint32_t target = iw << 2 & 0x0FFFFFFF;
-  uint32_t mask = vr4300_branch_lut[is_jal];
-
-  exdc_latch->result = rfex_latch->common.pc + 8;
-  exdc_latch->dest = VR4300_REGISTER_RA & ~mask;
-
-  icrf_latch->pc = (rfex_latch->common.pc & ~0x0FFFFFFFULL) | target;
-
-  if (icrf_latch->pc == rfex_latch->common.pc) {
-    //debug("Enter busy wait @ %llu cycles\n", vr4300->cycles);
-
-    exdc_latch->dest = PIPELINE_CYCLE_TYPE;
-    exdc_latch->result = 5;
-  }
-
-  return 0;
-}
-
-#else
 //
 // J
 // JAL
@@ -953,7 +845,6 @@ int VR4300_J_JAL(struct vr4300 *vr4300,
   icrf_latch->pc = (rfex_latch->common.pc & ~0x0FFFFFFFULL) | target;
   return 0;
 }
-#endif
 
 //
 // JALR
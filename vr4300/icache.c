@@ -9,6 +9,7 @@
 //
 
 #include "common.h"
+#include "vr4300/decoder.h"
 #include "vr4300/icache.h"
 
 static inline struct vr4300_icache_line* get_line(
@@ -64,9 +65,18 @@ static void validate_line(struct vr4300_icache_line *line, uint32_t tag) {
 void vr4300_icache_fill(struct vr4300_icache *icache,
   uint64_t vaddr, uint32_t paddr, const void *data) {
   struct vr4300_icache_line *line = get_line(icache, vaddr);
+  unsigned i;
 
   memcpy(line->data, data, sizeof(line->data));
   validate_line(line, paddr & ~0xFFFU);
+
+  // Pre-decode the line so that hits needn't do it.
+  for (i = 0; i < 8; i++) {
+    uint32_t iw;
+
+    memcpy(&iw, line->data + i * 4, sizeof(iw));
+    line->opcodes[i] = *vr4300_decode_instruction(iw);
+  }
 }
 
 // Returns the tag of the line associated with vaddr.
@@ -79,6 +89,15 @@ uint32_t vr4300_icache_get_tag(const struct vr4300_icache *icache,
 
 // Initializes the instruction cache.
 void vr4300_icache_init(struct vr4300_icache *icache) {
+  const struct vr4300_opcode *nop = vr4300_decode_instruction(0);
+  unsigned i, j;
+
+  // Lines can be validated with CACHE without being filled;
+  // keep the decoded words in sync with the (zeroed) data.
+  for (i = 0; i < sizeof(icache->lines) / sizeof(*icache->lines); i++) {
+    for (j = 0; j < 8; j++)
+      icache->lines[i].opcodes[j] = *nop;
+  }
 }
 
 // Invalidates an instruction cache line (regardless if hit or miss).
@@ -11,9 +11,13 @@
 #ifndef __vr4300_icache_h__
 #define __vr4300_icache_h__
 #include "common.h"
+#include "vr4300/decoder.h"
 
+// Each line also carries the decoded form of its words. Lines only
+// ever get new data through a fill, which is where we decode it.
 struct vr4300_icache_line {
   uint8_t data[8 * 4];
+  struct vr4300_opcode opcodes[8];
   uint32_t metadata;
 };
 
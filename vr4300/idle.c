@@ -0,0 +1,261 @@
+//
+// vr4300/idle.c: VR4300 idle loop detection.
+//
+// CEN64: Cycle-Accurate Nintendo 64 Simulator.
+// Copyright (C) 2014, Tyler J. Stachecki.
+//
+// This file is subject to the terms and conditions defined in
+// 'LICENSE', which is part of this source code package.
+//
+
+#include "common.h"
+#include "bus/address.h"
+#include "bus/controller.h"
+#include "device/scheduler.h"
+#include "os/thread.h"
+#include "rsp/cp0.h"
+#include "rsp/cpu.h"
+#include "vr4300/cp0.h"
+#include "vr4300/cpu.h"
+#include "vr4300/decoder.h"
+#include "vr4300/icache.h"
+#include "vr4300/idle.h"
+#include "vr4300/segment.h"
+
+#ifdef VR4300_BUSY_WAIT_DETECTION
+static bool vr4300_idle_analyze(struct vr4300 *vr4300,
+  uint64_t start, uint64_t end);
+static bool vr4300_idle_fetch(struct vr4300 *vr4300, uint64_t vaddr,
+  uint32_t *iw, struct vr4300_opcode *opcode);
+static bool vr4300_idle_operands(const struct vr4300_opcode *opcode,
+  uint32_t iw, bool is_branch, uint32_t *reads, uint32_t *writes);
+
+// Checks that an iteration of the loop is a function of nothing but
+// registers it doesn't write and memory. Iterations start with the
+// delay slot of the branch, so that's where the walk starts too.
+bool vr4300_idle_analyze(struct vr4300 *vr4300,
+  uint64_t start, uint64_t end) {
+  uint32_t reads[VR4300_IDLE_MAX_INSNS], writes[VR4300_IDLE_MAX_INSNS];
+  uint32_t written = 0, defined = 0;
+  unsigned count = (end - start) / 4 + 1;
+  unsigned i;
+
+  for (i = 0; i < count; i++) {
+    uint64_t vaddr = i == 0 ? end : start + (i - 1) * 4;
+    struct vr4300_opcode opcode;
+    uint32_t iw;
+
+    // Only the branch itself is allowed to change the flow.
+    if (!vr4300_idle_fetch(vr4300, vaddr, &iw, &opcode) ||
+      !vr4300_idle_operands(&opcode, iw, i == count - 1,
+      reads + i, writes + i))
+      return false;
+
+    written |= writes[i];
+  }
+
+  for (i = 0; i < count; i++) {
+    if (reads[i] & written & ~defined)
+      return false;
+
+    defined |= writes[i];
+  }
+
+  return true;
+}
+
+// Called after a branch or jump has gone through EX.
+void vr4300_idle_branch(struct vr4300 *vr4300) {
+  struct vr4300_idle *idle = &vr4300->idle;
+  struct scheduler *scheduler = vr4300->bus->scheduler;
+  struct rsp *rsp = vr4300->bus->rsp;
+  uint64_t pc = vr4300->pipeline.rfex_latch.common.pc;
+  uint64_t target = vr4300->pipeline.icrf_latch.pc;
+  uint64_t now = scheduler->now;
+  uint64_t deadline, period, skip;
+  uint32_t status, cause;
+
+  deadline = idle->limit < scheduler->deadline
+    ? idle->limit : scheduler->deadline;
+
+  idle->limit = SCHEDULER_NEVER;
+
+  // Anything but a short backward branch ends the candidate loop.
+  if (target > pc || pc - target > (VR4300_IDLE_MAX_INSNS - 2) * 4) {
+    idle->branch_pc = 1;
+    return;
+  }
+
+  if (pc != idle->branch_pc || target != idle->target) {
+    idle->branch_pc = pc;
+    idle->target = target;
+    idle->last_seen = now;
+    idle->period = 0;
+    idle->state = VR4300_IDLE_UNKNOWN;
+    return;
+  }
+
+  period = now - idle->last_seen;
+  idle->last_seen = now;
+
+  if (period != idle->period) {
+    idle->period = period;
+    idle->state = VR4300_IDLE_UNKNOWN;
+    return;
+  }
+
+  if (idle->state == VR4300_IDLE_UNKNOWN) {
+    idle->state = vr4300_idle_analyze(vr4300, target, pc + 4)
+      ? VR4300_IDLE_PURE : VR4300_IDLE_IMPURE;
+  }
+
+  if (idle->state != VR4300_IDLE_PURE || deadline <= now)
+    return;
+
+  // Skip whole iterations only, and a multiple of three cycles so
+  // that the RCP keeps the same slots in the VR4300's clock.
+  skip = (deadline - now) / (period * 3) * (period * 3);
+
+  if (skip == 0)
+    return;
+
+  // An interrupt about to be taken will break us out of the loop.
+  status = vr4300->regs[VR4300_CP0_REGISTER_STATUS];
+  cause = vr4300->regs[VR4300_CP0_REGISTER_CAUSE];
+
+  if (cause & status & 0xFF00 && (((status ^ 6) & 0x7) == 0x7))
+    return;
+
+  // A running RSP could change anything the loop is looking at. Once
+  // it's halted, only the VR4300 can start it again, so it just has to
+  // be brought up to date (it's not waited on while it's still running).
+  if (!(cen64_atomic_load_u32(&rsp->regs[RSP_CP0_REGISTER_SP_STATUS]) &
+    SP_STATUS_HALT))
+    return;
+
+  rsp_sync(rsp);
+
+  scheduler->now += skip;
+  idle->last_seen += skip;
+  idle->skipped_cycles += skip;
+}
+
+// Fetches an instruction of a loop for analysis, provided it can be
+// done without any side effects or address translation.
+bool vr4300_idle_fetch(struct vr4300 *vr4300, uint64_t vaddr,
+  uint32_t *iw, struct vr4300_opcode *opcode) {
+  const struct segment *segment = get_segment(vaddr,
+    vr4300->regs[VR4300_CP0_REGISTER_STATUS]);
+  const struct vr4300_icache_line *line;
+  uint32_t paddr;
+
+  if (segment == NULL || segment->mapped)
+    return false;
+
+  paddr = vaddr - segment->offset;
+
+  if (segment->cached) {
+    if ((line = vr4300_icache_probe(&vr4300->icache, vaddr, paddr)) == NULL)
+      return false;
+
+    memcpy(iw, line->data + (paddr & 0x1C), sizeof(*iw));
+    *opcode = line->opcodes[paddr >> 2 & 0x7];
+    return true;
+  }
+
+  if (paddr >= RDRAM_BASE_ADDRESS_LEN && (paddr < PIF_ROM_BASE_ADDRESS ||
+    paddr >= PIF_ROM_BASE_ADDRESS + PIF_ROM_ADDRESS_LEN))
+    return false;
+
+  bus_read_word(vr4300, paddr, iw);
+  *opcode = *vr4300_decode_instruction(*iw);
+  return true;
+}
+
+// Returns the registers an instruction reads and writes, or false if
+// it isn't something an idle loop is allowed to contain.
+bool vr4300_idle_operands(const struct vr4300_opcode *opcode,
+  uint32_t iw, bool is_branch, uint32_t *reads, uint32_t *writes) {
+  uint32_t rs = 1U << GET_RS(iw);
+  uint32_t rt = 1U << GET_RT(iw);
+  uint32_t rd = 1U << GET_RD(iw);
+
+  if (((opcode->flags & OPCODE_INFO_BRANCH) != 0) != is_branch)
+    return false;
+
+  switch (opcode->id) {
+    case VR4300_OPCODE_ADDIU: case VR4300_OPCODE_DADDIU:
+    case VR4300_OPCODE_ANDI: case VR4300_OPCODE_ORI:
+    case VR4300_OPCODE_XORI: case VR4300_OPCODE_SLTI:
+    case VR4300_OPCODE_SLTIU: case VR4300_OPCODE_LB:
+    case VR4300_OPCODE_LBU: case VR4300_OPCODE_LH:
+    case VR4300_OPCODE_LHU: case VR4300_OPCODE_LW:
+    case VR4300_OPCODE_LWU: case VR4300_OPCODE_LD:
+      *reads = rs;
+      *writes = rt;
+      break;
+
+    case VR4300_OPCODE_LUI:
+      *reads = 0;
+      *writes = rt;
+      break;
+
+    case VR4300_OPCODE_ADDU: case VR4300_OPCODE_DADDU:
+    case VR4300_OPCODE_SUBU: case VR4300_OPCODE_DSUBU:
+    case VR4300_OPCODE_AND: case VR4300_OPCODE_OR:
+    case VR4300_OPCODE_XOR: case VR4300_OPCODE_NOR:
+    case VR4300_OPCODE_SLT: case VR4300_OPCODE_SLTU:
+    case VR4300_OPCODE_SLLV: case VR4300_OPCODE_SRLV:
+    case VR4300_OPCODE_SRAV: case VR4300_OPCODE_DSLLV:
+    case VR4300_OPCODE_DSRLV: case VR4300_OPCODE_DSRAV:
+      *reads = rs | rt;
+      *writes = rd;
+      break;
+
+    case VR4300_OPCODE_SLL: case VR4300_OPCODE_SRL:
+    case VR4300_OPCODE_SRA: case VR4300_OPCODE_DSLL:
+    case VR4300_OPCODE_DSRL: case VR4300_OPCODE_DSRA:
+    case VR4300_OPCODE_DSLL32: case VR4300_OPCODE_DSRL32:
+    case VR4300_OPCODE_DSRA32:
+      *reads = rt;
+      *writes = rd;
+      break;
+
+    case VR4300_OPCODE_BEQ: case VR4300_OPCODE_BEQL:
+    case VR4300_OPCODE_BNE: case VR4300_OPCODE_BNEL:
+      *reads = rs | rt;
+      *writes = 0;
+      break;
+
+    case VR4300_OPCODE_BGEZ: case VR4300_OPCODE_BGEZL:
+    case VR4300_OPCODE_BGTZ: case VR4300_OPCODE_BGTZL:
+    case VR4300_OPCODE_BLEZ: case VR4300_OPCODE_BLEZL:
+    case VR4300_OPCODE_BLTZ: case VR4300_OPCODE_BLTZL:
+    case VR4300_OPCODE_JR:
+      *reads = rs;
+      *writes = 0;
+      break;
+
+    case VR4300_OPCODE_J:
+      *reads = 0;
+      *writes = 0;
+      break;
+
+    default:
+      return false;
+  }
+
+  // Writes to $zero are discarded, so they don't make anything stale.
+  *writes &= ~1U;
+  return true;
+}
+#endif
+
+// Initializes the idle loop detector.
+void vr4300_idle_init(struct vr4300_idle *idle) {
+  memset(idle, 0, sizeof(*idle));
+
+  idle->branch_pc = 1;
+  idle->limit = SCHEDULER_NEVER;
+}
+
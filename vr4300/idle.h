@@ -0,0 +1,56 @@
+//
+// vr4300/idle.h: VR4300 idle loop detection.
+//
+// CEN64: Cycle-Accurate Nintendo 64 Simulator.
+// Copyright (C) 2014, Tyler J. Stachecki.
+//
+// This file is subject to the terms and conditions defined in
+// 'LICENSE', which is part of this source code package.
+//
+
+#ifndef __vr4300_idle_h__
+#define __vr4300_idle_h__
+#include "common.h"
+
+// Longest loop (including the delay slot) that gets considered.
+#define VR4300_IDLE_MAX_INSNS 16
+
+struct vr4300;
+
+enum vr4300_idle_state {
+  VR4300_IDLE_UNKNOWN,
+  VR4300_IDLE_PURE,
+  VR4300_IDLE_IMPURE
+};
+
+// Tracks the most recently taken short backward branch. Once the same
+// loop goes around twice in the same number of cycles and its body
+// is known to have no side effects, every iteration until something
+// else in the system happens is a copy of the last one.
+struct vr4300_idle {
+  uint64_t branch_pc;
+  uint64_t target;
+
+  uint64_t last_seen;
+  uint64_t period;
+
+  // Last cycle for which the loop's reads are known to be stable.
+  uint64_t limit;
+
+  uint64_t skipped_cycles;
+  enum vr4300_idle_state state;
+};
+
+cen64_cold void vr4300_idle_init(struct vr4300_idle *idle);
+void vr4300_idle_branch(struct vr4300 *vr4300);
+
+// Called by devices whose registers change over time on their own:
+// the loop that read one may not be fast-forwarded past this cycle.
+static inline void vr4300_idle_limit(struct vr4300_idle *idle,
+  uint64_t cycle) {
+  if (cycle < idle->limit)
+    idle->limit = cycle;
+}
+
+#endif
+
@@ -10,6 +10,8 @@
 
 #include "common.h"
 #include "bus/address.h"
+#include "bus/controller.h"
+#include "rsp/cpu.h"
 #include "vr4300/cpu.h"
 #include "vr4300/interface.h"
 
@@ -66,6 +68,8 @@ int read_mi_regs(void *opaque, uint32_t address, uint32_t *word) {
   uint32_t offset = address - MI_REGS_BASE_ADDRESS;
   enum mi_register reg = (offset >> 2);
 
+  rsp_sync(vr4300->bus->rsp);
+
   *word = vr4300->mi_regs[reg];
   debug_mmio_read(mi, mi_register_mnemonics[reg], *word);
   return 0;
@@ -79,6 +83,7 @@ int write_mi_regs(void *opaque, uint32_t address, uint32_t word, uint32_t dqm) {
   uint32_t result;
 
   debug_mmio_write(mi, mi_register_mnemonics[reg], word, dqm);
+  rsp_sync(vr4300->bus->rsp);
 
   // Change mode settings?
   if (reg == MI_INIT_MODE_REG) {
@@ -14,6 +14,7 @@
 #include "vr4300/cpu.h"
 #include "vr4300/decoder.h"
 #include "vr4300/fault.h"
+#include "vr4300/idle.h"
 #include "vr4300/opcodes.h"
 #include "vr4300/pipeline.h"
 #include "vr4300/segment.h"
@@ -25,7 +26,6 @@ cen64_cold static void vr4300_cycle_slow_dc(struct vr4300 *vr4300);
 static void vr4300_cycle_slow_ex(struct vr4300 *vr4300);
 static void vr4300_cycle_slow_rf(struct vr4300 *vr4300);
 static void vr4300_cycle_slow_ic(struct vr4300 *vr4300);
-static void vr4300_cycle_busywait(struct vr4300 *vr4300);
 
 // Prints out instructions and their virtual address as they are executed.
 // Note: Some of these instructions _may_ be speculative and killed later...
@@ -41,10 +41,13 @@ cen64_flatten static void vr4300_ic_stage(struct vr4300 *vr4300) {
   uint64_t pc = icrf_latch->pc;
   uint32_t decode_iw;
 
-  // Finish decoding instruction in RF.
-  decode_iw = rfex_latch->iw &= rfex_latch->iw_mask;
-  *opcode = *vr4300_decode_instruction(decode_iw);
-  rfex_latch->iw_mask = ~0U;
+  // The RF stage latches the instruction with its decoded form, so
+  // we only need to decode here if the instruction is being killed.
+  if (unlikely(rfex_latch->iw_mask != ~0U)) {
+    decode_iw = rfex_latch->iw &= rfex_latch->iw_mask;
+    *opcode = *vr4300_decode_instruction(decode_iw);
+    rfex_latch->iw_mask = ~0U;
+  }
 
   // Latch common pipeline values.
   icrf_latch->common.pc = pc;
@@ -79,6 +82,17 @@ static int vr4300_rf_stage(struct vr4300 *vr4300) {
 
   rfex_latch->common = icrf_latch->common;
 
+  // Still running through the line we last hit in?
+  if ((vaddr & ~0x1FULL) == vr4300->pipeline.fetch_vaddr) {
+    line = vr4300->pipeline.fetch_line;
+
+    memcpy(&rfex_latch->iw, line->data + (vaddr & 0x1C),
+      sizeof(rfex_latch->iw));
+
+    rfex_latch->opcode = line->opcodes[vaddr >> 2 & 0x7];
+    return 0;
+  }
+
   // If we're in a mapped region, do a TLB translation.
   paddr = vaddr - segment->offset;
   cached = segment->cached;
@@ -115,6 +129,9 @@ static int vr4300_rf_stage(struct vr4300 *vr4300) {
   memcpy(&rfex_latch->iw, line->data + (paddr & 0x1C),
     sizeof(rfex_latch->iw));
 
+  rfex_latch->opcode = line->opcodes[paddr >> 2 & 0x7];
+  vr4300->pipeline.fetch_line = line;
+  vr4300->pipeline.fetch_vaddr = vaddr & ~0x1FULL;
   return 0;
 }
 
@@ -128,6 +145,7 @@ static int vr4300_ex_stage(struct vr4300 *vr4300) {
   unsigned rs, rt, rslutidx, rtlutidx;
   uint64_t rs_reg, rt_reg, temp;
   uint32_t flags, iw;
+  int result;
 
   exdc_latch->common = rfex_latch->common;
   flags = rfex_latch->opcode.flags;
@@ -187,8 +205,15 @@ static int vr4300_ex_stage(struct vr4300 *vr4300) {
 
   exdc_latch->dest = VR4300_REGISTER_R0;
   exdc_latch->request.type = VR4300_BUS_REQUEST_NONE;
-  return vr4300_function_table[rfex_latch->opcode.id](
+  result = vr4300_function_table[rfex_latch->opcode.id](
     vr4300, iw, rs_reg, rt_reg);
+
+#ifdef VR4300_BUSY_WAIT_DETECTION
+  if ((flags & OPCODE_INFO_BRANCH) && result == 0)
+    vr4300_idle_branch(vr4300);
+#endif
+
+  return result;
 }
 
 // Data cache fetch stage.
@@ -350,6 +375,9 @@ void vr4300_cycle_slow_wb(struct vr4300 *vr4300) {
       return;
   }
 
+  else
+    pipeline->idle_cycles++;
+
   vr4300_cycle_slow_dc(vr4300);
 }
 
@@ -431,19 +459,6 @@ void vr4300_cycle_slow_ic(struct vr4300 *vr4300) {
   vr4300_ic_stage(vr4300);
 }
 
-// Special-cased busy wait handler.
-void vr4300_cycle_busywait(struct vr4300 *vr4300) {
-  uint32_t status = vr4300->regs[VR4300_CP0_REGISTER_STATUS];
-  uint32_t cause = vr4300->regs[VR4300_CP0_REGISTER_CAUSE];
-
-  // Check if the busy wait period is over (due to an interrupt condition).
-  if (unlikely(cause & status & 0xFF00) && (status & 0x1) && !(status & 0x6)) {
-    //debug("Busy wait done @ %llu cycles\n", vr4300->cycles);
-
-    VR4300_INTR(vr4300);
-  }
-}
-
 // LUT of stages for fault handling.
 cen64_align(static const pipeline_function
   pipeline_function_lut[], CACHE_LINE_SIZE) = {
@@ -452,8 +467,6 @@ cen64_align(static const pipeline_function
   vr4300_cycle_slow_ex,
   vr4300_cycle_slow_rf,
   vr4300_cycle_slow_ic,
-
-  vr4300_cycle_busywait,
   VR4300_DCB,
 };
 
@@ -461,16 +474,11 @@ cen64_align(static const pipeline_function
 void vr4300_cycle(struct vr4300 *vr4300) {
   struct vr4300_pipeline *pipeline = &vr4300->pipeline;
 
-  // Increment counters.
-  vr4300->regs[VR4300_CP0_REGISTER_COUNT]++;
-
-  if ((uint32_t) (vr4300->regs[VR4300_CP0_REGISTER_COUNT] >> 1) ==
-    (uint32_t) vr4300->regs[VR4300_CP0_REGISTER_COMPARE])
-    vr4300->regs[VR4300_CP0_REGISTER_CAUSE] |= 0x8000;
-
   // We're stalling for something...
-  if (pipeline->cycles_to_stall > 0)
+  if (pipeline->cycles_to_stall > 0) {
     pipeline->cycles_to_stall--;
+    pipeline->idle_cycles++;
+  }
 
   // Ordinarily, we would need to check every pipeline stage to see if it is
   // aborted, and conditionally not execute it. Since faults are rare, we'll
@@ -515,5 +523,6 @@ void vr4300_cycle_extra(struct vr4300 *vr4300, struct vr4300_stats *stats) {
 void vr4300_pipeline_init(struct vr4300_pipeline *pipeline) {
   pipeline->icrf_latch.segment = get_default_segment();
   pipeline->exdc_latch.segment = get_default_segment();
+  vr4300_pipeline_flush_fetch(pipeline);
 }
 
@@ -16,6 +16,7 @@
 #include "vr4300/segment.h"
 
 struct vr4300;
+struct vr4300_icache_line;
 
 typedef int (*vr4300_cacheop_func_t)(
   struct vr4300 *vr4300, uint64_t vaddr, uint32_t paddr);
@@ -91,9 +92,25 @@ struct vr4300_pipeline {
   unsigned exception_history;
   unsigned cycles_to_stall;
   bool fault_present;
+
+  // Cycles that didn't retire an instruction (for statistics).
+  uint64_t idle_cycles;
+
+  // The icache line that the RF stage last hit in, and the virtual
+  // address it was hit with. Fetches from the same line can skip the
+  // translation and icache probe until something invalidates it.
+  const struct vr4300_icache_line *fetch_line;
+  uint64_t fetch_vaddr;
 };
 
 cen64_cold void vr4300_pipeline_init(struct vr4300_pipeline *pipeline);
 
+// Must be called whenever the outcome of an instruction fetch could
+// change: the icache, TLB, ASID or access level is being modified.
+static inline void vr4300_pipeline_flush_fetch(
+  struct vr4300_pipeline *pipeline) {
+  pipeline->fetch_vaddr = 1;
+}
+
 #endif
 